@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    Benchmark.cpp
+    Created: 3 May 2024 8:12:44pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+//==============================================================================
+Benchmark::Benchmark(const juce::String& _suite,
+                     int argc,
+                     char* argv[]
+                    ) : suite(_suite),
+                        failed(false)
+{
+    formatManager.registerBasicFormats();
+
+    // the build points the benchmarks at the tracks/ folder of the checkout
+    options.tracksDirectory = juce::File{ OTODECKS_TRACKS_DIR };
+
+    juce::ArgumentList args{ argc, argv };
+    if (args.containsOption("--tracks"))
+    {
+        options.tracksDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--tracks"));
+    }
+    if (args.containsOption("--block"))
+    {
+        options.blockSize = juce::jlimit(16, 1 << 16, args.getValueForOption("--block").getIntValue());
+    }
+    if (args.containsOption("--rate"))
+    {
+        options.sampleRate = juce::jlimit(8000.0, 384000.0, args.getValueForOption("--rate").getDoubleValue());
+    }
+    if (args.containsOption("--seconds"))
+    {
+        options.seconds = juce::jlimit(1.0, 3600.0, args.getValueForOption("--seconds").getDoubleValue());
+    }
+    if (args.containsOption("--repeats"))
+    {
+        options.repeats = juce::jlimit(1, 1000, args.getValueForOption("--repeats").getIntValue());
+    }
+    if (args.containsOption("--out"))
+    {
+        options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--out"));
+    }
+}
+
+const Benchmark::Options& Benchmark::getOptions() const
+{
+    return options;
+}
+
+juce::AudioFormatManager& Benchmark::getFormatManager()
+{
+    return formatManager;
+}
+
+bool Benchmark::loadInput(const juce::String& fileName, juce::AudioBuffer<float>& audio, double& sourceSampleRate)
+{
+    const juce::File file{ options.tracksDirectory.getChildFile(fileName) };
+    std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+    {
+        std::cerr << suite << ": could not read " << file.getFullPathName() << std::endl;
+        failed = true;
+        return false;
+    }
+
+    sourceSampleRate = reader->sampleRate;
+    const int numSamples{ (int) juce::jmin(reader->lengthInSamples, (juce::int64) (options.seconds * reader->sampleRate)) };
+    // mono tracks are copied to both sides, like the decks play them
+    audio.setSize(2, numSamples);
+    reader->read(&audio, 0, numSamples, 0, true, true);
+    return true;
+}
+
+void Benchmark::run(const juce::String& name,
+                    juce::int64 numSamples,
+                    double sampleRate,
+                    int blockSize,
+                    const RenderFunction& render)
+{
+    if (numSamples <= 0 || sampleRate <= 0 || blockSize <= 0)
+    {
+        DBG("Benchmark::run nothing to render for " << name);
+        failed = true;
+        return;
+    }
+
+    Result result{ name, blockSize, sampleRate, numSamples, options.repeats, {} };
+    const juce::int64 numBlocks{ (numSamples + blockSize - 1) / blockSize };
+    result.blockSeconds.reserve((size_t) (numBlocks * options.repeats));
+    // the first pass fills caches and lets lazily allocated state settle
+    for (int pass = 0; pass <= options.repeats; ++pass)
+    {
+        for (juce::int64 start = 0; start < numSamples; start += blockSize)
+        {
+            const int count{ (int) juce::jmin((juce::int64) blockSize, numSamples - start) };
+            const juce::int64 before{ juce::Time::getHighResolutionTicks() };
+            render(start, count);
+            const juce::int64 after{ juce::Time::getHighResolutionTicks() };
+            if (pass > 0)
+            {
+                result.blockSeconds.push_back(juce::Time::highResolutionTicksToSeconds(after - before));
+            }
+        }
+    }
+    std::cerr << suite << ": " << name << " done" << std::endl;
+    results.push_back(std::move(result));
+}
+
+void Benchmark::run(const juce::String& name, juce::int64 numSamples, const RenderFunction& render)
+{
+    run(name, numSamples, options.sampleRate, options.blockSize, render);
+}
+
+int Benchmark::finish()
+{
+    auto* machine = new juce::DynamicObject();
+    machine->setProperty("cpu", juce::SystemStats::getCpuModel());
+    machine->setProperty("cores", juce::SystemStats::getNumCpus());
+    machine->setProperty("os", juce::SystemStats::getOperatingSystemName());
+   #if JUCE_DEBUG
+    machine->setProperty("build", "debug");
+   #else
+    machine->setProperty("build", "release");
+   #endif
+    machine->setProperty("juce", juce::SystemStats::getJUCEVersion());
+
+    auto* settings = new juce::DynamicObject();
+    settings->setProperty("tracks", options.tracksDirectory.getFullPathName());
+    settings->setProperty("blockSize", options.blockSize);
+    settings->setProperty("sampleRate", options.sampleRate);
+    settings->setProperty("seconds", options.seconds);
+    settings->setProperty("repeats", options.repeats);
+
+    juce::Array<juce::var> resultList;
+    for (const Result& result : results)
+    {
+        resultList.add(toJSON(result));
+    }
+
+    auto* document = new juce::DynamicObject();
+    document->setProperty("suite", suite);
+    document->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+    document->setProperty("machine", machine);
+    document->setProperty("settings", settings);
+    document->setProperty("results", resultList);
+    const juce::String json{ juce::JSON::toString(juce::var{ document }) };
+
+    if (options.outputFile == juce::File{})
+    {
+        std::cout << json << std::endl;
+    }
+    else if (!options.outputFile.getParentDirectory().createDirectory() || !options.outputFile.replaceWithText(json))
+    {
+        std::cerr << suite << ": could not write " << options.outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
+
+juce::var Benchmark::toJSON(const Result& result)
+{
+    std::vector<double> sorted{ result.blockSeconds };
+    std::sort(sorted.begin(), sorted.end());
+    const double total{ std::accumulate(sorted.begin(), sorted.end(), 0.0) };
+    const auto percentile = [&sorted](double p)
+    {
+        return sorted[(size_t) juce::jlimit(0.0, (double) sorted.size() - 1, std::ceil(p * sorted.size()) - 1)];
+    };
+    const double blockLength{ result.blockSize / result.sampleRate };
+    const double audioSeconds{ (double) result.numSamples * result.passes / result.sampleRate };
+    constexpr double micros{ 1.0e6 };
+
+    auto* object = new juce::DynamicObject();
+    object->setProperty("name", result.name);
+    object->setProperty("blockSize", result.blockSize);
+    object->setProperty("sampleRate", result.sampleRate);
+    object->setProperty("blocks", (int) sorted.size());
+    object->setProperty("meanUs", total / sorted.size() * micros);
+    object->setProperty("medianUs", percentile(0.5) * micros);
+    object->setProperty("p99Us", percentile(0.99) * micros);
+    object->setProperty("maxUs", sorted.back() * micros);
+    // share of the real-time budget of a block the median block takes
+    object->setProperty("medianLoad", percentile(0.5) / blockLength);
+    // seconds of audio rendered per second of CPU
+    object->setProperty("realtimeFactor", total > 0 ? audioSeconds / total : 0.0);
+    object->setProperty("nsPerSample", total / (audioSeconds * result.sampleRate) * 1.0e9);
+    return juce::var{ object };
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+    Created: 3 May 2024 8:12:44pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <functional>
+#include <vector>
+
+//==============================================================================
+/*
+    Shared harness of the micro-benchmarks. Every benchmark renders fixed
+    audio from tracks/ in blocks, times each block after one untimed warm-up
+    pass, and the suite prints one JSON document with the machine, the
+    settings and per block statistics, so runs can be compared over time.
+
+        OtoBench<Suite> [--tracks=<folder>] [--block=<samples>] [--rate=<Hz>]
+                        [--seconds=<s>] [--repeats=<n>] [--out=<file.json>]
+*/
+class Benchmark
+{
+public:
+    struct Options
+    {
+        juce::File tracksDirectory;
+        int blockSize{ 512 };
+        /**device rate the engine runs at*/
+        double sampleRate{ 48000.0 };
+        /**length of audio rendered per pass*/
+        double seconds{ 30.0 };
+        /**timed passes after the warm-up*/
+        int repeats{ 5 };
+        /**stdout if not set*/
+        juce::File outputFile;
+    };
+
+    /**Renders the numSamples that start at this sample of the pass*/
+    using RenderFunction = std::function<void(juce::int64 startSample, int numSamples)>;
+
+    static constexpr const char* defaultInput{ "electro_smash.mp3" };
+
+    Benchmark(const juce::String& _suite, int argc, char* argv[]);
+
+    const Options& getOptions() const;
+    juce::AudioFormatManager& getFormatManager();
+
+    /**Decodes the start of a track from the tracks folder, at most the configured length, as stereo.
+       Returns false if the track cannot be read.*/
+    bool loadInput(const juce::String& fileName, juce::AudioBuffer<float>& audio, double& sourceSampleRate);
+
+    /**Times render over numSamples of audio at sampleRate, in blocks of blockSize*/
+    void run(const juce::String& name,
+             juce::int64 numSamples,
+             double sampleRate,
+             int blockSize,
+             const RenderFunction& render);
+    /**Same with the configured block size and device rate*/
+    void run(const juce::String& name, juce::int64 numSamples, const RenderFunction& render);
+
+    /**Writes the results as JSON, returns the exit code for main*/
+    int finish();
+
+private:
+    struct Result
+    {
+        juce::String name;
+        int blockSize;
+        double sampleRate;
+        juce::int64 numSamples;
+        int passes;
+        /**seconds each timed block took, every pass*/
+        std::vector<double> blockSeconds;
+    };
+
+    static juce::var toJSON(const Result& result);
+
+    const juce::String suite;
+    Options options;
+    juce::AudioFormatManager formatManager;
+    std::vector<Result> results;
+    bool failed;
+
+    JUCE_DECLARE_NON_COPYABLE (Benchmark)
+};
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    DecodersBenchmark.cpp
+    Created: 3 May 2024 9:21:50pm
+    Author:  Kirby Loh
+
+    Times decoding every track in the tracks folder in the chunks the
+    prefetcher reads, at each file's own rate, so importing and prefetching
+    costs can be told apart from the deck chain.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include <iostream>
+
+int main(int argc, char* argv[])
+{
+    Benchmark bench{ "decoders", argc, argv };
+    const Benchmark::Options& options{ bench.getOptions() };
+    juce::AudioFormatManager& formatManager{ bench.getFormatManager() };
+
+    juce::Array<juce::File> files{ options.tracksDirectory.findChildFiles(juce::File::findFiles, false,
+                                                                          formatManager.getWildcardForAllFormats()) };
+    files.sort();
+    if (files.isEmpty())
+    {
+        std::cerr << "decoders: no tracks in " << options.tracksDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // the chunk size TrackPrefetcher decodes with
+    constexpr int chunkSamples{ 1 << 16 };
+    juce::AudioBuffer<float> output{ 2, chunkSamples };
+    for (const juce::File& file : files)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+        {
+            std::cerr << "decoders: could not read " << file.getFullPathName() << std::endl;
+            continue;
+        }
+        // from the start of the track, at most the configured length
+        const juce::int64 numSamples{ juce::jmin(reader->lengthInSamples,
+                                                 (juce::int64) (options.seconds * reader->sampleRate)) };
+        juce::AudioFormatReader& source{ *reader };
+        bench.run(file.getFileName(), numSamples, reader->sampleRate, chunkSamples,
+                  [&output, &source](juce::int64 start, int count)
+                  {
+                      source.read(&output, 0, count, start, true, true);
+                  });
+    }
+
+    return bench.finish();
+}
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    EffectsBenchmark.cpp
+    Created: 3 May 2024 8:55:02pm
+    Author:  Kirby Loh
+
+    Times the effects of the deck chain on the same input: the reverb,
+    bypassed the way a deck starts and with the wet level up, the bare
+    juce::Reverb for the cost of the DSP without the source around it,
+    and the beat synced echo and the filter next to them.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "BeatDelay.h"
+#include "DJFilter.h"
+
+int main(int argc, char* argv[])
+{
+    Benchmark bench{ "effects", argc, argv };
+    const Benchmark::Options& options{ bench.getOptions() };
+
+    juce::AudioBuffer<float> input;
+    double inputRate{ 0 };
+    if (!bench.loadInput(Benchmark::defaultInput, input, inputRate))
+    {
+        return bench.finish();
+    }
+
+    const juce::int64 numSamples{ (juce::int64) (options.seconds * options.sampleRate) };
+    juce::AudioBuffer<float> output{ 2, options.blockSize };
+
+    for (float wetLevel : { 0.0f, 0.33f })
+    {
+        juce::MemoryAudioSource memory{ input, false, true };
+        juce::ReverbAudioSource reverb{ &memory, false };
+        juce::Reverb::Parameters parameters;
+        // the deck defaults, fully dry until the wet slider moves
+        parameters.wetLevel = wetLevel;
+        parameters.dryLevel = 1.0f;
+        reverb.setParameters(parameters);
+        reverb.prepareToPlay(options.blockSize, options.sampleRate);
+        bench.run("reverb source wet " + juce::String(wetLevel, 2), numSamples,
+                  [&output, &reverb](juce::int64, int count)
+                  {
+                      juce::AudioSourceChannelInfo info{ &output, 0, count };
+                      reverb.getNextAudioBlock(info);
+                  });
+    }
+
+    {
+        juce::Reverb reverb;
+        reverb.setSampleRate(options.sampleRate);
+        const int inputLength{ input.getNumSamples() };
+        bench.run("reverb process stereo", numSamples,
+                  [&output, &input, &reverb, inputLength](juce::int64 start, int count)
+                  {
+                      // wraps around the input like the looping source does, in at most two pieces
+                      const int offset{ (int) (start % inputLength) };
+                      const int first{ juce::jmin(count, inputLength - offset) };
+                      for (int ch = 0; ch < 2; ++ch)
+                      {
+                          output.copyFrom(ch, 0, input, ch, offset, first);
+                          output.copyFrom(ch, first, input, ch, 0, count - first);
+                      }
+                      reverb.processStereo(output.getWritePointer(0), output.getWritePointer(1), count);
+                  });
+    }
+
+    for (float echoLevel : { 0.0f, 0.5f })
+    {
+        juce::MemoryAudioSource memory{ input, false, true };
+        BeatDelay echo{ &memory };
+        echo.setBeats(0.75);
+        echo.setLevel(echoLevel);
+        echo.prepareToPlay(options.blockSize, options.sampleRate);
+        // the tempo changes every block, as it does while the pitch fader moves
+        double bpm{ 124.0 };
+        bench.run("beat delay level " + juce::String(echoLevel, 2), numSamples,
+                  [&output, &echo, &bpm](juce::int64, int count)
+                  {
+                      bpm = bpm < 130.0 ? bpm + 0.01 : 118.0;
+                      echo.setTempo(bpm);
+                      juce::AudioSourceChannelInfo info{ &output, 0, count };
+                      echo.getNextAudioBlock(info);
+                  });
+    }
+
+    {
+        juce::MemoryAudioSource memory{ input, false, true };
+        DJFilter filter{ &memory };
+        filter.setResonance(0.5f);
+        filter.prepareToPlay(options.blockSize, options.sampleRate);
+        // a slow sweep across both sides, so every block interpolates
+        float knob{ -1.0f };
+        bench.run("filter sweep", numSamples,
+                  [&output, &filter, &knob](juce::int64, int count)
+                  {
+                      knob = knob < 1.0f ? knob + 0.001f : -1.0f;
+                      filter.setPosition(knob);
+                      juce::AudioSourceChannelInfo info{ &output, 0, count };
+                      filter.getNextAudioBlock(info);
+                  });
+    }
+
+    return bench.finish();
+}
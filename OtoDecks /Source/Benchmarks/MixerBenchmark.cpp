@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    MixerBenchmark.cpp
+    Created: 3 May 2024 9:08:37pm
+    Author:  Kirby Loh
+
+    Times a whole engine block: two decks playing decoded tracks through the
+    full deck chain into the mixer, at normal speed, pitched up, during an
+    equal power crossfade, and with a dozen sample pads fired every block.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "SamplePads.h"
+#include "TrackFingerprint.h"
+#include "TrackPrefetcher.h"
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    constexpr const char* secondInput{ "stomper_reggae_bit.mp3" };
+    constexpr const char* padInputs[]{ "bleep_2.mp3", "bleep_10.mp3", "hard.mp3" };
+    constexpr int padsPerBlock{ 12 };
+
+    /**Waits until the prefetcher has decoded the track, so the decks never read from disk*/
+    bool waitForDecode(TrackPrefetcher& prefetcher, juce::uint64 fingerprint)
+    {
+        for (int waited = 0; waited < 600; ++waited)
+        {
+            if (prefetcher.find(fingerprint) != nullptr)
+            {
+                return true;
+            }
+            juce::Thread::sleep(100);
+        }
+        return false;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Benchmark bench{ "mixer", argc, argv };
+    const Benchmark::Options& options{ bench.getOptions() };
+    juce::AudioFormatManager& formatManager{ bench.getFormatManager() };
+
+    const juce::File files[]{ options.tracksDirectory.getChildFile(Benchmark::defaultInput),
+                              options.tracksDirectory.getChildFile(secondInput) };
+    TrackPrefetcher prefetcher{ formatManager, nullptr };
+    std::vector<TrackPrefetcher::Candidate> candidates;
+    for (const juce::File& file : files)
+    {
+        candidates.push_back({ TrackFingerprint::compute(file), file });
+    }
+    prefetcher.setCandidates(candidates);
+
+    // offline decks, like the replay renders, so no pre-roll thread runs beside the timing
+    DJAudioPlayer deck1{ formatManager, false };
+    DJAudioPlayer deck2{ formatManager, false };
+    DJAudioPlayer* decks[]{ &deck1, &deck2 };
+    DeckMixer mixer;
+    SamplePads pads{ formatManager };
+    for (int pad = 0; pad < (int) std::size(padInputs); ++pad)
+    {
+        if (!pads.loadPad(pad, options.tracksDirectory.getChildFile(padInputs[pad])))
+        {
+            std::cerr << "mixer: could not read " << padInputs[pad] << std::endl;
+            return 1;
+        }
+    }
+    mixer.setSamplePads(&pads);
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (!waitForDecode(prefetcher, candidates[i].fingerprint))
+        {
+            std::cerr << "mixer: could not decode " << candidates[i].file.getFullPathName() << std::endl;
+            return 1;
+        }
+        decks[i]->setPrefetcher(&prefetcher);
+        decks[i]->loadURL(juce::URL{ candidates[i].file }, candidates[i].fingerprint);
+        mixer.addDeck(decks[i]);
+    }
+    mixer.prepareToPlay(options.blockSize, options.sampleRate);
+    deck1.play();
+    deck2.play();
+
+    const juce::int64 numSamples{ (juce::int64) (options.seconds * options.sampleRate) };
+    // master and cue bus, as the device is opened
+    juce::AudioBuffer<float> output{ 4, options.blockSize };
+    const auto render = [&output, &mixer](juce::int64, int count)
+    {
+        mixer.getNextAudioBlock(juce::AudioSourceChannelInfo{ &output, 0, count });
+    };
+
+    bench.run("two decks", numSamples, render);
+
+    deck1.setSpeed(1.06);
+    deck2.setSpeed(1.06);
+    bench.run("two decks at x1.06", numSamples, render);
+    deck1.setSpeed(1.0);
+    deck2.setSpeed(1.0);
+
+    deck2.setCueEnabled(true);
+    bench.run("two decks, one on the cue bus", numSamples, render);
+    deck2.setCueEnabled(false);
+
+    // one fade across the warm-up and every timed pass, so each block ramps
+    mixer.scheduleCrossfade(&deck1, &deck2, mixer.getSamplePosition(), numSamples * (options.repeats + 1));
+    bench.run("two decks crossfading", numSamples, render);
+
+    // a dozen triggers a block soon fill the voice pool, so voices are stolen every block
+    const auto renderWithPads = [&pads, &mixer, &render](juce::int64 start, int count)
+    {
+        for (int i = 0; i < padsPerBlock; ++i)
+        {
+            pads.trigger(i % (int) std::size(padInputs), mixer.getSamplePosition());
+        }
+        render(start, count);
+    };
+    bench.run("two decks and a dozen pads a block", numSamples, renderWithPads);
+
+    mixer.releaseResources();
+    return bench.finish();
+}
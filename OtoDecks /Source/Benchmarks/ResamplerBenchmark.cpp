@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    ResamplerBenchmark.cpp
+    Created: 3 May 2024 8:40:19pm
+    Author:  Kirby Loh
+
+    Times the resampling a deck does: the transport converting the track to
+    the device rate, the speed stage on its own at several ratios, both in
+    series the way the deck chain used to run them, and the single pass that
+    folds the rate conversion into the speed stage the way it runs now.
+
+  ==============================================================================
+*/
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include "Benchmark.h"
+
+int main(int argc, char* argv[])
+{
+    Benchmark bench{ "resampler", argc, argv };
+    const Benchmark::Options& options{ bench.getOptions() };
+
+    juce::AudioBuffer<float> input;
+    double inputRate{ 0 };
+    if (!bench.loadInput(Benchmark::defaultInput, input, inputRate))
+    {
+        return bench.finish();
+    }
+
+    const juce::int64 numSamples{ (juce::int64) (options.seconds * options.sampleRate) };
+    juce::AudioBuffer<float> output{ 2, options.blockSize };
+    const auto renderFrom = [&output](juce::AudioSource& source)
+    {
+        return [&output, &source](juce::int64, int count)
+        {
+            juce::AudioSourceChannelInfo info{ &output, 0, count };
+            source.getNextAudioBlock(info);
+        };
+    };
+    const juce::String rates{ juce::String(inputRate, 0) + " to " + juce::String(options.sampleRate, 0) };
+
+    {
+        // the memory source loops, so every pass has audio
+        juce::MemoryAudioSource memory{ input, false, true };
+        juce::AudioTransportSource transport;
+        transport.setSource(&memory, 0, nullptr, inputRate);
+        transport.prepareToPlay(options.blockSize, options.sampleRate);
+        transport.start();
+        bench.run("rate conversion " + rates, numSamples, renderFrom(transport));
+        transport.setSource(nullptr);
+    }
+
+    for (double speed : { 0.5, 0.94, 1.0, 1.06, 2.0 })
+    {
+        juce::MemoryAudioSource memory{ input, false, true };
+        juce::ResamplingAudioSource resampler{ &memory, false, 2 };
+        resampler.setResamplingRatio(speed);
+        resampler.prepareToPlay(options.blockSize, options.sampleRate);
+        bench.run("speed x" + juce::String(speed, 2), numSamples, renderFrom(resampler));
+    }
+
+    for (double speed : { 1.0, 1.06 })
+    {
+        juce::MemoryAudioSource memory{ input, false, true };
+        juce::AudioTransportSource transport;
+        transport.setSource(&memory, 0, nullptr, inputRate);
+        juce::ResamplingAudioSource resampler{ &transport, false, 2 };
+        resampler.setResamplingRatio(speed);
+        resampler.prepareToPlay(options.blockSize, options.sampleRate);
+        transport.start();
+        bench.run("two passes " + rates + " at x" + juce::String(speed, 2), numSamples, renderFrom(resampler));
+        transport.setSource(nullptr);
+    }
+
+    for (double speed : { 1.0, 1.06 })
+    {
+        // the transport runs at the track rate and the speed stage converts to the device rate
+        juce::MemoryAudioSource memory{ input, false, true };
+        juce::AudioTransportSource transport;
+        transport.setSource(&memory);
+        juce::ResamplingAudioSource resampler{ &transport, false, 2 };
+        resampler.setResamplingRatio(speed * inputRate / options.sampleRate);
+        resampler.prepareToPlay(options.blockSize, options.sampleRate);
+        transport.prepareToPlay(options.blockSize, inputRate);
+        transport.start();
+        bench.run("deck chain " + rates + " at x" + juce::String(speed, 2), numSamples, renderFrom(resampler));
+        transport.setSource(nullptr);
+    }
+
+    return bench.finish();
+}
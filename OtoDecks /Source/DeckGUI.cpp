@@ -13,13 +13,18 @@
 
 //==============================================================================
 DeckGUI::DeckGUI(int _id,
-                 DJAudioPlayer* _player,
-                 juce::AudioFormatManager& formatManager,
-                 juce::AudioThumbnailCache& thumbCache
+                 OtoEngine& _engine,
+                 juce::AudioThumbnailCache& thumbCache,
+                 TapAnalyser& tapAnalyser
                  ) 
 : id(_id),
-player(_player),
-waveformDisplay(id, formatManager, thumbCache)
+engine(_engine),
+player(&_engine.getDeck(_id - 1)),
+syncSource(nullptr),
+scratching(false),
+lastScratchX(0),
+waveformDisplay(id, _engine.getFormatManager(), thumbCache, _engine.getAnalyser()),
+levelMeter(tapAnalyser, _id - 1)
 {
     // add all components and make visible
     addAndMakeVisible(playButton);
@@ -38,7 +43,25 @@ waveformDisplay(id, formatManager, thumbCache)
     addAndMakeVisible(wetLevelLabel);
     addAndMakeVisible(dryLevelSlider);
     addAndMakeVisible(dryLevelLabel);
+    addAndMakeVisible(filterSlider);
+    addAndMakeVisible(filterLabel);
+    addAndMakeVisible(resonanceSlider);
+    addAndMakeVisible(resonanceLabel);
+    addAndMakeVisible(echoBeatsBox);
+    addAndMakeVisible(echoBeatsLabel);
+    addAndMakeVisible(echoLevelSlider);
+    addAndMakeVisible(echoLevelLabel);
+    addAndMakeVisible(echoFeedbackSlider);
+    addAndMakeVisible(echoFeedbackLabel);
     addAndMakeVisible(waveformDisplay);
+    addAndMakeVisible(levelMeter);
+    waveformDisplay.addMouseListener(this, false);
+    addAndMakeVisible(cueButton);
+    addAndMakeVisible(quantiseButton);
+    for (juce::TextButton& hotCueButton : hotCueButtons)
+    {
+        addAndMakeVisible(hotCueButton);
+    }
 
     // add listeners
     playButton.addListener(this);
@@ -52,6 +75,16 @@ waveformDisplay(id, formatManager, thumbCache)
     posSlider.addListener(this);
     wetLevelSlider.addListener(this);
     dryLevelSlider.addListener(this);
+    filterSlider.addListener(this);
+    resonanceSlider.addListener(this);
+    echoLevelSlider.addListener(this);
+    echoFeedbackSlider.addListener(this);
+    cueButton.addListener(this);
+    quantiseButton.addListener(this);
+    for (juce::TextButton& hotCueButton : hotCueButtons)
+    {
+        hotCueButton.addListener(this);
+    }
     
     // Set the background color for play button
     playButton.setColour(juce::TextButton::buttonColourId, juce::Colours::blue);
@@ -65,6 +98,21 @@ waveformDisplay(id, formatManager, thumbCache)
     loopEndButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkviolet);
     // Set the background color for end loop button
     loopRemoveButton.setColour(juce::TextButton::buttonColourId, juce::Colours::darkorchid);
+    // Set the text for the hot cue buttons, colours follow the cue state
+    for (int i = 0; i < HotCuePreroll::numHotCues; ++i)
+    {
+        hotCueButtons[i].setButtonText("CUE " + juce::String(i + 1));
+        hotCueButtons[i].setTooltip("Click to set or jump to the cue, shift-click to remove it");
+    }
+    updateHotCueButtons();
+    // Set the cue button to toggle, lit while the deck is in the headphones
+    cueButton.setClickingTogglesState(true);
+    cueButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::springgreen);
+    cueButton.setTooltip("Send this deck to the headphone cue outputs 3/4");
+    // Set the quantise button to toggle, play then waits for the other deck's next bar
+    quantiseButton.setClickingTogglesState(true);
+    quantiseButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::orange);
+    quantiseButton.setTooltip("Start on the next bar of the other deck");
 
     //configure volume slider and label
     double volDefaultValue = 0.5;
@@ -135,19 +183,72 @@ waveformDisplay(id, formatManager, thumbCache)
     
     dryLevelLabel.setText("Dry Level", juce::dontSendNotification);
     dryLevelLabel.attachToComponent(&dryLevelSlider, false);
+
+    //configure filter knob and label, low-pass to the left and high-pass to the right
+    filterSlider.setRange(-1.0, 1.0);
+    filterSlider.setValue(0.0);
+    filterSlider.setDoubleClickReturnValue(true, 0.0);
+    filterSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    filterSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    filterSlider.setTooltip("Low-pass to the left, high-pass to the right, double-click for off");
+
+    filterLabel.setText("Filter", juce::dontSendNotification);
+    filterLabel.attachToComponent(&filterSlider, true);
+    //configure resonance knob and label
+    resonanceSlider.setRange(0.0, 1.0);
+    resonanceSlider.setValue(0.0);
+    resonanceSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    resonanceSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+
+    resonanceLabel.setText("Res", juce::dontSendNotification);
+    resonanceLabel.attachToComponent(&resonanceSlider, true);
+
+    //configure echo length, level and feedback, the length is in beats of the track
+    const juce::StringArray echoBeatNames{ "1/8", "1/4", "1/2", "3/4", "1", "2", "4" };
+    for (int i = 0; i < echoBeatNames.size(); ++i)
+    {
+        echoBeatsBox.addItem(echoBeatNames[i] + " beat", i + 1);
+    }
+    echoBeatsBox.onChange = [this]
+    {
+        constexpr double beats[]{ 0.125, 0.25, 0.5, 0.75, 1.0, 2.0, 4.0 };
+        DBG("Echo length changed " << echoBeatsBox.getText());
+        player->setEchoBeats(beats[echoBeatsBox.getSelectedItemIndex()]);
+    };
+    echoBeatsBox.setSelectedItemIndex(2);
+    echoBeatsLabel.setText("Echo", juce::dontSendNotification);
+    echoBeatsLabel.attachToComponent(&echoBeatsBox, true);
+
+    echoLevelSlider.setRange(0.0, 1.0);
+    echoLevelSlider.setValue(0.0);
+    echoLevelSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    echoLevelSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    echoLevelSlider.setTooltip("Level of the echoes, all the way down turns the echo off");
+    echoLevelLabel.setText("Level", juce::dontSendNotification);
+    echoLevelLabel.attachToComponent(&echoLevelSlider, true);
+
+    echoFeedbackSlider.setRange(0.0, 0.95);
+    echoFeedbackSlider.setValue(0.4);
+    echoFeedbackSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+    echoFeedbackSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+    echoFeedbackLabel.setText("Repeats", juce::dontSendNotification);
+    echoFeedbackLabel.attachToComponent(&echoFeedbackSlider, true);
     
     //set colours for sliders
     getLookAndFeel().setColour(juce::Slider::thumbColourId, juce::Colours::springgreen); //dial
     getLookAndFeel().setColour(juce::Slider::trackColourId, juce::Colours::slategrey); //body
     getLookAndFeel().setColour(juce::Slider::rotarySliderFillColourId, juce::Colours::slategrey); //body
     
-    loopEnabled = false;
-    startTimer(500);
+    // loads from the playlist or the auto DJ reach the waveform through the engine
+    engine.addListener(this);
+    // fast enough for the playhead to follow a scratch
+    startTimerHz(30);
 }
 
 DeckGUI::~DeckGUI()
 {
     stopTimer();
+    engine.removeListener(this);
 }
 
 void DeckGUI::paint (juce::Graphics& g)
@@ -167,7 +268,18 @@ void DeckGUI::resized()
      /*This method is where you should set the bounds of any child
      components that your component contains..*/
     //                   x start, y start, width, height
-    waveformDisplay.setBounds(0, 0, getWidth(), 3 * getHeight() / 8);
+    waveformDisplay.setBounds(0, 0, getWidth(), 5 * getHeight() / 16);
+    // hot cues share a row with the headphone cue and quantise buttons
+    const int numCueSlots{ HotCuePreroll::numHotCues + 2 };
+    for (int i = 0; i < HotCuePreroll::numHotCues; ++i)
+    {
+        hotCueButtons[i].setBounds(i * getWidth() / numCueSlots, 5 * getHeight() / 16,
+                                   getWidth() / numCueSlots, getHeight() / 16);
+    }
+    cueButton.setBounds(HotCuePreroll::numHotCues * getWidth() / numCueSlots, 5 * getHeight() / 16,
+                        getWidth() / numCueSlots, getHeight() / 16);
+    quantiseButton.setBounds((HotCuePreroll::numHotCues + 1) * getWidth() / numCueSlots, 5 * getHeight() / 16,
+                             getWidth() / numCueSlots, getHeight() / 16);
     // buttons
     playButton.setBounds(2 * getWidth() / 4, 3 * getHeight() / 8, getWidth() / 4, getHeight() / 8);
     stopButton.setBounds(2 * getWidth() / 4, 4 * getHeight() / 8, getWidth() / 4, getHeight() / 8);
@@ -175,6 +287,15 @@ void DeckGUI::resized()
     loopStartButton.setBounds(3 * getWidth() / 4, 3 * getHeight() / 8, getWidth() / 4, getHeight() / 8);
     loopEndButton.setBounds(3 * getWidth() / 4, 4 * getHeight() / 8, getWidth() / 4, getHeight() / 8);
     loopRemoveButton.setBounds(3 * getWidth() / 4, 5 * getHeight() / 8, getWidth() / 4, getHeight() / 8);
+    // echo row under the buttons
+    echoBeatsBox.setBounds(getWidth() / 2 + 46, 6 * getHeight() / 8 + 5, getWidth() / 9, getHeight() / 8 - 10);
+    echoLevelSlider.setBounds(74 * getWidth() / 100, 6 * getHeight() / 8, getWidth() / 16, getHeight() / 8);
+    echoFeedbackSlider.setBounds(89 * getWidth() / 100, 6 * getHeight() / 8, getWidth() / 16, getHeight() / 8);
+    // the meter sits left of the volume fader's label
+    levelMeter.setBounds(4, 4 * getHeight() / 8, 10, getHeight() / 3);
+    // filter knobs above the reverb, clear of the slider labels
+    filterSlider.setBounds(5 * getWidth() / 16, 3 * getHeight() / 8, getWidth() / 12, getHeight() / 8 - 20);
+    resonanceSlider.setBounds(7 * getWidth() / 16, 3 * getHeight() / 8, getWidth() / 24, getHeight() / 8 - 20);
     // sliders
     volSlider.setBounds(getWidth() / 11 , 4 * getHeight() / 8, getWidth() / 16, getHeight() / 3);
     speedSlider.setBounds(3.5 * getWidth() / 10, 4 * getHeight() / 8, getWidth() / 6, getHeight() / 3);
@@ -188,7 +309,19 @@ void DeckGUI::buttonClicked(juce::Button* button)
     if (button == &playButton)
     {
         DBG("Play button was clicked ");
-        player->play();
+        juce::int64 downbeat{ -1 };
+        if (quantiseButton.getToggleState() && syncSource != nullptr)
+        {
+            downbeat = syncSource->getNextDownbeat();
+        }
+        if (downbeat >= 0)
+        {
+            player->playAt(downbeat);
+        }
+        else
+        {
+            player->play();
+        }
     }
     if (button == &stopButton)
     {
@@ -201,15 +334,15 @@ void DeckGUI::buttonClicked(juce::Button* button)
         juce::FileChooser chooser{"Select a file"};
         if (chooser.browseForFileToOpen())
         {
-            loadFile(juce::URL{ chooser.getResult() });
+            engine.loadTrack(id - 1, juce::URL{ chooser.getResult() });
         }
     }
     if(button == &loopStartButton)
     {
         DBG("Start Loop Button was clicked ");
-        if (!loopEnabled) 
+        if (!player->isLooping()) 
         {
-            loopStartPosition = player->getPositionRelative(); // Store the loop start
+            player->setLoopStart(player->getPositionRelative()); // Store the loop start
         } 
         else
         {
@@ -224,16 +357,38 @@ void DeckGUI::buttonClicked(juce::Button* button)
     if(button == &loopEndButton)
     {
         DBG("End Loop Button was clicked ");
-        loopEndPosition = player->getPositionRelative();
-        if(loopEndPosition > loopStartPosition)
-        {
-            loopEnabled = true; // Enable looping when loop end is set
-        }
+        // the player enables looping when the end is after the start
+        player->setLoopEnd(player->getPositionRelative());
     }
     if(button == &loopRemoveButton)
     {
         DBG("Remove Loop Button was clicked ");
-        loopEnabled = false;
+        player->removeLoop();
+    }
+    if (button == &cueButton)
+    {
+        DBG("PFL Button was clicked ");
+        player->setCueEnabled(cueButton.getToggleState());
+    }
+    for (int i = 0; i < HotCuePreroll::numHotCues; ++i)
+    {
+        if (button == &hotCueButtons[i])
+        {
+            DBG("Hot Cue " << i + 1 << " Button was clicked ");
+            if (juce::ModifierKeys::currentModifiers.isShiftDown())
+            {
+                player->clearHotCue(i);
+            }
+            else if (player->hasHotCue(i))
+            {
+                player->triggerHotCue(i);
+            }
+            else
+            {
+                player->setHotCue(i);
+            }
+            updateHotCueButtons();
+        }
     }
     
 }
@@ -266,6 +421,26 @@ void DeckGUI::sliderValueChanged(juce::Slider* slider)
         DBG("Dry Level slider moved " << slider->getValue());
         player->setReverbDryLevel(slider->getValue());
     }
+    if (slider == &filterSlider)
+    {
+        DBG("Filter knob moved " << slider->getValue());
+        player->setFilter(slider->getValue());
+    }
+    if (slider == &resonanceSlider)
+    {
+        DBG("Resonance knob moved " << slider->getValue());
+        player->setFilterResonance(slider->getValue());
+    }
+    if (slider == &echoLevelSlider)
+    {
+        DBG("Echo level knob moved " << slider->getValue());
+        player->setEchoLevel(slider->getValue());
+    }
+    if (slider == &echoFeedbackSlider)
+    {
+        DBG("Echo feedback knob moved " << slider->getValue());
+        player->setEchoFeedback(slider->getValue());
+    }
 }
 
 bool DeckGUI::isInterestedInFileDrag(const juce::StringArray& files)
@@ -282,35 +457,72 @@ void DeckGUI::filesDropped(const juce::StringArray& files, int x, int y)
         + "x and " + std::to_string(y) + "y" );
     if (files.size() == 1)
     {
-        loadFile(juce::URL{ juce::File{files[0]} });
+        engine.loadTrack(id - 1, juce::URL{ juce::File{files[0]} });
     }
 }
 
-void DeckGUI::loadFile(juce::URL audioURL)
+void DeckGUI::trackLoaded(int deck, const juce::URL& audioURL, juce::uint64 fingerprint)
 {
-    DBG("DeckGUI::loadFile called");
-    player->loadURL(audioURL);
-    waveformDisplay.loadURL(audioURL);
+    if (deck != id - 1)
+    {
+        return;
+    }
+    DBG("DeckGUI::trackLoaded called");
+    waveformDisplay.loadURL(audioURL, fingerprint);
+    updateHotCueButtons();
+}
+
+void DeckGUI::updateHotCueButtons()
+{
+    for (int i = 0; i < HotCuePreroll::numHotCues; ++i)
+    {
+        hotCueButtons[i].setColour(juce::TextButton::buttonColourId,
+                                   player->hasHotCue(i) ? juce::Colours::gold : juce::Colours::darkgrey);
+    }
 }
 
 void DeckGUI::timerCallback()
 {
-    if (loopEnabled && player->getPositionRelative() >= loopEndPosition)
-        {
-            player->setPositionRelative(loopStartPosition);
-            player->play();
-        }
     //check if the relative position is greater than 0
     //otherwise loading file causes error
     if (player->getPositionRelative() > 0)
     {
         waveformDisplay.setPositionRelative(player->getPositionRelative());
     }
-    //check if the relative position is greater than or equal to 1
-    //then loop the audio back to the beginning
-    if(player->getPositionRelative() >= 1)
+    // loops and repeating the track are handled by the player on the audio thread,
+    // the engine stores cues set here or on a controller
+    updateHotCueButtons();
+}
+
+void DeckGUI::setSyncSource(DJAudioPlayer* _syncSource)
+{
+    syncSource = _syncSource;
+}
+
+void DeckGUI::mouseDown(const juce::MouseEvent& event)
+{
+    if (event.eventComponent == &waveformDisplay)
+    {
+        scratching = player->beginScratch();
+        lastScratchX = event.x;
+    }
+}
+
+void DeckGUI::mouseDrag(const juce::MouseEvent& event)
+{
+    if (scratching && event.eventComponent == &waveformDisplay)
+    {
+        // dragging right pushes the record forwards
+        player->scratch((event.x - lastScratchX) * scratchSecondsPerPixel);
+        lastScratchX = event.x;
+    }
+}
+
+void DeckGUI::mouseUp(const juce::MouseEvent& event)
+{
+    if (scratching)
     {
-        player->setPositionRelative(0);
-        player->play();
+        player->endScratch();
+        scratching = false;
     }
 }
@@ -11,8 +11,10 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "DJAudioPlayer.h"
+#include <array>
+#include "Engine/OtoEngine.h"
 #include "WaveformDisplay.h"
+#include "LevelMeter.h"
 
 //==============================================================================
 /*
@@ -21,13 +23,15 @@ class DeckGUI  : public juce::Component,
                  public juce::Button::Listener,
                  public juce::Slider::Listener,
                  public juce::FileDragAndDropTarget,
-                 public juce::Timer
+                 public juce::Timer,
+                 public OtoEngine::Listener
 {
 public:
+    /**Shows deck 1 or 2 of the engine*/
     DeckGUI(int _id,
-            DJAudioPlayer* player,
-            juce::AudioFormatManager& formatManager,
-            juce::AudioThumbnailCache& thumbCache);
+            OtoEngine& _engine,
+            juce::AudioThumbnailCache& thumbCache,
+            TapAnalyser& tapAnalyser);
     ~DeckGUI() override;
 
     void paint (juce::Graphics&) override;
@@ -43,9 +47,21 @@ public:
     void filesDropped(const juce::StringArray &files, int x, int y) override;
     /**Listen for changes to the waveform*/
     void timerCallback() override;
+    /**Dragging the waveform scratches the track like a platter*/
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
+    /**Sets the deck that quantised starts line up with*/
+    void setSyncSource(DJAudioPlayer* _syncSource);
+    /**Shows the waveform and cues of a track loaded onto this deck, from here or elsewhere*/
+    void trackLoaded(int deck, const juce::URL& audioURL, juce::uint64 fingerprint) override;
 
 private:
     int id;
+    /**seconds of track one pixel of waveform drag moves the platter*/
+    static constexpr double scratchSecondsPerPixel{ 0.004 };
+    bool scratching;
+    int lastScratchX;
     
     juce::TextButton playButton{ "PLAY" };
     juce::TextButton stopButton{ "STOP" };
@@ -53,6 +69,9 @@ private:
     juce::TextButton loopStartButton{ "START LOOP" };
     juce::TextButton loopEndButton{ "END LOOP" };
     juce::TextButton loopRemoveButton{ "REMOVE LOOP" };
+    std::array<juce::TextButton, HotCuePreroll::numHotCues> hotCueButtons;
+    juce::TextButton cueButton{ "PFL" };
+    juce::TextButton quantiseButton{ "Q" };
     juce::Slider volSlider;
     juce::Label volLabel;
     juce::Slider speedSlider;
@@ -63,18 +82,26 @@ private:
     juce::Label wetLevelLabel;
     juce::Slider dryLevelSlider;
     juce::Label dryLevelLabel;
-    
-    bool loopEnabled;
-    double loopStartPosition;
-    double loopEndPosition;
+    juce::Slider filterSlider;
+    juce::Label filterLabel;
+    juce::Slider resonanceSlider;
+    juce::Label resonanceLabel;
+    juce::ComboBox echoBeatsBox;
+    juce::Label echoBeatsLabel;
+    juce::Slider echoLevelSlider;
+    juce::Label echoLevelLabel;
+    juce::Slider echoFeedbackSlider;
+    juce::Label echoFeedbackLabel;
 
-    void loadFile(juce::URL audioURL);
+    /**Colours the hot cue buttons by whether their cue is set, from the buttons or a controller*/
+    void updateHotCueButtons();
 
+    OtoEngine& engine;
     DJAudioPlayer* player;
+    DJAudioPlayer* syncSource;
     WaveformDisplay waveformDisplay;
+    LevelMeter levelMeter;
     juce::SharedResourcePointer< juce::TooltipWindow > sharedTooltip;
 
-    friend class PlaylistComponent;
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckGUI)
 };
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    AnalysisTap.cpp
+    Created: 5 May 2024 7:46:18pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "AnalysisTap.h"
+
+//==============================================================================
+AnalysisTap::AnalysisTap() : fifoBuffer(numChannels, fifoSize),
+                             sampleRate(0)
+{
+}
+
+AnalysisTap::~AnalysisTap()
+{
+}
+
+void AnalysisTap::prepareToPlay(double _sampleRate)
+{
+    sampleRate = _sampleRate;
+}
+
+void AnalysisTap::pushBlock(const juce::AudioBuffer<float>& buffer, int firstChannel, int startSample, int numSamples)
+{
+    if (fifo.getFreeSpace() < numSamples)
+    {
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        // mono sources show the same signal on both sides
+        int source{ juce::jmin(firstChannel + ch, buffer.getNumChannels() - 1) };
+        if (size1 > 0)
+            fifoBuffer.copyFrom(ch, start1, buffer, source, startSample, size1);
+        if (size2 > 0)
+            fifoBuffer.copyFrom(ch, start2, buffer, source, startSample + size1, size2);
+    }
+    fifo.finishedWrite(size1 + size2);
+}
+
+int AnalysisTap::pull(juce::AudioBuffer<float>& destination, int maxSamples)
+{
+    const int numSamples{ juce::jmin(maxSamples, destination.getNumSamples(), fifo.getNumReady()) };
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const int target{ juce::jmin(ch, destination.getNumChannels() - 1) };
+        if (size1 > 0)
+            destination.copyFrom(target, 0, fifoBuffer, ch, start1, size1);
+        if (size2 > 0)
+            destination.copyFrom(target, size1, fifoBuffer, ch, start2, size2);
+    }
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+double AnalysisTap::getSampleRate() const
+{
+    return sampleRate.load();
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    AnalysisTap.h
+    Created: 5 May 2024 7:46:18pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+
+//==============================================================================
+/*
+    A copy of one stereo signal for the meters and the spectrum. The audio
+    thread copies every block into a fixed size wait-free FIFO and never does
+    any analysis itself; a reader on another thread drains it at display rate.
+    If nobody reads, new blocks are dropped once the FIFO is full.
+*/
+class AnalysisTap
+{
+public:
+    /**Capacity of the FIFO, about a third of a second at 48kHz*/
+    static constexpr int fifoSize{ 1 << 14 };
+    static constexpr int numChannels{ 2 };
+
+    AnalysisTap();
+    ~AnalysisTap();
+
+    /**Tells the tap the rate of the signal, call from prepareToPlay*/
+    void prepareToPlay(double sampleRate);
+    /**Copies two channels of the block starting at firstChannel, safe on the audio thread*/
+    void pushBlock(const juce::AudioBuffer<float>& buffer, int firstChannel, int startSample, int numSamples);
+    /**Moves up to maxSamples of each channel into destination, returns how many. One reader only*/
+    int pull(juce::AudioBuffer<float>& destination, int maxSamples);
+
+    double getSampleRate() const;
+
+private:
+    juce::AbstractFifo fifo{ fifoSize };
+    juce::AudioBuffer<float> fifoBuffer;
+    std::atomic<double> sampleRate;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisTap)
+};
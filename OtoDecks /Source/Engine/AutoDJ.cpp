@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    AutoDJ.cpp
+    Created: 28 Apr 2024 6:37:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "AutoDJ.h"
+
+//==============================================================================
+AutoDJ::AutoDJ(DeckMixer& _mixer,
+               DJAudioPlayer* _player1,
+               DJAudioPlayer* _player2
+              ) : mixer(_mixer),
+                  players{ _player1, _player2 },
+                  source(nullptr),
+                  enabled(false),
+                  crossfadeSeconds(defaultCrossfadeSeconds),
+                  activeDeck(0),
+                  nextTrackLoaded(false),
+                  transitionScheduled(false),
+                  transitionEnd(0),
+                  lastEnginePosition(-1)
+{
+}
+
+AutoDJ::~AutoDJ()
+{
+    stopTimer();
+}
+
+void AutoDJ::setSource(Source* _source)
+{
+    source = _source;
+}
+
+void AutoDJ::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == enabled)
+    {
+        return;
+    }
+    enabled = shouldBeEnabled;
+    if (!enabled)
+    {
+        // a transition already handed to the engine still plays out
+        stopTimer();
+        return;
+    }
+
+    // mix out of whatever is playing, the other deck gets the queue
+    activeDeck = !players[0]->isPlaying() && players[1]->isPlaying() ? 1 : 0;
+    nextTrackLoaded = false;
+    transitionScheduled = false;
+    lastEnginePosition = -1;
+    startTimer(250);
+}
+
+bool AutoDJ::isEnabled() const
+{
+    return enabled;
+}
+
+void AutoDJ::setCrossfadeSeconds(double seconds)
+{
+    if (seconds <= 0)
+    {
+        DBG("AutoDJ::setCrossfadeSeconds the crossfade needs a length");
+        return;
+    }
+    crossfadeSeconds = seconds;
+}
+
+double AutoDJ::getCrossfadeSeconds() const
+{
+    return crossfadeSeconds;
+}
+
+void AutoDJ::timerCallback()
+{
+    // nothing moves while the device is stopped, so neither does the queue
+    const juce::int64 now{ mixer.getSamplePosition() };
+    if (source == nullptr || now == lastEnginePosition)
+    {
+        return;
+    }
+    lastEnginePosition = now;
+
+    if (transitionScheduled)
+    {
+        if (now < transitionEnd)
+        {
+            return;
+        }
+        // the incoming deck is on air, the old one is free for the next track
+        activeDeck = 1 - activeDeck;
+        transitionScheduled = false;
+        nextTrackLoaded = false;
+    }
+
+    const int idleDeck{ 1 - activeDeck };
+    if (!players[activeDeck]->isPlaying())
+    {
+        // nothing on air, start the next track straight away
+        if (nextTrackLoaded || source->loadNextTrack(idleDeck))
+        {
+            players[idleDeck]->play();
+            activeDeck = idleDeck;
+            nextTrackLoaded = false;
+        }
+        return;
+    }
+
+    if (!nextTrackLoaded)
+    {
+        nextTrackLoaded = source->loadNextTrack(idleDeck);
+    }
+    if (nextTrackLoaded)
+    {
+        scheduleTransition();
+    }
+}
+
+void AutoDJ::scheduleTransition()
+{
+    DJAudioPlayer* outgoing{ players[activeDeck] };
+    DJAudioPlayer* incoming{ players[1 - activeDeck] };
+    const double rate{ outgoing->getDeviceSampleRate() };
+    juce::int64 mixStart{ outgoing->getMixPoint(crossfadeSeconds) };
+    const juce::int64 now{ mixer.getSamplePosition() };
+    if (mixStart < 0 || rate <= 0 || mixStart - now > (juce::int64) (planAheadSeconds * rate))
+    {
+        return;
+    }
+
+    mixStart = juce::jmax(mixStart, now + (juce::int64) (startMarginSeconds * rate));
+    const juce::int64 fadeSamples{ (juce::int64) (crossfadeSeconds * rate) };
+    if (!mixer.scheduleCrossfade(outgoing, incoming, mixStart, fadeSamples))
+    {
+        return;
+    }
+    // the incoming track starts on the bar line, its own grid starts with it
+    incoming->playAt(mixStart);
+    outgoing->stopAt(mixStart + fadeSamples);
+    transitionScheduled = true;
+    transitionEnd = mixStart + fadeSamples;
+    DBG("AutoDJ scheduled a crossfade from engine sample " << mixStart);
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    AutoDJ.h
+    Created: 28 Apr 2024 6:37:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include <array>
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+
+//==============================================================================
+/*
+    Plays a queue of tracks without a DJ. The next track is loaded onto the
+    idle deck while the other one plays, and a few seconds before the mix
+    point the whole transition is handed to the engine: the idle deck starts
+    on the bar line where the crossfade begins, the mixer fades between the
+    decks and the old deck stops when the fade ends. All three happen on
+    exact engine samples, so the timer only has to plan ahead in time.
+*/
+class AutoDJ : private juce::Timer
+{
+public:
+    /**Supplies the queued tracks, implemented by the playlist*/
+    class Source
+    {
+    public:
+        virtual ~Source() = default;
+        /**Loads the next queued track onto deck 0 or 1, returns false if the queue is empty*/
+        virtual bool loadNextTrack(int deck) = 0;
+    };
+
+    static constexpr double defaultCrossfadeSeconds{ 8.0 };
+
+    AutoDJ(DeckMixer& _mixer, DJAudioPlayer* _player1, DJAudioPlayer* _player2);
+    ~AutoDJ() override;
+
+    void setSource(Source* _source);
+    /**Starts or stops mixing the queue, a deck already playing is mixed out of first*/
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+    /**Sets the length of the crossfades that are not scheduled yet*/
+    void setCrossfadeSeconds(double seconds);
+    double getCrossfadeSeconds() const;
+
+private:
+    void timerCallback() override;
+    /**Hands the next transition to the engine once its mix point is close enough*/
+    void scheduleTransition();
+
+    DeckMixer& mixer;
+    std::array<DJAudioPlayer*, 2> players;
+    Source* source;
+
+    bool enabled;
+    double crossfadeSeconds;
+    /**the deck on air, the other one is loaded with the next track*/
+    int activeDeck;
+    bool nextTrackLoaded;
+    bool transitionScheduled;
+    /**engine sample the scheduled crossfade ends on*/
+    juce::int64 transitionEnd;
+    /**engine clock at the last tick, to tell if the device is running*/
+    juce::int64 lastEnginePosition;
+
+    /**transitions are handed to the engine this close to the mix point, so earlier speed changes still move it*/
+    static constexpr double planAheadSeconds{ 4.0 };
+    /**a mix point already passed starts this far ahead so the commands arrive in time*/
+    static constexpr double startMarginSeconds{ 0.05 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AutoDJ)
+};
@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    BeatDelay.cpp
+    Created: 8 May 2024 7:52:14pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "BeatDelay.h"
+#include <cmath>
+
+namespace
+{
+    /**how long a new delay length takes to glide in*/
+    constexpr double timeRampSeconds{ 0.25 };
+    constexpr double levelRampSeconds{ 0.02 };
+    constexpr float maxFeedback{ 0.95f };
+}
+
+//==============================================================================
+BeatDelay::BeatDelay(juce::AudioSource* _input) : input(_input),
+                                                  beats(0.5),
+                                                  level(0),
+                                                  feedback(0.4f),
+                                                  writePosition(0),
+                                                  sampleRate(0),
+                                                  tempo(0)
+{
+}
+
+BeatDelay::~BeatDelay()
+{
+}
+
+void BeatDelay::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
+{
+    sampleRate = _sampleRate;
+    // room for the longest delay plus the sample the interpolation reads past it
+    lines.setSize(numChannels, (int) std::ceil(maxDelaySeconds * sampleRate) + 2);
+    lines.clear();
+    writePosition = 0;
+    delaySamples.reset(sampleRate, timeRampSeconds);
+    smoothedLevel.reset(sampleRate, levelRampSeconds);
+    smoothedFeedback.reset(sampleRate, levelRampSeconds);
+    delaySamples.setCurrentAndTargetValue((float) (beats * 60.0 / defaultBpm * sampleRate));
+    smoothedLevel.setCurrentAndTargetValue(level);
+    smoothedFeedback.setCurrentAndTargetValue(feedback);
+    input->prepareToPlay(samplesPerBlockExpected, _sampleRate);
+}
+
+void BeatDelay::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    input->getNextAudioBlock(bufferToFill);
+    const int lineLength{ lines.getNumSamples() };
+    if (lineLength == 0)
+    {
+        return;
+    }
+
+    const double bpm{ tempo > 0 ? tempo : defaultBpm };
+    const double seconds{ juce::jmin(beats * 60.0 / bpm, maxDelaySeconds) };
+    delaySamples.setTargetValue((float) juce::jlimit(1.0, (double) lineLength - 2, seconds * sampleRate));
+    smoothedLevel.setTargetValue(level);
+    smoothedFeedback.setTargetValue(feedback);
+
+    juce::AudioBuffer<float>& buffer{ *bufferToFill.buffer };
+    if (!smoothedLevel.isSmoothing() && smoothedLevel.getTargetValue() == 0)
+    {
+        // off, the lines keep the dry input so the first echoes are there when it comes on
+        writeOnly(buffer, bufferToFill.startSample, bufferToFill.numSamples);
+        delaySamples.skip(bufferToFill.numSamples);
+        return;
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+    const int bufferChannels{ buffer.getNumChannels() };
+    float* out[numChannels]{ buffer.getWritePointer(0, bufferToFill.startSample),
+                             buffer.getWritePointer(juce::jmin(1, bufferChannels - 1), bufferToFill.startSample) };
+    float* line[numChannels]{ lines.getWritePointer(0), lines.getWritePointer(1) };
+    for (int i = 0; i < bufferToFill.numSamples; ++i)
+    {
+        // fractional read so the delay can glide without stepping
+        const float delay{ delaySamples.getNextValue() };
+        const float gain{ smoothedLevel.getNextValue() };
+        const float fed{ smoothedFeedback.getNextValue() };
+        double readPosition{ writePosition - (double) delay };
+        if (readPosition < 0)
+        {
+            readPosition += lineLength;
+        }
+        const int index{ (int) readPosition };
+        const int next{ index + 1 == lineLength ? 0 : index + 1 };
+        const float fraction{ (float) (readPosition - index) };
+        for (int ch = 0; ch < juce::jmin(numChannels, bufferChannels); ++ch)
+        {
+            const float echo{ line[ch][index] + fraction * (line[ch][next] - line[ch][index]) };
+            const float dry{ out[ch][i] };
+            line[ch][writePosition] = dry + fed * echo;
+            out[ch][i] = dry + gain * echo;
+        }
+        if (++writePosition == lineLength)
+        {
+            writePosition = 0;
+        }
+    }
+}
+
+void BeatDelay::releaseResources()
+{
+    input->releaseResources();
+}
+
+void BeatDelay::setTempo(double bpm)
+{
+    tempo = bpm;
+}
+
+void BeatDelay::setBeats(double newBeats)
+{
+    beats = juce::jlimit(minBeats, maxBeats, newBeats);
+}
+
+double BeatDelay::getBeats() const
+{
+    return beats.load();
+}
+
+void BeatDelay::setLevel(float newLevel)
+{
+    level = juce::jlimit(0.0f, 1.0f, newLevel);
+}
+
+float BeatDelay::getLevel() const
+{
+    return level.load();
+}
+
+void BeatDelay::setFeedback(float newFeedback)
+{
+    feedback = juce::jlimit(0.0f, maxFeedback, newFeedback);
+}
+
+float BeatDelay::getFeedback() const
+{
+    return feedback.load();
+}
+
+void BeatDelay::writeOnly(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    // at most two pieces around the end of the lines
+    const int lineLength{ lines.getNumSamples() };
+    int done{ 0 };
+    while (done < numSamples)
+    {
+        const int count{ juce::jmin(numSamples - done, lineLength - writePosition) };
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            lines.copyFrom(ch, writePosition, buffer, juce::jmin(ch, buffer.getNumChannels() - 1), startSample + done, count);
+        }
+        done += count;
+        writePosition = (writePosition + count) % lineLength;
+    }
+}
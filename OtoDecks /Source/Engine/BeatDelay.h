@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    BeatDelay.h
+    Created: 8 May 2024 7:52:14pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+
+//==============================================================================
+/*
+    Echo whose delay is a number of beats of the playing track. The deck
+    tells it the tempo before every block, including the speed it plays at,
+    and the delay glides to the new length over a short ramp instead of
+    jumping, like a tape echo being retimed. The lines are sized for the
+    longest delay in prepareToPlay, nothing is allocated afterwards.
+    While the echo is off the input is still written to the lines, so
+    turning it on repeats what was just played.
+*/
+class BeatDelay : public juce::AudioSource
+{
+public:
+    static constexpr double maxDelaySeconds{ 4.0 };
+    static constexpr double minBeats{ 0.125 };
+    static constexpr double maxBeats{ 4.0 };
+    /**tempo assumed for tracks without one*/
+    static constexpr double defaultBpm{ 120.0 };
+
+    BeatDelay(juce::AudioSource* _input);
+    ~BeatDelay() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Sets the tempo the deck is playing at, audio thread only, 0 if unknown*/
+    void setTempo(double bpm);
+    /**Sets the delay in beats*/
+    void setBeats(double newBeats);
+    double getBeats() const;
+    /**Sets the level of the echoes added to the deck, 0 turns the echo off*/
+    void setLevel(float newLevel);
+    float getLevel() const;
+    /**Sets how much of each echo is fed back into the next, below 1*/
+    void setFeedback(float newFeedback);
+    float getFeedback() const;
+
+private:
+    /**Copies the input into the lines without reading them*/
+    void writeOnly(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    static constexpr int numChannels{ 2 };
+
+    juce::AudioSource* input;
+    std::atomic<double> beats;
+    std::atomic<float> level;
+    std::atomic<float> feedback;
+
+    // audio thread only
+    juce::AudioBuffer<float> lines;
+    int writePosition;
+    double sampleRate;
+    double tempo;
+    juce::SmoothedValue<float> delaySamples;
+    juce::SmoothedValue<float> smoothedLevel;
+    juce::SmoothedValue<float> smoothedFeedback;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BeatDelay)
+};
@@ -0,0 +1,800 @@
+/*
+  ==============================================================================
+
+    DJAudioPlayer.cpp
+    Created: 19 Feb 2024 11:20:12pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "DJAudioPlayer.h"
+#include "Track.h"
+DJAudioPlayer::DJAudioPlayer(juce::AudioFormatManager& _formatManager,
+                             bool _realtime
+                            ) : formatManager(_formatManager),
+                                prefetcher(nullptr),
+                                sourceSampleRate(0),
+                                speed(1.0),
+                                deviceBlockSize(0),
+                                cueEnabled(false),
+                                realtime(_realtime),
+                                loopEnabled(false),
+                                loopStartPosition(0),
+                                loopEndPosition(0),
+                                eventLog(nullptr),
+                                deckIndex(0),
+                                numLoads(0),
+                                numScheduled(0),
+                                nextBlockStart(0),
+                                appliedLoad(0),
+                                clockSequence(0),
+                                lastBlockEnd(0),
+                                lastBlockPosition(0),
+                                playing(false),
+                                deviceSampleRate(0),
+                                bpm(0)
+{
+    reverbParams.wetLevel = 0.0;
+    reverbParams.dryLevel = 1.0;
+    reverbAudioSource.setParameters(reverbParams);
+    if (realtime)
+    {
+        readAheadThread.startThread();
+    }
+}
+
+DJAudioPlayer::~DJAudioPlayer()
+{
+    transportSource.setSource(nullptr);
+    readAheadThread.stopThread(1000);
+}
+
+void DJAudioPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    deviceSampleRate = sampleRate;
+    deviceBlockSize = samplesPerBlockExpected;
+    // the resampler and everything after it run at the device rate
+    updateResamplingRatio();
+    resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    scratchEngine.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    djFilter.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // sizes the echo lines, the only allocation the echo makes
+    beatDelay.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    reverbAudioSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // last, the stages above prepare their inputs at their own rate on the way down
+    prepareTrackInput();
+}
+
+void DJAudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    getNextAudioBlock(bufferToFill, nextBlockStart);
+}
+
+void DJAudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 blockStart)
+{
+    logPendingEvents(blockStart);
+
+    // take new commands, keeping the ones for later blocks in time order
+    DeckCommand command;
+    while (numScheduled < DeckCommandQueue::capacity && commandQueue.pop(command))
+    {
+        int i{ numScheduled++ };
+        for (; i > 0 && scheduled[i - 1].samplePosition > command.samplePosition; --i)
+        {
+            scheduled[i] = scheduled[i - 1];
+        }
+        scheduled[i] = command;
+    }
+
+    // split the block at every command that falls inside it
+    int offset{ 0 };
+    int numApplied{ 0 };
+    while (numApplied < numScheduled)
+    {
+        const juce::int64 due{ scheduled[numApplied].samplePosition - blockStart };
+        if (due >= bufferToFill.numSamples)
+        {
+            break;
+        }
+        const int at{ (int) juce::jmax((juce::int64) offset, due) };
+        renderRange(bufferToFill, offset, at - offset);
+        offset = at;
+        applyCommand(scheduled[numApplied++], blockStart + at);
+    }
+    std::move(scheduled.begin() + numApplied, scheduled.begin() + numScheduled, scheduled.begin());
+    numScheduled -= numApplied;
+    renderRange(bufferToFill, offset, bufferToFill.numSamples - offset);
+
+    // publish the clock and position as a pair
+    nextBlockStart = blockStart + bufferToFill.numSamples;
+    clockSequence.fetch_add(1, std::memory_order_acq_rel);
+    lastBlockEnd.store(nextBlockStart, std::memory_order_relaxed);
+    lastBlockPosition.store(transportSource.getCurrentPosition(), std::memory_order_relaxed);
+    clockSequence.fetch_add(1, std::memory_order_release);
+}
+
+void DJAudioPlayer::renderRange(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        int count{ numSamples };
+        const double length{ transportSource.getLengthInSeconds() };
+        if (loopEnabled && !scratchEngine.isActive() && length > 0)
+        {
+            if (transportSource.getCurrentPosition() >= loopEndPosition * length)
+            {
+                hotCuePreroll.cancel();
+                transportSource.setPosition(loopStartPosition * length);
+            }
+            if (transportGate.isOpen() && deviceSampleRate.load() > 0)
+            {
+                // stop on the sample the loop ends at, give or take the few samples the resampler reads ahead
+                const double secondsToEnd{ loopEndPosition * length - transportSource.getCurrentPosition() };
+                const double samplesToEnd{ secondsToEnd * deviceSampleRate.load() / speed.load() };
+                count = (int) juce::jlimit(1.0, (double) numSamples, std::ceil(samplesToEnd));
+            }
+        }
+        renderPart(bufferToFill, offset, count);
+        offset += count;
+        numSamples -= count;
+    }
+}
+
+void DJAudioPlayer::renderPart(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples)
+{
+    scratchEngine.setDeckState(transportSource.getCurrentPosition(), transportGate.isOpen(),
+                               speed.load(), transportSource.getGain());
+    // the echo follows the tempo the track plays at, not the one it was recorded at
+    beatDelay.setTempo(bpm.load() * speed.load());
+    reverbAudioSource.getNextAudioBlock(juce::AudioSourceChannelInfo{ bufferToFill.buffer,
+                                                                      bufferToFill.startSample + offset,
+                                                                      numSamples });
+    // the input takes over from the platter where the platter left it
+    double seekTo;
+    if (scratchEngine.takeSeekRequest(seekTo))
+    {
+        hotCuePreroll.cancel();
+        resampleSource.flushBuffers();
+        transportSource.setPosition(seekTo);
+    }
+}
+
+void DJAudioPlayer::applyCommand(const DeckCommand& command, juce::int64 samplePosition)
+{
+    // a start or stop scheduled for the previous track, e.g. by the auto DJ, must not reach this one
+    if (command.type == DeckCommand::Type::reset)
+    {
+        appliedLoad = command.load;
+    }
+    else if (command.load != appliedLoad)
+    {
+        return;
+    }
+
+    if (eventLog != nullptr)
+    {
+        // stamped here, with the sample the command is heard from, so a replay lands on it exactly
+        const double length{ transportSource.getLengthInSeconds() };
+        switch (command.type)
+        {
+            case DeckCommand::Type::play:
+                eventLog->appendApplied(deckIndex, DeckEvent::Type::play, 0, 0, samplePosition);
+                break;
+            case DeckCommand::Type::stop:
+                eventLog->appendApplied(deckIndex, DeckEvent::Type::stop, 0, 0, samplePosition);
+                break;
+            case DeckCommand::Type::seek:
+                eventLog->appendApplied(deckIndex, DeckEvent::Type::seek, length > 0 ? command.value / length : 0,
+                                        0, samplePosition);
+                break;
+            case DeckCommand::Type::triggerHotCue:
+                eventLog->appendApplied(deckIndex, DeckEvent::Type::triggerHotCue, 0, command.hotCue, samplePosition);
+                break;
+            // the load that sent it is logged with the track
+            case DeckCommand::Type::reset:
+                break;
+        }
+    }
+
+    switch (command.type)
+    {
+        case DeckCommand::Type::play:
+            transportGate.setOpen(true);
+            break;
+        case DeckCommand::Type::stop:
+            hotCuePreroll.cancel();
+            transportGate.setOpen(false);
+            break;
+        case DeckCommand::Type::reset:
+            hotCuePreroll.cancel();
+            transportGate.setOpen(false, false);
+            break;
+        case DeckCommand::Type::seek:
+            hotCuePreroll.cancel();
+            transportSource.setPosition(command.value);
+            break;
+        case DeckCommand::Type::triggerHotCue:
+            // the pinned pre-roll plays first, the transport continues after it
+            if (command.index >= 0)
+            {
+                hotCuePreroll.start(command.index);
+            }
+            else
+            {
+                hotCuePreroll.cancel();
+            }
+            transportSource.setPosition(command.value);
+            transportGate.setOpen(true);
+            break;
+    }
+    playing = transportGate.isOpen();
+}
+
+void DJAudioPlayer::releaseResources()
+{
+    hotCuePreroll.releaseResources();
+    resampleSource.releaseResources();
+    scratchEngine.releaseResources();
+    djFilter.releaseResources();
+    beatDelay.releaseResources();
+    reverbAudioSource.releaseResources();
+}
+
+void DJAudioPlayer::loadURL(juce::URL audioURL, juce::uint64 fingerprint)
+{
+    DBG("DJAudioPlayer::loadURL called");
+    std::shared_ptr<const PrefetchedTrack> prefetched{ prefetcher != nullptr ? prefetcher->find(fingerprint) : nullptr };
+    std::unique_ptr<juce::PositionableAudioSource> newSource;
+    double newSampleRate{ 0 };
+    float newBpm{ 0 };
+    if (prefetched != nullptr)
+    {
+        // decoded in the background already, nothing to open or read ahead
+        DBG("DJAudioPlayer::loadURL using the prefetched track");
+        // the track repeats from the start when it ends
+        newSource = std::make_unique<juce::MemoryAudioSource>(*prefetched->audio, false, true);
+        newSampleRate = prefetched->sampleRate;
+        newBpm = prefetched->bpm;
+    }
+    else
+    {
+        auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
+        if (reader == nullptr)
+        {
+            DBG("DJAudioPlayer::loadURL could not read " << audioURL.toString(false));
+            return;
+        }
+        auto readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader, true);
+        readerSource->setLooping(true);
+        newSampleRate = reader->sampleRate;
+        Track track{ audioURL.isLocalFile() ? audioURL.getLocalFile() : juce::File{} };
+        track.readMetadata(*reader);
+        newBpm = track.bpm;
+        newSource = std::move(readerSource);
+    }
+
+    // silence the old track on the next sample, the new one waits for play and
+    // anything still scheduled for the old one is dropped
+    ++numLoads;
+    sendCommand(DeckCommand::Type::reset, 0);
+    loopEnabled = false;
+    // the transport reads the track at its own rate and never resamples, the
+    // rate conversion rides on the speed change so each sample is interpolated once.
+    // The old source goes first, so re-preparing holds the callback lock only for
+    // an empty transport, and setSource prepares the new one outside the lock
+    transportSource.setSource(nullptr);
+    sourceSampleRate = newSampleRate;
+    prepareTrackInput();
+    updateResamplingRatio();
+    if (realtime && prefetched == nullptr)
+    {
+        // read ahead on a background thread so jumps never decode on the audio thread
+        transportSource.setSource(newSource.get(), readAheadSamples, &readAheadThread);
+    }
+    else
+    {
+        transportSource.setSource(newSource.get());
+    }
+    // the transport keeps running, the gate above it starts and stops the deck
+    transportSource.start();
+    trackSource = std::move(newSource);
+    // released after the source that reads it
+    decodedTrack = prefetched;
+    bpm = newBpm;
+    // a reader of its own so cues can decode while the transport reads ahead
+    hotCuePreroll.setReader(realtime ? formatManager.createReaderFor(audioURL.createInputStream(false)) : nullptr);
+    if (prefetched != nullptr)
+    {
+        // the scratch engine shares the decoded track
+        scratchEngine.setTrack(prefetched->audio, prefetched->sampleRate);
+    }
+    else
+    {
+        // or decodes the whole track with a reader of its own
+        scratchEngine.setReader(formatManager.createReaderFor(audioURL.createInputStream(false)), !realtime);
+    }
+    if (eventLog != nullptr && audioURL.isLocalFile())
+    {
+        eventLog->appendLoad(deckIndex, audioURL.getLocalFile(), fingerprint);
+    }
+}
+
+void DJAudioPlayer::setPrefetcher(TrackPrefetcher* _prefetcher)
+{
+    prefetcher = _prefetcher;
+}
+void DJAudioPlayer::play()
+{
+    sendCommand(DeckCommand::Type::play, 0);
+}
+
+void DJAudioPlayer::playAt(juce::int64 samplePosition)
+{
+    sendCommand(DeckCommand::Type::play, samplePosition);
+}
+
+bool DJAudioPlayer::isPlaying() const
+{
+    return playing.load();
+}
+
+void DJAudioPlayer::stop()
+{
+    sendCommand(DeckCommand::Type::stop, 0);
+}
+
+void DJAudioPlayer::stopAt(juce::int64 samplePosition)
+{
+    sendCommand(DeckCommand::Type::stop, samplePosition);
+}
+
+void DJAudioPlayer::setPosition(double posInSecs)
+{
+    sendCommand(DeckCommand::Type::seek, 0, posInSecs);
+}
+
+void DJAudioPlayer::sendCommand(DeckCommand::Type type, juce::int64 samplePosition, double value, int index,
+                                int hotCue)
+{
+    commandQueue.push(DeckCommand{ samplePosition, value, index, hotCue, numLoads.load(), type });
+}
+
+void DJAudioPlayer::setPositionRelative(double pos)
+{
+    if (pos < 0 || pos > 1.0)
+    {
+        DBG("DJAudioPlayer::setPositionRelative position should be between 0 and 1");
+    }
+    else {
+        double posInSecs = transportSource.getLengthInSeconds() * pos;
+        setPosition(posInSecs);
+    }
+}
+
+void DJAudioPlayer::setGain(double gain)
+{
+    if (gain < 0 || gain > 1.0)
+    {
+        DBG("DJAudioPlayer::setGain gain should be between 0 and 1");
+    }
+    else {
+        logEvent(DeckEvent::Type::gain, gain);
+        transportSource.setGain(gain);
+        hotCuePreroll.setGain(gain);
+    }
+}
+
+void DJAudioPlayer::setSpeed(double ratio)
+{
+    if (ratio < 0.25 || ratio > 4.0)
+    {
+        DBG("DJAudioPlayer::setSpeed ratio should be between 0.25 and 4");
+    }
+    else {
+        logEvent(DeckEvent::Type::speed, ratio);
+        speed = ratio;
+        updateResamplingRatio();
+    }
+}
+
+void DJAudioPlayer::setReverbWetLevel(float wetLevel)
+{
+    DBG("DJAudioPlayer::setReverbWetLevel called");
+    if (wetLevel < 0 || wetLevel > 1.0)
+    {
+        DBG("DJAudioPlayer::setWetLevel level should be between 0 and 1.0");
+    }
+    else {
+        logEvent(DeckEvent::Type::reverbWet, wetLevel);
+        reverbParams.wetLevel = wetLevel;
+        reverbAudioSource.setParameters(reverbParams);
+    }
+}
+
+void DJAudioPlayer::setReverbDryLevel(float dryLevel)
+{
+    DBG("DJAudioPlayer::setReverbDryLevel called");
+    if (dryLevel < 0 || dryLevel > 1.0)
+    {
+        DBG("DJAudioPlayer::setDryLevel level should be between 0 and 1.0");
+    }
+    else {
+        logEvent(DeckEvent::Type::reverbDry, dryLevel);
+        reverbParams.dryLevel = dryLevel;
+        reverbAudioSource.setParameters(reverbParams);
+    }
+}
+
+void DJAudioPlayer::setFilter(double position)
+{
+    if (position < -1.0 || position > 1.0)
+    {
+        DBG("DJAudioPlayer::setFilter position should be between -1 and 1");
+    }
+    else {
+        logEvent(DeckEvent::Type::filter, position);
+        djFilter.setPosition((float) position);
+    }
+}
+
+void DJAudioPlayer::setFilterResonance(double resonance)
+{
+    if (resonance < 0 || resonance > 1.0)
+    {
+        DBG("DJAudioPlayer::setFilterResonance resonance should be between 0 and 1");
+    }
+    else {
+        logEvent(DeckEvent::Type::filterResonance, resonance);
+        djFilter.setResonance((float) resonance);
+    }
+}
+
+void DJAudioPlayer::setEchoBeats(double beats)
+{
+    if (beats < BeatDelay::minBeats || beats > BeatDelay::maxBeats)
+    {
+        DBG("DJAudioPlayer::setEchoBeats beats should be between 1/8 and 4");
+    }
+    else {
+        logEvent(DeckEvent::Type::echoBeats, beats);
+        beatDelay.setBeats(beats);
+    }
+}
+
+void DJAudioPlayer::setEchoLevel(double level)
+{
+    if (level < 0 || level > 1.0)
+    {
+        DBG("DJAudioPlayer::setEchoLevel level should be between 0 and 1");
+    }
+    else {
+        logEvent(DeckEvent::Type::echoLevel, level);
+        beatDelay.setLevel((float) level);
+    }
+}
+
+void DJAudioPlayer::setEchoFeedback(double feedback)
+{
+    if (feedback < 0 || feedback > 0.95)
+    {
+        DBG("DJAudioPlayer::setEchoFeedback feedback should be between 0 and 0.95");
+    }
+    else {
+        logEvent(DeckEvent::Type::echoFeedback, feedback);
+        beatDelay.setFeedback((float) feedback);
+    }
+}
+
+double DJAudioPlayer::getPositionRelative()
+{
+    if (scratchEngine.isActive())
+    {
+        return scratchEngine.getPosition() / transportSource.getLengthInSeconds();
+    }
+    return transportSource.getCurrentPosition() / transportSource.getLengthInSeconds();
+}
+
+double DJAudioPlayer::getLengthInSeconds()
+{
+    return transportSource.getLengthInSeconds();
+}
+
+double DJAudioPlayer::getSourceSampleRate()
+{
+    return sourceSampleRate.load();
+}
+
+double DJAudioPlayer::getDeviceSampleRate() const
+{
+    return deviceSampleRate.load();
+}
+
+void DJAudioPlayer::setHotCue(int index)
+{
+    setHotCue(index, transportSource.getCurrentPosition());
+}
+
+void DJAudioPlayer::setHotCue(int index, double seconds)
+{
+    logEvent(DeckEvent::Type::setHotCue, seconds, index);
+    hotCuePreroll.setCue(index, seconds);
+}
+
+void DJAudioPlayer::clearHotCue(int index)
+{
+    logEvent(DeckEvent::Type::clearHotCue, 0, index);
+    hotCuePreroll.clearCue(index);
+}
+
+bool DJAudioPlayer::hasHotCue(int index)
+{
+    return hotCuePreroll.getCue(index) >= 0;
+}
+
+double DJAudioPlayer::getHotCue(int index)
+{
+    return hotCuePreroll.getCue(index);
+}
+
+void DJAudioPlayer::triggerHotCue(int index)
+{
+    if (!hasHotCue(index))
+    {
+        DBG("DJAudioPlayer::triggerHotCue cue " << index << " is not set");
+        return;
+    }
+    if (!realtime)
+    {
+        // offline renders start cold so they do not depend on the pre-roll thread
+        sendCommand(DeckCommand::Type::triggerHotCue, 0, hotCuePreroll.getCue(index), -1, index);
+        return;
+    }
+    bool usePreroll;
+    double continueFrom{ hotCuePreroll.getStartPosition(index, usePreroll) };
+    sendCommand(DeckCommand::Type::triggerHotCue, 0, continueFrom, usePreroll ? index : -1, index);
+}
+
+void DJAudioPlayer::setBpm(float newBpm)
+{
+    bpm = newBpm;
+}
+
+float DJAudioPlayer::getBpm() const
+{
+    return bpm.load();
+}
+
+juce::int64 DJAudioPlayer::getNextDownbeat(int beatsPerBar) const
+{
+    const double rate{ deviceSampleRate.load() };
+    const double ratio{ speed.load() };
+    if (!playing || bpm <= 0 || rate <= 0 || ratio <= 0)
+    {
+        return -1;
+    }
+
+    juce::int64 clock;
+    double position;
+    readClock(clock, position);
+    const double barSeconds{ beatsPerBar * 60.0 / bpm };
+    const double nextBar{ std::ceil(position / barSeconds) * barSeconds };
+    // track time runs at the speed ratio against the engine clock
+    return clock + (juce::int64) std::llround((nextBar - position) / ratio * rate);
+}
+
+juce::int64 DJAudioPlayer::getMixPoint(double fadeSeconds, int beatsPerBar) const
+{
+    const double rate{ deviceSampleRate.load() };
+    const double ratio{ speed.load() };
+    const double length{ transportSource.getLengthInSeconds() };
+    if (!playing || loopEnabled || rate <= 0 || ratio <= 0 || length <= 0)
+    {
+        return -1;
+    }
+
+    juce::int64 clock;
+    double position;
+    readClock(clock, position);
+    // the fade is in engine time, the track covers it faster or slower with the speed
+    double mixPosition{ length - fadeSeconds * ratio };
+    if (bpm > 0)
+    {
+        const double barSeconds{ beatsPerBar * 60.0 / bpm };
+        mixPosition = std::floor(mixPosition / barSeconds) * barSeconds;
+    }
+    mixPosition = juce::jmax(mixPosition, position);
+    return clock + (juce::int64) std::llround((mixPosition - position) / ratio * rate);
+}
+
+void DJAudioPlayer::setCueEnabled(bool enabled)
+{
+    cueEnabled = enabled;
+}
+
+bool DJAudioPlayer::isCueEnabled() const
+{
+    return cueEnabled.load();
+}
+
+bool DJAudioPlayer::beginScratch()
+{
+    if (!scratchEngine.touch())
+    {
+        return false;
+    }
+    logEvent(DeckEvent::Type::scratchTouch, 1);
+    return true;
+}
+
+void DJAudioPlayer::scratch(double deltaSeconds)
+{
+    logEvent(DeckEvent::Type::scratchMove, deltaSeconds);
+    scratchEngine.moveBy(deltaSeconds);
+}
+
+void DJAudioPlayer::endScratch()
+{
+    logEvent(DeckEvent::Type::scratchTouch, 0);
+    scratchEngine.release();
+}
+
+void DJAudioPlayer::setLoopStart(double pos)
+{
+    if (pos < 0 || pos > 1.0)
+    {
+        DBG("DJAudioPlayer::setLoopStart position should be between 0 and 1");
+        return;
+    }
+    logEvent(DeckEvent::Type::loopStart, pos);
+    loopStartPosition = pos;
+}
+
+void DJAudioPlayer::setLoopEnd(double pos)
+{
+    if (pos < 0 || pos > 1.0)
+    {
+        DBG("DJAudioPlayer::setLoopEnd position should be between 0 and 1");
+        return;
+    }
+    logEvent(DeckEvent::Type::loopEnd, pos);
+    loopEndPosition = pos;
+    if (pos > loopStartPosition)
+    {
+        loopEnabled = true;
+    }
+}
+
+void DJAudioPlayer::removeLoop()
+{
+    logEvent(DeckEvent::Type::loopRemove, 0);
+    loopEnabled = false;
+}
+
+bool DJAudioPlayer::isLooping() const
+{
+    return loopEnabled.load();
+}
+
+double DJAudioPlayer::getLoopStart() const
+{
+    return loopStartPosition.load();
+}
+
+double DJAudioPlayer::getLoopEnd() const
+{
+    return loopEndPosition.load();
+}
+
+void DJAudioPlayer::setEventLog(DeckEventLog* log, int deck)
+{
+    eventLog = log;
+    deckIndex = deck;
+    // a replay starts from default decks, so log what the GUI already set
+    logEvent(DeckEvent::Type::gain, transportSource.getGain());
+    logEvent(DeckEvent::Type::speed, speed.load());
+    logEvent(DeckEvent::Type::reverbWet, reverbParams.wetLevel);
+    logEvent(DeckEvent::Type::reverbDry, reverbParams.dryLevel);
+    logEvent(DeckEvent::Type::filter, djFilter.getPosition());
+    logEvent(DeckEvent::Type::filterResonance, djFilter.getResonance());
+    logEvent(DeckEvent::Type::echoBeats, beatDelay.getBeats());
+    logEvent(DeckEvent::Type::echoLevel, beatDelay.getLevel());
+    logEvent(DeckEvent::Type::echoFeedback, beatDelay.getFeedback());
+}
+
+void DJAudioPlayer::applyEvent(const DeckEvent& event, const juce::URL& trackURL)
+{
+    switch (event.type)
+    {
+        case DeckEvent::Type::load:          loadURL(trackURL); break;
+        case DeckEvent::Type::play:          play(); break;
+        case DeckEvent::Type::stop:          stop(); break;
+        case DeckEvent::Type::seek:          setPositionRelative(event.value); break;
+        case DeckEvent::Type::speed:         setSpeed(event.value); break;
+        case DeckEvent::Type::gain:          setGain(event.value); break;
+        case DeckEvent::Type::reverbWet:     setReverbWetLevel((float) event.value); break;
+        case DeckEvent::Type::reverbDry:     setReverbDryLevel((float) event.value); break;
+        case DeckEvent::Type::loopStart:     setLoopStart(event.value); break;
+        case DeckEvent::Type::loopEnd:       setLoopEnd(event.value); break;
+        case DeckEvent::Type::loopRemove:    removeLoop(); break;
+        case DeckEvent::Type::setHotCue:     hotCuePreroll.setCue(event.index, event.value); break;
+        case DeckEvent::Type::clearHotCue:   clearHotCue(event.index); break;
+        case DeckEvent::Type::triggerHotCue: triggerHotCue(event.index); break;
+        case DeckEvent::Type::scratchTouch:  event.value > 0 ? (void) beginScratch() : endScratch(); break;
+        case DeckEvent::Type::scratchMove:   scratch(event.value); break;
+        case DeckEvent::Type::filter:        setFilter(event.value); break;
+        case DeckEvent::Type::filterResonance: setFilterResonance(event.value); break;
+        case DeckEvent::Type::echoBeats:     setEchoBeats(event.value); break;
+        case DeckEvent::Type::echoLevel:     setEchoLevel(event.value); break;
+        case DeckEvent::Type::echoFeedback:  setEchoFeedback(event.value); break;
+        // the mixer applies crossfades, the replay hands them to it
+        case DeckEvent::Type::format:
+        case DeckEvent::Type::crossfade:
+        case DeckEvent::Type::end:           break;
+    }
+}
+
+void DJAudioPlayer::logEvent(DeckEvent::Type type, double value, int index)
+{
+    if (eventLog == nullptr)
+    {
+        return;
+    }
+    const juce::ScopedLock sl(pendingEventLock);
+    int start1, size1, start2, size2;
+    pendingEventFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0)
+    {
+        DBG("DJAudioPlayer::logEvent too many changes are waiting for the audio thread, change not logged");
+        return;
+    }
+    pendingEvents[(size_t) start1] = DeckEvent{ -1, value, type, (juce::uint8) deckIndex, (juce::uint16) index };
+    pendingEventFifo.finishedWrite(1);
+}
+
+void DJAudioPlayer::logPendingEvents(juce::int64 blockStart)
+{
+    int start1, size1, start2, size2;
+    pendingEventFifo.prepareToRead(pendingEventFifo.getNumReady(), start1, size1, start2, size2);
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        // a change made while a block renders may already reach part of it, this is the first block it fully owns
+        const DeckEvent& event{ pendingEvents[(size_t) (i < size1 ? start1 + i : start2 + i - size1)] };
+        if (eventLog != nullptr)
+        {
+            eventLog->appendApplied(event.deck, event.type, event.value, event.index, blockStart);
+        }
+    }
+    pendingEventFifo.finishedRead(size1 + size2);
+}
+
+void DJAudioPlayer::readClock(juce::int64& clock, double& position) const
+{
+    juce::uint32 sequence;
+    do
+    {
+        sequence = clockSequence.load(std::memory_order_acquire);
+        clock = lastBlockEnd.load(std::memory_order_relaxed);
+        position = lastBlockPosition.load(std::memory_order_relaxed);
+    } while ((sequence & 1) != 0 || sequence != clockSequence.load(std::memory_order_acquire));
+}
+
+void DJAudioPlayer::prepareTrackInput()
+{
+    const double deviceRate{ deviceSampleRate.load() };
+    if (deviceRate <= 0)
+    {
+        return;
+    }
+    // the pre-roll stage prepares the gate and transport it wraps at the same rate
+    const double trackRate{ sourceSampleRate.load() > 0 ? sourceSampleRate.load() : deviceRate };
+    hotCuePreroll.prepareToPlay((int) std::ceil(deviceBlockSize.load() * trackRate / deviceRate), trackRate);
+}
+
+void DJAudioPlayer::updateResamplingRatio()
+{
+    const double trackRate{ sourceSampleRate.load() };
+    const double deviceRate{ deviceSampleRate.load() };
+    resampleSource.setResamplingRatio(trackRate > 0 && deviceRate > 0 ? speed.load() * trackRate / deviceRate
+                                                                     : speed.load());
+}
@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    DJAudioPlayer.h
+    Created: 19 Feb 2024 11:20:12pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include "HotCuePreroll.h"
+#include "DeckEventLog.h"
+#include "DeckCommandQueue.h"
+#include "TransportGate.h"
+#include "ScratchEngine.h"
+#include "DJFilter.h"
+#include "BeatDelay.h"
+#include "TrackPrefetcher.h"
+
+//==============================================================================
+/*
+*/
+class DJAudioPlayer : public juce::AudioSource
+{
+    public:
+        /**An offline player decodes on the calling thread so renders are deterministic*/
+        DJAudioPlayer(juce::AudioFormatManager& _formatManager, bool _realtime = true);
+        ~DJAudioPlayer();
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+        void releaseResources() override;
+        /**Renders a block that starts at this engine sample, applying queued commands on their exact sample*/
+        void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 blockStart);
+
+        /**Loads the audio file, from the prefetcher if it already decoded the fingerprint*/
+        void loadURL(juce::URL audioURL, juce::uint64 fingerprint = 0);
+        /**Sets where decoded tracks are looked up before a file is opened, nullptr for none*/
+        void setPrefetcher(TrackPrefetcher* _prefetcher);
+        /**Plays loaded audio file*/
+        void play();
+        /**Starts playing at an engine sample position, e.g. a downbeat of the other deck*/
+        void playAt(juce::int64 samplePosition);
+        /**Checks if the deck is playing, as of the last block rendered*/
+        bool isPlaying() const;
+        /**Stops playing audio file*/
+        void stop();
+        /**Stops playing at an engine sample position, e.g. the end of a crossfade*/
+        void stopAt(juce::int64 samplePosition);
+        /**Sets relative position of audio file*/
+        void setPositionRelative(double pos);
+        /**Sets the volume*/
+        void setGain(double gain);
+        /**Sets the speed*/
+        void setSpeed(double ratio);
+        /**Sets the amount of reverb for wet level*/
+        void setReverbWetLevel(float wetLevel);
+        /**Sets the amount of reverb for dry level*/
+        void setReverbDryLevel(float dryLevel);
+        /**Sets the filter knob, -1 is low-pass closed, 0 is off and 1 is high-pass closed*/
+        void setFilter(double position);
+        /**Sets the filter resonance between 0 and 1*/
+        void setFilterResonance(double resonance);
+        /**Sets the echo delay in beats of the track at its current speed*/
+        void setEchoBeats(double beats);
+        /**Sets the echo level between 0 and 1, 0 is off*/
+        void setEchoLevel(double level);
+        /**Sets how much of each echo repeats, between 0 and 0.95*/
+        void setEchoFeedback(double feedback);
+        /**Gets relative position of playhead*/
+        double getPositionRelative();
+        /**Gets the length of transport source in seconds*/
+        double getLengthInSeconds();
+        /**Gets the sample rate of the loaded file, 0 if nothing is loaded*/
+        double getSourceSampleRate();
+        /**Gets the sample rate the engine runs at, 0 before the device starts*/
+        double getDeviceSampleRate() const;
+        /**Sets a hot cue at the current position*/
+        void setHotCue(int index);
+        /**Sets a hot cue at a position in seconds, e.g. one saved with the track*/
+        void setHotCue(int index, double seconds);
+        /**Removes a hot cue*/
+        void clearHotCue(int index);
+        /**Checks if a hot cue is set*/
+        bool hasHotCue(int index);
+        /**Gets the position of a hot cue in seconds, -1 if it is not set*/
+        double getHotCue(int index);
+        /**Jumps to a hot cue and plays from it*/
+        void triggerHotCue(int index);
+        /**Sets the tempo of the loaded track, 0 if unknown*/
+        void setBpm(float bpm);
+        /**Gets the tempo of the loaded track, 0 if unknown*/
+        float getBpm() const;
+        /**Gets the engine sample of the next bar line of this deck, -1 if it is stopped or has no tempo.
+           The beat grid is assumed to start at the beginning of the track.*/
+        juce::int64 getNextDownbeat(int beatsPerBar = 4) const;
+        /**Gets the engine sample to start a crossfade of this many seconds so it ends with the track,
+           moved back onto a bar line if the tempo is known. -1 if the deck is stopped or looping.*/
+        juce::int64 getMixPoint(double fadeSeconds, int beatsPerBar = 4) const;
+        /**Routes the deck to the headphone cue bus as well as the master*/
+        void setCueEnabled(bool enabled);
+        /**Checks if the deck feeds the headphone cue bus*/
+        bool isCueEnabled() const;
+        /**Puts a hand on the platter, returns false if the track is not ready to scratch yet*/
+        bool beginScratch();
+        /**Moves the platter by some seconds of track, negative scratches backwards*/
+        void scratch(double deltaSeconds);
+        /**Lets go of the platter, the deck spins back up if it is playing*/
+        void endScratch();
+        /**Sets the relative position the loop jumps back to*/
+        void setLoopStart(double pos);
+        /**Sets the relative position the loop ends at, enables it if after the start*/
+        void setLoopEnd(double pos);
+        /**Stops looping*/
+        void removeLoop();
+        /**Checks if a loop is playing*/
+        bool isLooping() const;
+        /**Gets the relative position the loop jumps back to*/
+        double getLoopStart() const;
+        /**Gets the relative position the loop ends at*/
+        double getLoopEnd() const;
+
+        /**Logs every command of this deck to the log, starting with its current settings*/
+        void setEventLog(DeckEventLog* log, int deck);
+        /**Applies a logged command, used to replay a session*/
+        void applyEvent(const DeckEvent& event, const juce::URL& trackURL);
+        
+
+    private:
+        void setPosition(double posInSecs);
+        /**Queues a command for the audio thread*/
+        void sendCommand(DeckCommand::Type type, juce::int64 samplePosition, double value = 0, int index = -1,
+                         int hotCue = -1);
+        /**Carries out a command and logs it at the engine sample it took effect, audio thread only*/
+        void applyCommand(const DeckCommand& command, juce::int64 samplePosition);
+        /**Renders part of a block with no commands in it, jumping back on the loop end sample*/
+        void renderRange(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples);
+        /**Renders part of a block that neither a command nor the loop end falls in*/
+        void renderPart(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples);
+        /**Queues a change for the event log if the deck has one, it is stamped by the next block*/
+        void logEvent(DeckEvent::Type type, double value, int index = 0);
+        /**Logs the queued changes at the sample of the first block that plays them, audio thread only*/
+        void logPendingEvents(juce::int64 blockStart);
+        /**Reads the engine clock and track position at the end of the same block*/
+        void readClock(juce::int64& clock, double& position) const;
+        /**Prepares the stages above the resampler at the rate of the loaded track*/
+        void prepareTrackInput();
+        /**Sets the resampler to the speed times the track to device rate ratio*/
+        void updateResamplingRatio();
+        static constexpr int readAheadSamples{ 32768 };
+        juce::AudioFormatManager& formatManager;
+        juce::TimeSliceThread readAheadThread{ "Deck Read-Ahead" };
+        TrackPrefetcher* prefetcher;
+        /**kept alive for as long as trackSource reads from it*/
+        std::shared_ptr<const PrefetchedTrack> decodedTrack;
+        /**the loaded track, read from the file or from a prefetched buffer*/
+        std::unique_ptr<juce::PositionableAudioSource> trackSource;
+        juce::AudioTransportSource transportSource;
+        TransportGate transportGate{ &transportSource };
+        HotCuePreroll hotCuePreroll{ &transportGate, readAheadThread };
+        juce::ResamplingAudioSource resampleSource{ &hotCuePreroll, false, 2 };
+        ScratchEngine scratchEngine{ &resampleSource, readAheadThread };
+        DJFilter djFilter{ &scratchEngine };
+        BeatDelay beatDelay{ &djFilter };
+        juce::ReverbAudioSource reverbAudioSource{ &beatDelay, false };
+        juce::Reverb::Parameters reverbParams;
+        std::atomic<double> sourceSampleRate;
+        /**the speed the user set, the resampler also converts the track rate*/
+        std::atomic<double> speed;
+        std::atomic<int> deviceBlockSize;
+        std::atomic<bool> cueEnabled;
+        const bool realtime;
+
+        // the loop is checked on the audio thread so it never depends on GUI timing
+        std::atomic<bool> loopEnabled;
+        std::atomic<double> loopStartPosition;
+        std::atomic<double> loopEndPosition;
+
+        DeckEventLog* eventLog;
+        int deckIndex;
+        // changes made off the audio thread wait here for the block they are heard from
+        static constexpr int maxPendingEvents{ 256 };
+        juce::AbstractFifo pendingEventFifo{ maxPendingEvents };
+        std::array<DeckEvent, maxPendingEvents> pendingEvents;
+        juce::CriticalSection pendingEventLock;
+
+        DeckCommandQueue commandQueue;
+        /**counts the loads, every command is tagged with the count when it is sent*/
+        std::atomic<juce::uint32> numLoads;
+        // audio thread only, commands waiting for their sample in time order
+        std::array<DeckCommand, DeckCommandQueue::capacity> scheduled;
+        int numScheduled;
+        juce::int64 nextBlockStart;
+        /**the load of the last reset applied, older commands are stale*/
+        juce::uint32 appliedLoad;
+
+        // where the deck was at the end of the last block, for quantising against it
+        std::atomic<juce::uint32> clockSequence;
+        std::atomic<juce::int64> lastBlockEnd;
+        std::atomic<double> lastBlockPosition;
+        std::atomic<bool> playing;
+        std::atomic<double> deviceSampleRate;
+        std::atomic<float> bpm;
+};
+
@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    DJFilter.cpp
+    Created: 7 May 2024 8:05:27pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "DJFilter.h"
+#include <juce_dsp/juce_dsp.h>
+#include <cmath>
+
+namespace
+{
+    // cutoff range of each side, swept exponentially
+    constexpr double lowPassOpen{ 20000.0 };
+    constexpr double lowPassClosed{ 60.0 };
+    constexpr double highPassOpen{ 20.0 };
+    constexpr double highPassClosed{ 8000.0 };
+    /**knob travel past the dead zone over which the filter fades in*/
+    constexpr float blendZone{ 0.1f };
+    /**damping of a Butterworth response and of full resonance*/
+    constexpr float flatDamping{ 1.41421356f };
+    constexpr float resonantDamping{ 0.2f };
+
+    /**left and right in the first two lanes, the rest run on silence*/
+    using Lanes = juce::dsp::SIMDRegister<float>;
+}
+
+//==============================================================================
+DJFilter::DJFilter(juce::AudioSource* _input) : input(_input),
+                                                position(0),
+                                                resonance(0),
+                                                sampleRate(0),
+                                                current{ 0.0f, flatDamping, 1.0f, flatDamping, 1.0f }
+{
+    ic1eq.fill(0);
+    ic2eq.fill(0);
+}
+
+DJFilter::~DJFilter()
+{
+}
+
+void DJFilter::prepareToPlay(int samplesPerBlockExpected, double _sampleRate)
+{
+    sampleRate = _sampleRate;
+    ic1eq.fill(0);
+    ic2eq.fill(0);
+    current = getTarget(position, resonance);
+    input->prepareToPlay(samplesPerBlockExpected, _sampleRate);
+}
+
+void DJFilter::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    input->getNextAudioBlock(bufferToFill);
+    const Coefficients target{ getTarget(position, resonance) };
+    if (isFlat(current) && isFlat(target))
+    {
+        // the identity holds for any state, so starting again from silence cannot click
+        ic1eq.fill(0);
+        ic2eq.fill(0);
+        current = target;
+        return;
+    }
+
+    juce::ScopedNoDenormals noDenormals;
+    const int numSamples{ bufferToFill.numSamples };
+    const int numChannels{ juce::jmin(2, bufferToFill.buffer->getNumChannels()) };
+    std::array<float*, 2> channels{};
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        channels[ch] = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
+    }
+
+    // linear steps from the last block's coefficients to this one's
+    const float step{ 1.0f / juce::jmax(1, numSamples) };
+    const Coefficients delta{ (target.g - current.g) * step, (target.k - current.k) * step,
+                              (target.low - current.low) * step, (target.band - current.band) * step,
+                              (target.high - current.high) * step };
+    // both channels share the coefficients, so they run as lanes of one register
+    Lanes s1{ Lanes::expand(0.0f) };
+    Lanes s2{ Lanes::expand(0.0f) };
+    Lanes v0{ Lanes::expand(0.0f) };
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        s1.set((size_t) ch, ic1eq[ch]);
+        s2.set((size_t) ch, ic2eq[ch]);
+    }
+
+    Coefficients c{ current };
+    for (int i = 0; i < numSamples; ++i)
+    {
+        c.g += delta.g;
+        c.k += delta.k;
+        c.low += delta.low;
+        c.band += delta.band;
+        c.high += delta.high;
+        const float a1{ 1.0f / (1.0f + c.g * (c.g + c.k)) };
+        const float a2{ c.g * a1 };
+        const float a3{ c.g * a2 };
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            v0.set((size_t) ch, channels[ch][i]);
+        }
+        const Lanes v3{ v0 - s2 };
+        const Lanes v1{ s1 * a1 + v3 * a2 };
+        const Lanes v2{ s2 + s1 * a2 + v3 * a3 };
+        s1 = v1 * 2.0f - s1;
+        s2 = v2 * 2.0f - s2;
+        const Lanes high{ v0 - v1 * c.k - v2 };
+        const Lanes out{ v2 * c.low + v1 * c.band + high * c.high };
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            channels[ch][i] = out.get((size_t) ch);
+        }
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        ic1eq[ch] = s1.get((size_t) ch);
+        ic2eq[ch] = s2.get((size_t) ch);
+    }
+    current = target;
+}
+
+void DJFilter::releaseResources()
+{
+    input->releaseResources();
+}
+
+void DJFilter::setPosition(float newPosition)
+{
+    position = juce::jlimit(-1.0f, 1.0f, newPosition);
+}
+
+float DJFilter::getPosition() const
+{
+    return position.load();
+}
+
+void DJFilter::setResonance(float newResonance)
+{
+    resonance = juce::jlimit(0.0f, 1.0f, newResonance);
+}
+
+float DJFilter::getResonance() const
+{
+    return resonance.load();
+}
+
+DJFilter::Coefficients DJFilter::getTarget(float knob, float peak) const
+{
+    const float amount{ juce::jlimit(0.0f, 1.0f, (std::abs(knob) - deadZone) / (1.0f - deadZone)) };
+    const float blend{ juce::jmin(1.0f, amount / blendZone) };
+    if (blend <= 0.0f || sampleRate <= 0)
+    {
+        return { 0.0f, flatDamping, 1.0f, flatDamping, 1.0f };
+    }
+
+    const bool lowPass{ knob < 0 };
+    double cutoff{ lowPass ? lowPassOpen * std::pow(lowPassClosed / lowPassOpen, (double) amount)
+                           : highPassOpen * std::pow(highPassClosed / highPassOpen, (double) amount) };
+    cutoff = juce::jmin(cutoff, 0.45 * sampleRate);
+
+    Coefficients target;
+    target.g = (float) std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate);
+    // resonance comes in with the filter, so it never colours the centre
+    target.k = flatDamping + (resonantDamping - flatDamping) * peak * blend;
+    // low + k * band + high is the input, fading towards one output turns the filter on
+    target.low = lowPass ? 1.0f : 1.0f - blend;
+    target.high = lowPass ? 1.0f - blend : 1.0f;
+    target.band = target.k * (1.0f - blend);
+    return target;
+}
+
+bool DJFilter::isFlat(const Coefficients& coefficients)
+{
+    return coefficients.low == 1.0f && coefficients.high == 1.0f;
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    DJFilter.h
+    Created: 7 May 2024 8:05:27pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+    One knob DJ filter. Turning left sweeps a low-pass down from the top of
+    the spectrum, turning right sweeps a high-pass up from the bottom, and
+    the centre lets the input through untouched. It is a topology preserving
+    state variable filter whose low, band and high outputs are mixed, so the
+    centre is an exact identity and the filter fades in without a click.
+    The knob is read once per block and the coefficients are interpolated
+    per sample towards it, so sweeps of any speed stay smooth.
+*/
+class DJFilter : public juce::AudioSource
+{
+public:
+    /**knob travel either side of the centre that leaves the input alone*/
+    static constexpr float deadZone{ 0.02f };
+
+    DJFilter(juce::AudioSource* _input);
+    ~DJFilter() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Sets the knob, -1 is low-pass fully closed, 0 is off and 1 is high-pass fully closed*/
+    void setPosition(float newPosition);
+    float getPosition() const;
+    /**Sets the peak at the cutoff, 0 is flat and 1 rings*/
+    void setResonance(float newResonance);
+    float getResonance() const;
+
+private:
+    /**What the filter runs with: the SVF gain and damping and the mix of its outputs*/
+    struct Coefficients
+    {
+        float g;
+        float k;
+        float low;
+        float band;
+        float high;
+    };
+
+    /**Works out the coefficients for a knob setting, one tan per block*/
+    Coefficients getTarget(float knob, float peak) const;
+    /**Checks if the coefficients give back the input unchanged*/
+    static bool isFlat(const Coefficients& coefficients);
+
+    juce::AudioSource* input;
+    std::atomic<float> position;
+    std::atomic<float> resonance;
+    double sampleRate;
+
+    // audio thread only
+    Coefficients current;
+    std::array<float, 2> ic1eq;
+    std::array<float, 2> ic2eq;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DJFilter)
+};
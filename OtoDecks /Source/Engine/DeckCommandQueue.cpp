@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    DeckCommandQueue.cpp
+    Created: 9 Apr 2024 8:03:27pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "DeckCommandQueue.h"
+
+//==============================================================================
+DeckCommandQueue::DeckCommandQueue()
+{
+}
+
+bool DeckCommandQueue::push(const DeckCommand& command)
+{
+    const juce::ScopedLock sl(writeLock);
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0)
+    {
+        DBG("DeckCommandQueue::push queue is full, command dropped");
+        return false;
+    }
+    commands[(size_t) start1] = command;
+    fifo.finishedWrite(1);
+    return true;
+}
+
+bool DeckCommandQueue::pop(DeckCommand& command)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 == 0)
+    {
+        return false;
+    }
+    command = commands[(size_t) start1];
+    fifo.finishedRead(1);
+    return true;
+}
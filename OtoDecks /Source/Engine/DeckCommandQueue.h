@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    DeckCommandQueue.h
+    Created: 9 Apr 2024 8:03:27pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+//==============================================================================
+/**A transport command for a deck, applied on the audio thread at a given sample*/
+struct DeckCommand
+{
+    enum class Type : juce::uint8
+    {
+        play,
+        stop,
+        /**stops without a fade and drops older commands, used when a new track replaces the old one*/
+        reset,
+        seek,
+        triggerHotCue
+    };
+
+    /**engine sample to apply at, anything already due is applied at the start of the next block*/
+    juce::int64 samplePosition;
+    /**position in seconds for seek and triggerHotCue*/
+    double value;
+    /**hot cue whose pre-roll plays, -1 to start cold*/
+    int index;
+    /**hot cue that was triggered, for the event log*/
+    int hotCue;
+    /**the load it was sent after, commands meant for an earlier track are dropped*/
+    juce::uint32 load;
+    Type type;
+};
+
+//==============================================================================
+/*
+    Carries commands from the GUI and other threads to the audio thread.
+    The audio thread side never blocks: producers are serialised with a lock
+    among themselves, but the consumer only touches the lock-free FIFO.
+*/
+class DeckCommandQueue
+{
+public:
+    static constexpr int capacity{ 256 };
+
+    DeckCommandQueue();
+
+    /**Adds a command, returns false if the queue is full. Not for the audio thread*/
+    bool push(const DeckCommand& command);
+    /**Takes the oldest command off the queue, audio thread only*/
+    bool pop(DeckCommand& command);
+
+private:
+    juce::AbstractFifo fifo{ capacity };
+    std::array<DeckCommand, capacity> commands;
+    juce::CriticalSection writeLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckCommandQueue)
+};
@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    DeckEventLog.cpp
+    Created: 7 Apr 2024 7:35:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "DeckEventLog.h"
+#include "DeckMixer.h"
+
+namespace
+{
+    const char logMagic[8]{ 'O', 'T', 'O', 'E', 'V', 'L', 'O', 'G' };
+    constexpr int logVersion{ 1 };
+}
+
+//==============================================================================
+DeckEventLog::DeckEventLog(const DeckMixer& _mixer) : mixer(_mixer),
+                                                      deviceSampleRate(0),
+                                                      deviceBlockSize(0),
+                                                      formatChanged(false)
+{
+}
+
+DeckEventLog::~DeckEventLog()
+{
+    close();
+}
+
+bool DeckEventLog::open(const juce::File& file)
+{
+    close();
+    file.getParentDirectory().createDirectory();
+    auto newStream = std::make_unique<juce::FileOutputStream>(file);
+    if (newStream->failedToOpen())
+    {
+        DBG("DeckEventLog::open cannot write to " << file.getFullPathName());
+        return false;
+    }
+    newStream->setPosition(0);
+    newStream->truncate();
+    newStream->write(logMagic, sizeof(logMagic));
+    newStream->writeInt(logVersion);
+
+    const juce::ScopedLock sl(lock);
+    stream = std::move(newStream);
+    formatChanged = deviceSampleRate.load() > 0;
+    // slider drags log many events, so they are flushed once a second
+    startTimer(1000);
+    return true;
+}
+
+void DeckEventLog::close()
+{
+    stopTimer();
+    const juce::ScopedLock sl(lock);
+    writeApplied();
+    // without it a replay would stop on the last command and lose the rest of the set
+    writeRecord(0, DeckEvent::Type::end, 0, 0, -1);
+    stream.reset();
+}
+
+void DeckEventLog::setDeviceFormat(double sampleRate, int blockSize)
+{
+    deviceSampleRate = sampleRate;
+    deviceBlockSize = blockSize;
+    formatChanged = true;
+}
+
+void DeckEventLog::append(int deck, DeckEvent::Type type, double value, int index, juce::int64 samplePosition)
+{
+    const juce::ScopedLock sl(lock);
+    writeRecord(deck, type, value, index, samplePosition);
+}
+
+void DeckEventLog::appendLoad(int deck, const juce::File& file, juce::uint64 fingerprint)
+{
+    const juce::ScopedLock sl(lock);
+    writeRecord(deck, DeckEvent::Type::load, 0, 0, -1);
+    if (stream != nullptr)
+    {
+        stream->writeInt64((juce::int64) fingerprint);
+        stream->writeString(file.getFullPathName());
+    }
+}
+
+void DeckEventLog::appendApplied(int deck, DeckEvent::Type type, double value, int index, juce::int64 samplePosition)
+{
+    int start1, size1, start2, size2;
+    appliedFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0)
+    {
+        return;
+    }
+    applied[(size_t) start1] = DeckEvent{ samplePosition, value, type, (juce::uint8) deck, (juce::uint16) index };
+    appliedFifo.finishedWrite(1);
+}
+
+void DeckEventLog::writeApplied()
+{
+    int start1, size1, start2, size2;
+    appliedFifo.prepareToRead(appliedFifo.getNumReady(), start1, size1, start2, size2);
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        const DeckEvent& event{ applied[(size_t) (i < size1 ? start1 + i : start2 + i - size1)] };
+        writeRecord(event.deck, event.type, event.value, event.index, event.samplePosition);
+    }
+    appliedFifo.finishedRead(size1 + size2);
+}
+
+void DeckEventLog::writeRecord(int deck, DeckEvent::Type type, double value, int index, juce::int64 samplePosition)
+{
+    if (stream == nullptr)
+    {
+        return;
+    }
+
+    const juce::int64 now{ mixer.getSamplePosition() };
+    if (samplePosition < 0)
+    {
+        samplePosition = now;
+    }
+    if (formatChanged.exchange(false))
+    {
+        stream->writeByte((char) DeckEvent::Type::format);
+        stream->writeByte(0);
+        stream->writeShort((short) deviceBlockSize.load());
+        stream->writeInt64(now);
+        stream->writeDouble(deviceSampleRate.load());
+    }
+
+    stream->writeByte((char) type);
+    stream->writeByte((char) deck);
+    stream->writeShort((short) index);
+    stream->writeInt64(samplePosition);
+    stream->writeDouble(value);
+}
+
+void DeckEventLog::timerCallback()
+{
+    const juce::ScopedLock sl(lock);
+    writeApplied();
+    if (stream != nullptr)
+    {
+        stream->flush();
+    }
+}
+
+bool DeckEventLog::read(const juce::File& file, Contents& contents)
+{
+    contents = Contents{};
+    juce::FileInputStream in{ file };
+    char magic[sizeof(logMagic)];
+    if (in.failedToOpen()
+        || in.read(magic, sizeof(magic)) != (int) sizeof(magic)
+        || std::memcmp(magic, logMagic, sizeof(magic)) != 0)
+    {
+        DBG("DeckEventLog::read " << file.getFullPathName() << " is not an event log");
+        return false;
+    }
+    if (in.readInt() != logVersion)
+    {
+        DBG("DeckEventLog::read unsupported log version");
+        return false;
+    }
+
+    // a record is 20 bytes, a log cut off by a crash just ends early
+    constexpr int recordSize{ 20 };
+    while (in.getNumBytesRemaining() >= recordSize)
+    {
+        DeckEvent event;
+        event.type = (DeckEvent::Type) in.readByte();
+        event.deck = (juce::uint8) in.readByte();
+        event.index = (juce::uint16) in.readShort();
+        event.samplePosition = in.readInt64();
+        event.value = in.readDouble();
+
+        if (event.type > DeckEvent::Type::end)
+        {
+            DBG("DeckEventLog::read unknown record, stopping");
+            break;
+        }
+        if (event.type == DeckEvent::Type::load)
+        {
+            if (in.getNumBytesRemaining() < 9)
+            {
+                break;
+            }
+            LoggedTrack track;
+            track.fingerprint = (juce::uint64) in.readInt64();
+            track.path = in.readString();
+            event.value = (double) contents.tracks.size();
+            contents.tracks.push_back(track);
+        }
+        contents.events.push_back(event);
+    }
+    return true;
+}
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    DeckEventLog.h
+    Created: 7 Apr 2024 7:35:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class DeckMixer;
+
+//==============================================================================
+/**One deck command or change, stamped with the engine sample clock. Transport commands
+   carry the sample they took effect at, other changes the first block that played them*/
+struct DeckEvent
+{
+    enum class Type : juce::uint8
+    {
+        format = 0,
+        load,
+        play,
+        stop,
+        seek,
+        speed,
+        gain,
+        reverbWet,
+        reverbDry,
+        loopStart,
+        loopEnd,
+        loopRemove,
+        setHotCue,
+        clearHotCue,
+        triggerHotCue,
+        /**value is 1 when the platter is touched and 0 when it is let go*/
+        scratchTouch,
+        /**value is the distance moved in seconds of track*/
+        scratchMove,
+        /**value is the knob from -1 for low-pass to 1 for high-pass*/
+        filter,
+        filterResonance,
+        /**value is the delay in beats*/
+        echoBeats,
+        echoLevel,
+        echoFeedback,
+        /**deck fades out to the deck in index from the sample on, value is the length in samples*/
+        crossfade,
+        /**the clock when the log was closed, the set is rendered up to it*/
+        end
+    };
+
+    juce::int64 samplePosition;
+    /**position, level or ratio, the track index for load and the rate for format*/
+    double value;
+    Type type;
+    juce::uint8 deck;
+    /**hot cue index, or the block size in a format event*/
+    juce::uint16 index;
+};
+
+//==============================================================================
+/*
+    Appends every deck command to a compact binary log as it happens, so a
+    set can be rendered again offline sample for sample by EventReplay.
+    Deck commands and changes are logged by the audio thread at the sample
+    they are heard from and reach the file through a lock-free FIFO, written
+    out once a second. Closing the log ends it with the engine clock.
+    Each record is a type, deck and index byte, the sample clock and one
+    value; loads also carry the fingerprint and path of the track.
+*/
+class DeckEventLog : private juce::Timer
+{
+public:
+    /**A track that was loaded during the logged session*/
+    struct LoggedTrack
+    {
+        juce::String path;
+        juce::uint64 fingerprint;
+    };
+
+    /**Everything read back from a log file*/
+    struct Contents
+    {
+        std::vector<DeckEvent> events;
+        std::vector<LoggedTrack> tracks;
+    };
+
+    DeckEventLog(const DeckMixer& _mixer);
+    ~DeckEventLog() override;
+
+    /**Starts a new log file, closing the previous one*/
+    bool open(const juce::File& file);
+    /**Ends the log at the current engine sample, flushes and closes the file*/
+    void close();
+
+    /**Remembers the device format, written before the next event. Safe on any thread*/
+    void setDeviceFormat(double sampleRate, int blockSize);
+    /**Logs a command for a deck at the current engine sample position, or a scheduled one*/
+    void append(int deck, DeckEvent::Type type, double value, int index = 0, juce::int64 samplePosition = -1);
+    /**Logs a track being loaded into a deck*/
+    void appendLoad(int deck, const juce::File& file, juce::uint64 fingerprint);
+    /**Logs a command at the sample it took effect, audio thread only. Never blocks, drops it if the FIFO is full*/
+    void appendApplied(int deck, DeckEvent::Type type, double value, int index, juce::int64 samplePosition);
+
+    /**Reads a whole log, returns false if it is not a log or is damaged before the first event*/
+    static bool read(const juce::File& file, Contents& contents);
+
+private:
+    void timerCallback() override;
+    /**Writes the commands the audio thread logged since the last call, call with the lock held*/
+    void writeApplied();
+    /**Writes the common part of a record, call with the lock held*/
+    void writeRecord(int deck, DeckEvent::Type type, double value, int index, juce::int64 samplePosition);
+
+    const DeckMixer& mixer;
+    juce::CriticalSection lock;
+    std::unique_ptr<juce::FileOutputStream> stream;
+
+    std::atomic<double> deviceSampleRate;
+    std::atomic<int> deviceBlockSize;
+    std::atomic<bool> formatChanged;
+
+    // commands applied on the audio thread, the only writer
+    static constexpr int maxApplied{ 1024 };
+    juce::AbstractFifo appliedFifo{ maxApplied };
+    std::array<DeckEvent, maxApplied> applied;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckEventLog)
+};
@@ -0,0 +1,229 @@
+/*
+  ==============================================================================
+
+    DeckMixer.cpp
+    Created: 2 Apr 2024 9:44:10pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "DeckMixer.h"
+
+//==============================================================================
+DeckMixer::DeckMixer() : samplePads(nullptr),
+                         eventLog(nullptr),
+                         samplePosition(0),
+                         currentFade{ nullptr, nullptr, 0, 0 },
+                         fading(false),
+                         fadedOut(nullptr)
+{
+}
+
+DeckMixer::~DeckMixer()
+{
+}
+
+void DeckMixer::addDeck(DJAudioPlayer* deck)
+{
+    decks.push_back(deck);
+    deckTaps.push_back(std::make_unique<AnalysisTap>());
+}
+
+void DeckMixer::setSamplePads(SamplePads* pads)
+{
+    samplePads = pads;
+}
+
+void DeckMixer::setEventLog(DeckEventLog* log)
+{
+    eventLog = log;
+}
+
+void DeckMixer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    deckBuffer.setSize(2, samplesPerBlockExpected);
+    for (DJAudioPlayer* deck : decks)
+    {
+        deck->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+    if (samplePads != nullptr)
+    {
+        samplePads->prepareToPlay(sampleRate);
+    }
+    for (auto& tap : deckTaps)
+    {
+        tap->prepareToPlay(sampleRate);
+    }
+    masterTap.prepareToPlay(sampleRate);
+}
+
+void DeckMixer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    juce::AudioBuffer<float>& output{ *bufferToFill.buffer };
+    const int numSamples{ bufferToFill.numSamples };
+    const bool hasCueBus{ output.getNumChannels() >= cueChannel + 2 };
+
+    bufferToFill.clearActiveBufferRegion();
+    // only grows if the device hands us a bigger block than it promised
+    deckBuffer.setSize(2, numSamples, false, false, true);
+
+    const juce::int64 blockStart{ samplePosition.load() };
+    if (!fading)
+    {
+        int start1, size1, start2, size2;
+        fadeFifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 > 0)
+        {
+            currentFade = pendingFades[(size_t) start1];
+            fadeFifo.finishedRead(1);
+            fading = true;
+        }
+    }
+
+    for (size_t i = 0; i < decks.size(); ++i)
+    {
+        DJAudioPlayer* deck{ decks[i] };
+        juce::AudioSourceChannelInfo deckInfo{ &deckBuffer, 0, numSamples };
+        deck->getNextAudioBlock(deckInfo, blockStart);
+        // the meters see the deck before the crossfade, like a channel meter
+        deckTaps[i]->pushBlock(deckBuffer, 0, 0, numSamples);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            if (hasCueBus && deck->isCueEnabled())
+            {
+                output.addFrom(cueChannel + ch, bufferToFill.startSample, deckBuffer, ch, 0, numSamples);
+            }
+        }
+        if (fading)
+        {
+            applyCrossfade(deck, blockStart, numSamples);
+        }
+        else if (deck == fadedOut)
+        {
+            // its stop fade and echo tail may outlast the crossfade, they must not come back at full gain
+            if (deck->isPlaying())
+            {
+                fadedOut = nullptr;
+            }
+            else
+            {
+                deckBuffer.clear(0, numSamples);
+            }
+        }
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            output.addFrom(masterChannel + ch, bufferToFill.startSample, deckBuffer, ch, 0, numSamples);
+        }
+    }
+
+    if (samplePads != nullptr)
+    {
+        samplePads->renderBlock(output, masterChannel, bufferToFill.startSample, numSamples, blockStart);
+    }
+    masterTap.pushBlock(output, masterChannel, bufferToFill.startSample, numSamples);
+
+    if (fading && blockStart + numSamples >= currentFade.start + currentFade.length)
+    {
+        fading = false;
+        fadedOut = currentFade.from;
+    }
+    samplePosition += numSamples;
+}
+
+void DeckMixer::releaseResources()
+{
+    for (DJAudioPlayer* deck : decks)
+    {
+        deck->releaseResources();
+    }
+    deckBuffer.setSize(2, 0);
+}
+
+juce::int64 DeckMixer::getSamplePosition() const
+{
+    return samplePosition.load();
+}
+
+int DeckMixer::getNumDecks() const
+{
+    return (int) decks.size();
+}
+
+AnalysisTap& DeckMixer::getDeckTap(int deck)
+{
+    jassert(juce::isPositiveAndBelow(deck, (int) deckTaps.size()));
+    return *deckTaps[(size_t) deck];
+}
+
+AnalysisTap& DeckMixer::getMasterTap()
+{
+    return masterTap;
+}
+
+bool DeckMixer::scheduleCrossfade(DJAudioPlayer* from, DJAudioPlayer* to, juce::int64 startSample, juce::int64 numSamples)
+{
+    if (numSamples <= 0)
+    {
+        DBG("DeckMixer::scheduleCrossfade the fade needs a length");
+        return false;
+    }
+    int start1, size1, start2, size2;
+    fadeFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0)
+    {
+        DBG("DeckMixer::scheduleCrossfade too many fades are waiting");
+        return false;
+    }
+    pendingFades[(size_t) start1] = Crossfade{ from, to, startSample, numSamples };
+    fadeFifo.finishedWrite(1);
+    if (eventLog != nullptr && indexOf(from) >= 0 && indexOf(to) >= 0)
+    {
+        // a replay has to fade the same decks on the same samples
+        eventLog->append(indexOf(from), DeckEvent::Type::crossfade, (double) numSamples, indexOf(to), startSample);
+    }
+    return true;
+}
+
+int DeckMixer::indexOf(const DJAudioPlayer* deck) const
+{
+    for (size_t i = 0; i < decks.size(); ++i)
+    {
+        if (decks[i] == deck)
+        {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+float DeckMixer::getFadeGain(const Crossfade& fade, const DJAudioPlayer* deck, juce::int64 sample)
+{
+    const double progress{ juce::jlimit(0.0, 1.0, (sample - fade.start) / (double) fade.length) };
+    const double angle{ progress * juce::MathConstants<double>::halfPi };
+    return (float) (deck == fade.from ? std::cos(angle) : std::sin(angle));
+}
+
+void DeckMixer::applyCrossfade(const DJAudioPlayer* deck, juce::int64 blockStart, int numSamples)
+{
+    if (deck != currentFade.from && deck != currentFade.to)
+    {
+        return;
+    }
+
+    // flat before and after the fade, a ramp while it runs, split on the exact samples
+    const juce::int64 fadeEnd{ currentFade.start + currentFade.length };
+    const int rampStart{ (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, currentFade.start - blockStart) };
+    const int rampEnd{ (int) juce::jlimit((juce::int64) 0, (juce::int64) numSamples, fadeEnd - blockStart) };
+    const float gainBefore{ getFadeGain(currentFade, deck, blockStart) };
+    const float gainAtRampStart{ getFadeGain(currentFade, deck, blockStart + rampStart) };
+    const float gainAtRampEnd{ getFadeGain(currentFade, deck, blockStart + rampEnd) };
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        deckBuffer.applyGain(ch, 0, rampStart, gainBefore);
+        // short blocks keep the linear steps between equal power points inaudible
+        deckBuffer.applyGainRamp(ch, rampStart, rampEnd - rampStart, gainAtRampStart, gainAtRampEnd);
+        deckBuffer.applyGain(ch, rampEnd, numSamples - rampEnd, gainAtRampEnd);
+    }
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    DeckMixer.h
+    Created: 2 Apr 2024 9:44:10pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "DJAudioPlayer.h"
+#include "AnalysisTap.h"
+#include "SamplePads.h"
+
+//==============================================================================
+/*
+    Mixes the decks onto the master bus on output channels 1/2 and every deck
+    with cue enabled onto the headphone cue bus on channels 3/4. Each deck is
+    rendered once per block and added to whichever buses it feeds. Scheduled
+    crossfades run on the master bus only, the cue bus stays pre-fader.
+    The sample pads play on the master after the fade. Every deck and the
+    master are also copied into analysis taps for the meters and the spectrum.
+*/
+class DeckMixer : public juce::AudioSource
+{
+public:
+    static constexpr int masterChannel{ 0 };
+    static constexpr int cueChannel{ 2 };
+
+    DeckMixer();
+    ~DeckMixer() override;
+
+    /**Adds a deck to the mix, call before the audio device starts*/
+    void addDeck(DJAudioPlayer* deck);
+    /**Plays a bank of pads on the master, call before the audio device starts*/
+    void setSamplePads(SamplePads* pads);
+    /**Logs every crossfade scheduled from now on, or nullptr to stop*/
+    void setEventLog(DeckEventLog* log);
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Gets the number of samples mixed since the engine started, the clock events are stamped with*/
+    juce::int64 getSamplePosition() const;
+    /**Fades the master from one deck to the other with equal power, starting on an engine sample.
+       Returns false if too many fades are already waiting. Not for the audio thread*/
+    bool scheduleCrossfade(DJAudioPlayer* from, DJAudioPlayer* to, juce::int64 startSample, juce::int64 numSamples);
+    int getNumDecks() const;
+    /**Gets the copy of what a deck plays, for its meter*/
+    AnalysisTap& getDeckTap(int deck);
+    /**Gets the copy of the master bus*/
+    AnalysisTap& getMasterTap();
+
+private:
+    struct Crossfade
+    {
+        DJAudioPlayer* from;
+        DJAudioPlayer* to;
+        juce::int64 start;
+        juce::int64 length;
+    };
+
+    /**Gets the master gain of a deck at an engine sample while the crossfade runs*/
+    static float getFadeGain(const Crossfade& fade, const DJAudioPlayer* deck, juce::int64 sample);
+    /**Applies the crossfade to a rendered deck block that starts at blockStart*/
+    void applyCrossfade(const DJAudioPlayer* deck, juce::int64 blockStart, int numSamples);
+
+    /**Gets the position of a deck in the mix, -1 if it was never added*/
+    int indexOf(const DJAudioPlayer* deck) const;
+
+    std::vector<DJAudioPlayer*> decks;
+    std::vector<std::unique_ptr<AnalysisTap>> deckTaps;
+    SamplePads* samplePads;
+    DeckEventLog* eventLog;
+    AnalysisTap masterTap;
+    juce::AudioBuffer<float> deckBuffer;
+    std::atomic<juce::int64> samplePosition;
+
+    // crossfades are handed to the audio thread through a lock-free FIFO
+    static constexpr int maxPendingFades{ 8 };
+    juce::AbstractFifo fadeFifo{ maxPendingFades };
+    std::array<Crossfade, maxPendingFades> pendingFades;
+    // audio thread only
+    Crossfade currentFade;
+    bool fading;
+    /**the deck the last fade took out, held silent on the master until it plays again*/
+    DJAudioPlayer* fadedOut;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckMixer)
+};
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    EventReplay.cpp
+    Created: 7 Apr 2024 9:18:06pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include <array>
+#include <algorithm>
+#include "EventReplay.h"
+#include "DeckMixer.h"
+#include "TrackFingerprint.h"
+
+//==============================================================================
+bool EventReplay::render(const juce::File& logFile,
+                         const juce::File& outputFile,
+                         juce::AudioFormatManager& formatManager)
+{
+    DeckEventLog::Contents contents;
+    if (!DeckEventLog::read(logFile, contents))
+    {
+        return false;
+    }
+
+    // commands reach the file from the audio thread up to a second late, so put everything in time order
+    std::stable_sort(contents.events.begin(), contents.events.end(),
+                     [](const DeckEvent& a, const DeckEvent& b) { return a.samplePosition < b.samplePosition; });
+
+    // the first format record sets the rate and block size the set was played at
+    double sampleRate{ 44100.0 };
+    int blockSize{ 512 };
+    for (const DeckEvent& event : contents.events)
+    {
+        if (event.type == DeckEvent::Type::format)
+        {
+            sampleRate = event.value;
+            blockSize = juce::jmax(1, (int) event.index);
+            break;
+        }
+    }
+
+    std::vector<juce::URL> trackURLs;
+    for (const DeckEventLog::LoggedTrack& track : contents.tracks)
+    {
+        trackURLs.push_back(resolveTrack(track));
+    }
+
+    outputFile.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream{ outputFile.createOutputStream() };
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    if (stream != nullptr)
+    {
+        writer.reset(wavFormat.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+    }
+    if (writer == nullptr)
+    {
+        DBG("EventReplay::render cannot write " << outputFile.getFullPathName());
+        return false;
+    }
+    stream.release();
+
+    std::array<std::unique_ptr<DJAudioPlayer>, numDecks> players;
+    DeckMixer mixer;
+    for (auto& player : players)
+    {
+        player = std::make_unique<DJAudioPlayer>(formatManager, false);
+        mixer.addDeck(player.get());
+    }
+    mixer.prepareToPlay(blockSize, sampleRate);
+
+    // a closed log ends with the clock it was closed at, one cut off by a crash
+    // is rendered to the end of the block its last event falls in
+    juce::int64 endPosition{ -1 };
+    for (const DeckEvent& event : contents.events)
+    {
+        if (event.type == DeckEvent::Type::end)
+        {
+            endPosition = event.samplePosition;
+        }
+    }
+    if (endPosition < 0)
+    {
+        endPosition = contents.events.empty() ? 0 : (contents.events.back().samplePosition / blockSize + 1) * blockSize;
+    }
+
+    juce::AudioBuffer<float> block{ 2, blockSize };
+    juce::int64 position{ 0 };
+    size_t next{ 0 };
+
+    // the set is rendered with the live block boundaries
+    while (position < endPosition)
+    {
+        int offset{ 0 };
+        while (offset < blockSize)
+        {
+            // apply everything due at this sample before rendering past it
+            while (next < contents.events.size() && contents.events[next].samplePosition <= position + offset)
+            {
+                const DeckEvent& event{ contents.events[next++] };
+                if (event.type == DeckEvent::Type::format || event.type == DeckEvent::Type::end
+                    || event.deck >= numDecks)
+                {
+                    continue;
+                }
+                if (event.type == DeckEvent::Type::crossfade)
+                {
+                    if (event.index < numDecks)
+                    {
+                        mixer.scheduleCrossfade(players[event.deck].get(), players[event.index].get(),
+                                                event.samplePosition, (juce::int64) event.value);
+                    }
+                    continue;
+                }
+                const bool isLoad{ event.type == DeckEvent::Type::load };
+                players[event.deck]->applyEvent(event, isLoad ? trackURLs[(size_t) event.value] : juce::URL{});
+            }
+
+            int numSamples{ blockSize - offset };
+            if (next < contents.events.size())
+            {
+                numSamples = (int) juce::jmin((juce::int64) numSamples,
+                                              contents.events[next].samplePosition - (position + offset));
+            }
+            mixer.getNextAudioBlock(juce::AudioSourceChannelInfo{ &block, offset, numSamples });
+            offset += numSamples;
+        }
+        writer->writeFromAudioSampleBuffer(block, 0, (int) juce::jmin((juce::int64) blockSize, endPosition - position));
+        position += blockSize;
+    }
+
+    mixer.releaseResources();
+    return true;
+}
+
+juce::URL EventReplay::resolveTrack(const DeckEventLog::LoggedTrack& track)
+{
+    juce::File file{ track.path };
+    if (!file.existsAsFile())
+    {
+        DBG("EventReplay::resolveTrack " << track.path << " is missing, the deck stays silent");
+    }
+    else if (track.fingerprint != 0 && TrackFingerprint::compute(file) != track.fingerprint)
+    {
+        DBG("EventReplay::resolveTrack " << track.path << " changed since the set was played");
+    }
+    return juce::URL{ file };
+}
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    EventReplay.h
+    Created: 7 Apr 2024 9:18:06pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "DeckEventLog.h"
+
+//==============================================================================
+/*
+    Renders a logged session offline. Every event is applied at the exact
+    sample it was stamped with by splitting the block around it, and the
+    decks decode on this thread, so the same log always renders the same
+    audio, up to the sample the log was closed at.
+*/
+class EventReplay
+{
+public:
+    static constexpr int numDecks{ 2 };
+
+    /**Renders the master mix of the log into a WAV file, returns false on failure*/
+    static bool render(const juce::File& logFile,
+                       const juce::File& outputFile,
+                       juce::AudioFormatManager& formatManager);
+
+private:
+    /**Finds the track of a load event, checking it is still the same audio*/
+    static juce::URL resolveTrack(const DeckEventLog::LoggedTrack& track);
+};
@@ -0,0 +1,327 @@
+/*
+  ==============================================================================
+
+    HotCuePreroll.cpp
+    Created: 26 Mar 2024 8:21:40pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "HotCuePreroll.h"
+#include "TransportGate.h"
+
+//==============================================================================
+HotCuePreroll::HotCuePreroll(juce::AudioSource* _input,
+                             juce::TimeSliceThread& _thread
+                            ) : input(_input),
+                                thread(_thread),
+                                readerGeneration(0),
+                                inputSampleRate(0),
+                                gain(1.0f),
+                                pendingCue(noCue),
+                                playingCue(noCue),
+                                readPosition(0),
+                                fadingCue(noCue),
+                                fadePosition(0),
+                                fadeRemaining(0)
+{
+    cues.fill(-1.0);
+    needsDecoding.fill(false);
+    thread.addTimeSliceClient(this);
+}
+
+HotCuePreroll::~HotCuePreroll()
+{
+    thread.removeTimeSliceClient(this);
+}
+
+void HotCuePreroll::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    if (sampleRate != inputSampleRate.load())
+    {
+        // pre-rolls are stored at the input rate, so decode them again
+        inputSampleRate = sampleRate;
+        const juce::ScopedLock sl(cueLock);
+        for (int i = 0; i < numHotCues; ++i)
+        {
+            needsDecoding[i] = cues[i] >= 0;
+        }
+    }
+}
+
+void HotCuePreroll::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    int newCue{ pendingCue.exchange(noCue) };
+    if (newCue != noCue && playingCue >= 0)
+    {
+        // a pre-roll cut short by a stop, a seek or another cue would click
+        fadingCue = playingCue;
+        fadePosition = readPosition;
+        fadeRemaining = TransportGate::fadeSamples;
+    }
+    if (newCue == cancelCue)
+    {
+        playingCue = noCue;
+    }
+    else if (newCue >= 0)
+    {
+        playingCue = newCue;
+        readPosition = 0;
+    }
+
+    renderPreroll(bufferToFill);
+    if (fadeRemaining > 0)
+    {
+        fadeOutCancelled(bufferToFill);
+    }
+}
+
+void HotCuePreroll::renderPreroll(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (playingCue >= 0)
+    {
+        // never wait here, if a buffer is being swapped the input plays instead
+        juce::SpinLock::ScopedTryLockType lock(bufferLock);
+        const juce::AudioBuffer<float>* preroll{ lock.isLocked() ? buffers[playingCue].get() : nullptr };
+        if (preroll != nullptr && readPosition < preroll->getNumSamples())
+        {
+            int numSamples{ juce::jmin(bufferToFill.numSamples, preroll->getNumSamples() - readPosition) };
+            for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+            {
+                bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample,
+                                              *preroll, ch % preroll->getNumChannels(),
+                                              readPosition, numSamples);
+            }
+            bufferToFill.buffer->applyGain(bufferToFill.startSample, numSamples, gain.load());
+            readPosition += numSamples;
+
+            if (numSamples < bufferToFill.numSamples)
+            {
+                // pre-roll ran out, the input carries on right where it ended
+                playingCue = noCue;
+                juce::AudioSourceChannelInfo rest{ bufferToFill.buffer,
+                                                   bufferToFill.startSample + numSamples,
+                                                   bufferToFill.numSamples - numSamples };
+                input->getNextAudioBlock(rest);
+            }
+            return;
+        }
+        playingCue = noCue;
+    }
+
+    input->getNextAudioBlock(bufferToFill);
+}
+
+void HotCuePreroll::fadeOutCancelled(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int numSamples{ juce::jmin(bufferToFill.numSamples, fadeRemaining) };
+    const float startLevel{ (float) fadeRemaining / TransportGate::fadeSamples };
+    const float endLevel{ (float) (fadeRemaining - numSamples) / TransportGate::fadeSamples };
+    fadeRemaining -= numSamples;
+
+    // if the buffer is being swapped or was cleared the cut is left as it is
+    juce::SpinLock::ScopedTryLockType lock(bufferLock);
+    const juce::AudioBuffer<float>* preroll{ lock.isLocked() ? buffers[fadingCue].get() : nullptr };
+    if (preroll == nullptr || fadePosition >= preroll->getNumSamples())
+    {
+        fadeRemaining = 0;
+        return;
+    }
+
+    // the tail of a pre-roll that was nearly over stops where the pre-roll does
+    const int numPrerollSamples{ juce::jmin(numSamples, preroll->getNumSamples() - fadePosition) };
+    const float prerollEndLevel{ startLevel + (endLevel - startLevel) * numPrerollSamples / numSamples };
+    const float prerollGain{ gain.load() };
+    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+    {
+        bufferToFill.buffer->applyGainRamp(ch, bufferToFill.startSample, numSamples,
+                                           1.0f - startLevel, 1.0f - endLevel);
+        bufferToFill.buffer->addFromWithRamp(ch, bufferToFill.startSample,
+                                             preroll->getReadPointer(ch % preroll->getNumChannels(), fadePosition),
+                                             numPrerollSamples,
+                                             prerollGain * startLevel, prerollGain * prerollEndLevel);
+    }
+    fadePosition += numPrerollSamples;
+}
+
+void HotCuePreroll::releaseResources()
+{
+    input->releaseResources();
+}
+
+void HotCuePreroll::setReader(juce::AudioFormatReader* newReader)
+{
+    cancel();
+    std::unique_ptr<juce::AudioFormatReader> oldReader;
+    std::array<std::unique_ptr<juce::AudioBuffer<float>>, numHotCues> oldBuffers;
+    {
+        const juce::ScopedLock sl(cueLock);
+        cues.fill(-1.0);
+        needsDecoding.fill(false);
+        ++readerGeneration;
+    }
+    {
+        // waits for a decode of the old track to finish
+        const juce::ScopedLock sl(readerLock);
+        oldReader = std::move(reader);
+        reader.reset(newReader);
+    }
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferLock);
+        std::swap(oldBuffers, buffers);
+    }
+    // old buffers and reader are freed here, outside both locks
+}
+
+void HotCuePreroll::setCue(int index, double seconds)
+{
+    if (!juce::isPositiveAndBelow(index, numHotCues) || seconds < 0)
+    {
+        DBG("HotCuePreroll::setCue index should be between 0 and " << numHotCues - 1);
+        return;
+    }
+    {
+        const juce::ScopedLock sl(cueLock);
+        cues[index] = seconds;
+        needsDecoding[index] = true;
+    }
+    thread.moveToFrontOfQueue(this);
+}
+
+void HotCuePreroll::clearCue(int index)
+{
+    if (!juce::isPositiveAndBelow(index, numHotCues))
+    {
+        return;
+    }
+    {
+        const juce::ScopedLock sl(cueLock);
+        cues[index] = -1.0;
+        needsDecoding[index] = false;
+    }
+    std::unique_ptr<juce::AudioBuffer<float>> oldBuffer;
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferLock);
+        std::swap(oldBuffer, buffers[index]);
+    }
+}
+
+double HotCuePreroll::getCue(int index)
+{
+    const juce::ScopedLock sl(cueLock);
+    return juce::isPositiveAndBelow(index, numHotCues) ? cues[index] : -1.0;
+}
+
+double HotCuePreroll::getStartPosition(int index, bool& usePreroll)
+{
+    usePreroll = false;
+    double cue{ getCue(index) };
+    if (cue < 0)
+    {
+        return 0;
+    }
+
+    int numPinnedSamples{ 0 };
+    {
+        const juce::SpinLock::ScopedLockType sl(bufferLock);
+        if (buffers[index] != nullptr)
+        {
+            numPinnedSamples = buffers[index]->getNumSamples();
+        }
+    }
+    if (numPinnedSamples == 0 || inputSampleRate.load() <= 0)
+    {
+        // not decoded yet, the input has to start cold from the cue
+        DBG("HotCuePreroll::getStartPosition cue " << index << " has no pre-roll yet");
+        return cue;
+    }
+
+    usePreroll = true;
+    return cue + numPinnedSamples / inputSampleRate.load();
+}
+
+void HotCuePreroll::start(int index)
+{
+    pendingCue = index;
+}
+
+void HotCuePreroll::cancel()
+{
+    pendingCue = cancelCue;
+}
+
+void HotCuePreroll::setGain(float newGain)
+{
+    gain = newGain;
+}
+
+int HotCuePreroll::useTimeSlice()
+{
+    for (int i = 0; i < numHotCues; ++i)
+    {
+        double cue;
+        int generation;
+        {
+            const juce::ScopedLock sl(cueLock);
+            if (!needsDecoding[i])
+            {
+                continue;
+            }
+            needsDecoding[i] = false;
+            cue = cues[i];
+            generation = readerGeneration;
+        }
+
+        std::unique_ptr<juce::AudioBuffer<float>> preroll{ decode(cue) };
+        {
+            const juce::ScopedLock sl(cueLock);
+            // the track or the cue may have changed while it decoded
+            if (generation != readerGeneration || cues[i] != cue)
+            {
+                continue;
+            }
+            const juce::SpinLock::ScopedLockType bl(bufferLock);
+            std::swap(preroll, buffers[i]);
+        }
+    }
+    return 100;
+}
+
+std::unique_ptr<juce::AudioBuffer<float>> HotCuePreroll::decode(double cueSeconds)
+{
+    const double outputRate{ inputSampleRate.load() };
+    const juce::ScopedLock sl(readerLock);
+    if (reader == nullptr || outputRate <= 0)
+    {
+        return nullptr;
+    }
+
+    const double ratio{ reader->sampleRate / outputRate };
+    const int numOutputSamples{ juce::roundToInt(prerollSeconds * outputRate) };
+    // a few extra source samples for the interpolator to look ahead into
+    const int numSourceSamples{ (int) std::ceil(numOutputSamples * ratio) + 8 };
+    const int numChannels{ (int) juce::jmin(reader->numChannels, 2u) };
+
+    if (ratio == 1.0)
+    {
+        // the input runs at the track rate, a straight copy with no interpolation pass
+        auto preroll = std::make_unique<juce::AudioBuffer<float>>(numChannels, numOutputSamples);
+        reader->read(preroll.get(), 0, numOutputSamples,
+                     (juce::int64) (cueSeconds * reader->sampleRate), true, true);
+        return preroll;
+    }
+
+    juce::AudioBuffer<float> source{ numChannels, numSourceSamples };
+    reader->read(&source, 0, numSourceSamples,
+                 (juce::int64) (cueSeconds * reader->sampleRate), true, true);
+
+    auto preroll = std::make_unique<juce::AudioBuffer<float>>(numChannels, numOutputSamples);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        juce::LagrangeInterpolator interpolator;
+        interpolator.process(ratio, source.getReadPointer(ch), preroll->getWritePointer(ch), numOutputSamples);
+    }
+    return preroll;
+}
@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    HotCuePreroll.h
+    Created: 26 Mar 2024 8:21:40pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+    Holds the hot cues of the loaded track and keeps the first moments after
+    each cue decoded in memory. Triggering a cue plays the pinned audio at
+    once while the input, already positioned after the pre-roll, is filled
+    by the read-ahead thread, so there is no cold decoder start.
+*/
+class HotCuePreroll : public juce::AudioSource,
+                      private juce::TimeSliceClient
+{
+public:
+    static constexpr int numHotCues{ 4 };
+    static constexpr double prerollSeconds{ 0.4 };
+
+    HotCuePreroll(juce::AudioSource* _input, juce::TimeSliceThread& _thread);
+    ~HotCuePreroll() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Takes ownership of a reader for the loaded track and clears every cue*/
+    void setReader(juce::AudioFormatReader* newReader);
+    /**Sets a cue point in seconds and decodes its pre-roll in the background*/
+    void setCue(int index, double seconds);
+    /**Removes a cue point*/
+    void clearCue(int index);
+    /**Gets a cue point in seconds, -1 if it is not set*/
+    double getCue(int index);
+    /**Gets the position in seconds the input continues from when the cue is started,
+       usePreroll is false if the pre-roll is not decoded yet and the input starts cold*/
+    double getStartPosition(int index, bool& usePreroll);
+    /**Starts the pinned pre-roll of a cue from the next sample rendered, safe on the audio thread*/
+    void start(int index);
+    /**Stops a pre-roll that is playing, e.g. because the user seeked, fading it out
+       under whatever follows over as many samples as the transport gate takes*/
+    void cancel();
+    /**Gain applied to the pre-roll so it matches the input*/
+    void setGain(float newGain);
+
+private:
+    int useTimeSlice() override;
+    /**Plays the pinned pre-roll if one is playing, otherwise pulls the input*/
+    void renderPreroll(const juce::AudioSourceChannelInfo& bufferToFill);
+    /**Crossfades from a cancelled pre-roll into what was rendered in its place*/
+    void fadeOutCancelled(const juce::AudioSourceChannelInfo& bufferToFill);
+    /**Decodes the pre-roll for one cue, at the rate the input runs at*/
+    std::unique_ptr<juce::AudioBuffer<float>> decode(double cueSeconds);
+
+    juce::AudioSource* input;
+    juce::TimeSliceThread& thread;
+
+    // the reader has its own lock, held for a whole decode, so cue lookups never wait on the disk
+    juce::CriticalSection readerLock;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+
+    // cue times, shared between the message, MIDI and read-ahead threads
+    juce::CriticalSection cueLock;
+    std::array<double, numHotCues> cues;
+    std::array<bool, numHotCues> needsDecoding;
+    /**counts readers, a pre-roll decoded from an older one is thrown away*/
+    int readerGeneration;
+
+    // pinned buffers, swapped by the read-ahead thread and read by the audio thread
+    juce::SpinLock bufferLock;
+    std::array<std::unique_ptr<juce::AudioBuffer<float>>, numHotCues> buffers;
+
+    /**the rate the input runs at, the track's own when the deck resamples below*/
+    std::atomic<double> inputSampleRate;
+    std::atomic<float> gain;
+    /**cue to start on the next block, noCue or cancelCue*/
+    std::atomic<int> pendingCue;
+    static constexpr int noCue{ -1 };
+    static constexpr int cancelCue{ -2 };
+
+    // audio thread only
+    int playingCue;
+    int readPosition;
+    /**pre-roll fading out after a cancel, and the samples left of its fade*/
+    int fadingCue;
+    int fadePosition;
+    int fadeRemaining;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HotCuePreroll)
+};
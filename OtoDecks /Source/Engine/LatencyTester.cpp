@@ -0,0 +1,379 @@
+/*
+  ==============================================================================
+
+    LatencyTester.cpp
+    Created: 1 May 2024 8:22:16pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "LatencyTester.h"
+
+namespace
+{
+    juce::String samplesToText(double samples, double sampleRate)
+    {
+        return juce::String(samples, 0) + " samples (" + juce::String(samples * 1000.0 / sampleRate, 2) + " ms)";
+    }
+}
+
+//==============================================================================
+LatencyTester::LatencyTester(juce::AudioDeviceManager& _deviceManager
+                            ) : deviceManager(_deviceManager),
+                                task(Task::none),
+                                roundTrips{},
+                                numRoundTrips(0),
+                                numLostPings(0),
+                                pinging(false),
+                                sampleRate(0),
+                                blockSize(0),
+                                blockClock(0),
+                                nextPingAt(-1),
+                                pingSentAt(-1),
+                                lastCallbackTicks(0),
+                                statsResetRequested(false),
+                                numCallbacks(0),
+                                numLateCallbacks(0),
+                                intervalSum(0),
+                                intervalSquareSum(0),
+                                longestInterval(0),
+                                expectedInterval(0),
+                                trialIndex(0),
+                                xrunsAtTrialStart(0)
+{
+}
+
+LatencyTester::~LatencyTester()
+{
+    stopTimer();
+}
+
+void LatencyTester::prepare(double _sampleRate, int samplesPerBlockExpected)
+{
+    sampleRate = _sampleRate;
+    blockSize = samplesPerBlockExpected;
+    // a restarted device starts the callback timing over
+    lastCallbackTicks = 0;
+    pingSentAt = -1;
+    nextPingAt = -1;
+    DBG("LatencyTester device running at " << sampleRate << " Hz with blocks of " << blockSize << " samples");
+}
+
+void LatencyTester::beginBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    beginBlock(bufferToFill, juce::Time::getHighResolutionTicks());
+}
+
+void LatencyTester::beginBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 ticks)
+{
+    const int numSamples{ bufferToFill.numSamples };
+    if (statsResetRequested.exchange(false))
+    {
+        numCallbacks = 0;
+        numLateCallbacks = 0;
+        intervalSum = 0;
+        intervalSquareSum = 0;
+        longestInterval = 0;
+        lastCallbackTicks = 0;
+    }
+    if (lastCallbackTicks != 0 && sampleRate > 0)
+    {
+        // only this thread writes the statistics, so plain loads and stores are enough
+        const double interval{ juce::Time::highResolutionTicksToSeconds(ticks - lastCallbackTicks) };
+        const double expected{ numSamples / sampleRate };
+        intervalSum.store(intervalSum.load() + interval);
+        intervalSquareSum.store(intervalSquareSum.load() + interval * interval);
+        longestInterval.store(juce::jmax(longestInterval.load(), interval));
+        expectedInterval.store(expected);
+        if (interval > lateCallbackFactor * expected)
+        {
+            ++numLateCallbacks;
+        }
+        ++numCallbacks;
+    }
+    lastCallbackTicks = ticks;
+
+    if (pinging && pingSentAt >= 0)
+    {
+        // the input still holds input 1 here, the mixer has not overwritten it yet
+        const float* input{ bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample) };
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (std::abs(input[i]) >= detectLevel)
+            {
+                const int index{ numRoundTrips.load() };
+                roundTrips[(size_t) index] = (int) (blockClock + i - pingSentAt);
+                numRoundTrips.store(index + 1, std::memory_order_release);
+                pingSentAt = -1;
+                nextPingAt = blockClock + i + (juce::int64) (pingIntervalSeconds * sampleRate);
+                break;
+            }
+        }
+        if (pingSentAt >= 0 && blockClock + numSamples - pingSentAt > (juce::int64) (pingTimeoutSeconds * sampleRate))
+        {
+            ++numLostPings;
+            pingSentAt = -1;
+            nextPingAt = blockClock + numSamples;
+        }
+    }
+}
+
+void LatencyTester::endBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const int numSamples{ bufferToFill.numSamples };
+    if (!pinging)
+    {
+        pingSentAt = -1;
+        nextPingAt = -1;
+    }
+    else
+    {
+        // nothing but the clicks may reach the loopback
+        for (int ch = 0; ch < juce::jmin(2, bufferToFill.buffer->getNumChannels()); ++ch)
+        {
+            bufferToFill.buffer->clear(ch, bufferToFill.startSample, numSamples);
+        }
+        if (nextPingAt < 0)
+        {
+            nextPingAt = blockClock + (juce::int64) (muteSettleSeconds * sampleRate);
+        }
+    }
+    if (pinging && pingSentAt < 0 && numRoundTrips.load() + numLostPings.load() < numPings)
+    {
+        const juce::int64 due{ nextPingAt - blockClock };
+        if (due < numSamples)
+        {
+            const int offset{ (int) juce::jmax((juce::int64) 0, due) };
+            for (int ch = 0; ch < juce::jmin(2, bufferToFill.buffer->getNumChannels()); ++ch)
+            {
+                bufferToFill.buffer->setSample(ch, bufferToFill.startSample + offset, clickLevel);
+            }
+            pingSentAt = blockClock + offset;
+        }
+    }
+    blockClock += numSamples;
+}
+
+void LatencyTester::startRoundTrip()
+{
+    if (isBusy())
+    {
+        DBG("LatencyTester::startRoundTrip a test is already running");
+        return;
+    }
+    numRoundTrips = 0;
+    numLostPings = 0;
+    resetCallbackStats();
+    pinging = true;
+    task = Task::roundTrip;
+    startTimer(100);
+}
+
+void LatencyTester::startBlockSizeSearch()
+{
+    if (isBusy())
+    {
+        DBG("LatencyTester::startBlockSizeSearch a test is already running");
+        return;
+    }
+    juce::AudioIODevice* device{ deviceManager.getCurrentAudioDevice() };
+    if (device == nullptr)
+    {
+        finish("No audio device is open.");
+        return;
+    }
+
+    originalSetup = deviceManager.getAudioDeviceSetup();
+    candidateSizes.clear();
+    for (int size : device->getAvailableBufferSizes())
+    {
+        candidateSizes.push_back(size);
+    }
+    std::sort(candidateSizes.begin(), candidateSizes.end());
+    trialIndex = 0;
+    trialLog.clear();
+    if (!startNextTrial())
+    {
+        finish("The device offers no block sizes to try.");
+    }
+}
+
+bool LatencyTester::isBusy() const
+{
+    return task != Task::none;
+}
+
+juce::String LatencyTester::getDeviceReport() const
+{
+    juce::AudioIODevice* device{ deviceManager.getCurrentAudioDevice() };
+    if (device == nullptr)
+    {
+        return "No audio device is open.";
+    }
+    const double rate{ device->getCurrentSampleRate() };
+    juce::String report;
+    report << device->getTypeName() << ": " << device->getName() << "\n"
+           << "Sample rate: " << rate << " Hz\n"
+           << "Block size: " << samplesToText(device->getCurrentBufferSizeSamples(), rate) << "\n"
+           << "Output latency: " << samplesToText(device->getOutputLatencyInSamples(), rate) << "\n"
+           << "Input latency: " << samplesToText(device->getInputLatencyInSamples(), rate) << "\n"
+           << "Active inputs: " << device->getActiveInputChannels().countNumberOfSetBits()
+           << ", outputs: " << device->getActiveOutputChannels().countNumberOfSetBits() << "\n"
+           << "CPU load: " << juce::roundToInt(deviceManager.getCpuUsage() * 100.0) << "%";
+    return report;
+}
+
+void LatencyTester::timerCallback()
+{
+    switch (task)
+    {
+        case Task::roundTrip:
+            if (numRoundTrips.load(std::memory_order_acquire) + numLostPings.load() >= numPings)
+            {
+                finishRoundTrip();
+            }
+            break;
+        case Task::blockSizeWarmUp:
+        {
+            // the first callbacks after a restart are irregular, the trial starts after them
+            juce::AudioIODevice* device{ deviceManager.getCurrentAudioDevice() };
+            xrunsAtTrialStart = device != nullptr ? device->getXRunCount() : -1;
+            resetCallbackStats();
+            task = Task::blockSizeTrial;
+            startTimer(trialMs);
+            break;
+        }
+        case Task::blockSizeTrial:
+            finishBlockSizeTrial();
+            break;
+        case Task::none:
+            stopTimer();
+            break;
+    }
+}
+
+void LatencyTester::finishRoundTrip()
+{
+    pinging = false;
+    juce::AudioIODevice* device{ deviceManager.getCurrentAudioDevice() };
+    const double rate{ device != nullptr ? device->getCurrentSampleRate() : 0.0 };
+    const int count{ numRoundTrips.load(std::memory_order_acquire) };
+    if (count == 0 || rate <= 0)
+    {
+        finish("No click came back. Connect output 1 to input 1 with a cable or a loopback device "
+               "and turn input monitoring off.\n\n" + getDeviceReport());
+        return;
+    }
+
+    int shortest{ roundTrips[0] };
+    int longest{ roundTrips[0] };
+    double sum{ 0 };
+    for (int i = 0; i < count; ++i)
+    {
+        shortest = juce::jmin(shortest, roundTrips[(size_t) i]);
+        longest = juce::jmax(longest, roundTrips[(size_t) i]);
+        sum += roundTrips[(size_t) i];
+    }
+    juce::String report;
+    report << "Round trip: " << samplesToText(sum / count, rate)
+           << ", " << shortest << " to " << longest << " samples over " << count << " clicks";
+    if (numLostPings.load() > 0)
+    {
+        report << ", " << numLostPings.load() << " lost";
+    }
+    report << "\nReported by the device: "
+           << samplesToText(device->getInputLatencyInSamples() + device->getOutputLatencyInSamples(), rate)
+           << "\n\n" << getCallbackReport() << "\n\n" << getDeviceReport();
+    finish(report);
+}
+
+bool LatencyTester::startNextTrial()
+{
+    for (; trialIndex < candidateSizes.size(); ++trialIndex)
+    {
+        juce::AudioDeviceManager::AudioDeviceSetup setup{ originalSetup };
+        setup.bufferSize = candidateSizes[trialIndex];
+        juce::String error{ deviceManager.setAudioDeviceSetup(setup, true) };
+        if (error.isEmpty())
+        {
+            task = Task::blockSizeWarmUp;
+            startTimer(warmUpMs);
+            return true;
+        }
+        trialLog << candidateSizes[trialIndex] << " samples: " << error << "\n";
+    }
+    return false;
+}
+
+void LatencyTester::finishBlockSizeTrial()
+{
+    stopTimer();
+    juce::AudioIODevice* device{ deviceManager.getCurrentAudioDevice() };
+    if (device == nullptr)
+    {
+        finish("The audio device closed during the search.\n\n" + trialLog);
+        return;
+    }
+
+    const int xruns{ device->getXRunCount() };
+    // devices that do not count xruns return -1, the late callbacks stand in for them
+    const int newXruns{ xruns >= 0 && xrunsAtTrialStart >= 0 ? xruns - xrunsAtTrialStart : 0 };
+    const int late{ numLateCallbacks.load() };
+    const double cpu{ deviceManager.getCpuUsage() };
+    const int size{ candidateSizes[trialIndex] };
+    trialLog << size << " samples: " << newXruns << " xruns, " << late << " late callbacks, "
+             << juce::roundToInt(cpu * 100.0) << "% CPU\n";
+
+    if (newXruns == 0 && late == 0 && cpu < maxCpuLoad)
+    {
+        finish("Using blocks of " + samplesToText(size, device->getCurrentSampleRate()) + ".\n\n"
+               + trialLog + "\n" + getCallbackReport());
+        return;
+    }
+    ++trialIndex;
+    if (!startNextTrial())
+    {
+        deviceManager.setAudioDeviceSetup(originalSetup, true);
+        finish("No block size ran cleanly, kept blocks of " + juce::String(originalSetup.bufferSize)
+               + " samples.\n\n" + trialLog);
+    }
+}
+
+void LatencyTester::resetCallbackStats()
+{
+    statsResetRequested = true;
+}
+
+juce::String LatencyTester::getCallbackReport() const
+{
+    const int count{ numCallbacks.load() };
+    if (count < 2)
+    {
+        return "Too few callbacks to time.";
+    }
+    const double mean{ intervalSum.load() / count };
+    const double variance{ juce::jmax(0.0, intervalSquareSum.load() / count - mean * mean) };
+    juce::AudioIODevice* device{ deviceManager.getCurrentAudioDevice() };
+    const int xruns{ device != nullptr ? device->getXRunCount() : -1 };
+
+    juce::String report;
+    report << "Callbacks: " << count << ", every " << juce::String(mean * 1000.0, 2) << " ms"
+           << " (block length " << juce::String(expectedInterval.load() * 1000.0, 2) << " ms)\n"
+           << "Jitter: " << juce::String(std::sqrt(variance) * 1000.0, 3) << " ms, longest gap "
+           << juce::String(longestInterval.load() * 1000.0, 2) << " ms, "
+           << numLateCallbacks.load() << " late\n"
+           << "Xruns: " << (xruns >= 0 ? juce::String(xruns) : juce::String("not counted by this device"));
+    return report;
+}
+
+void LatencyTester::finish(const juce::String& report)
+{
+    stopTimer();
+    task = Task::none;
+    pinging = false;
+    if (onFinished != nullptr)
+    {
+        onFinished(report);
+    }
+}
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    LatencyTester.h
+    Created: 1 May 2024 8:22:16pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+//==============================================================================
+/*
+    Calibrates the audio device. It measures the round trip by sending
+    clicks out of the master outputs and timing their arrival on input 1
+    through a loopback cable. The master is muted for the whole measurement,
+    so music coming back through the loopback is never taken for a click. It
+    also times every audio callback to report jitter and late callbacks. The
+    block size search steps the device through its block sizes, smallest
+    first, and keeps the first one that runs a trial with no xruns, no late
+    callbacks and spare CPU under the current load, so both decks should be
+    playing while it runs.
+
+    The audio callback calls beginBlock before anything overwrites the input
+    and endBlock once the master is mixed, everything else is message thread.
+*/
+class LatencyTester : private juce::Timer
+{
+public:
+    LatencyTester(juce::AudioDeviceManager& _deviceManager);
+    ~LatencyTester() override;
+
+    /**Called from prepareToPlay with the new device format*/
+    void prepare(double sampleRate, int samplesPerBlockExpected);
+    /**Times the callback and listens for a click on the input, audio thread only*/
+    void beginBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+    /**Same for a callback that started at these high resolution ticks, e.g. a simulated one*/
+    void beginBlock(const juce::AudioSourceChannelInfo& bufferToFill, juce::int64 ticks);
+    /**Mutes the master while measuring and adds a click when one is due, audio thread only*/
+    void endBlock(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    /**Measures the round trip through a loopback from output 1 to input 1*/
+    void startRoundTrip();
+    /**Finds and applies the smallest block size that runs without xruns*/
+    void startBlockSizeSearch();
+    /**Checks if a measurement or search is running*/
+    bool isBusy() const;
+    /**Describes the device, its block size, sample rate and reported latencies*/
+    juce::String getDeviceReport() const;
+
+    /**Called on the message thread with a report when a measurement or search ends*/
+    std::function<void(const juce::String& report)> onFinished;
+
+private:
+    enum class Task
+    {
+        none,
+        roundTrip,
+        blockSizeWarmUp,
+        blockSizeTrial
+    };
+
+    void timerCallback() override;
+    void finishRoundTrip();
+    /**Switches the device to the next candidate block size, returns false if there is none*/
+    bool startNextTrial();
+    void finishBlockSizeTrial();
+    /**Asks the audio thread to start the callback statistics over*/
+    void resetCallbackStats();
+    /**Describes the callback timing since the last reset*/
+    juce::String getCallbackReport() const;
+    void finish(const juce::String& report);
+
+    juce::AudioDeviceManager& deviceManager;
+    Task task;
+
+    // round trip, the audio thread writes the measurements and publishes the count
+    static constexpr int numPings{ 8 };
+    std::array<int, numPings> roundTrips;
+    std::atomic<int> numRoundTrips;
+    std::atomic<int> numLostPings;
+    std::atomic<bool> pinging;
+
+    // audio thread only
+    double sampleRate;
+    int blockSize;
+    juce::int64 blockClock;
+    juce::int64 nextPingAt;
+    /**engine sample the click went out on, -1 while none is in flight*/
+    juce::int64 pingSentAt;
+    juce::int64 lastCallbackTicks;
+
+    // callback timing, written by the audio thread
+    std::atomic<bool> statsResetRequested;
+    std::atomic<int> numCallbacks;
+    std::atomic<int> numLateCallbacks;
+    std::atomic<double> intervalSum;
+    std::atomic<double> intervalSquareSum;
+    std::atomic<double> longestInterval;
+    std::atomic<double> expectedInterval;
+
+    // block size search
+    juce::AudioDeviceManager::AudioDeviceSetup originalSetup;
+    std::vector<int> candidateSizes;
+    size_t trialIndex;
+    int xrunsAtTrialStart;
+    juce::String trialLog;
+
+    static constexpr float clickLevel{ 0.9f };
+    /**input level that counts as the click arriving*/
+    static constexpr float detectLevel{ 0.1f };
+    /**a click that has not come back after this long is lost*/
+    static constexpr double pingTimeoutSeconds{ 1.0 };
+    static constexpr double pingIntervalSeconds{ 0.25 };
+    /**silence before the first click, so music already on its way back has arrived*/
+    static constexpr double muteSettleSeconds{ 0.5 };
+    /**a callback this many times later than its block length counts as late*/
+    static constexpr double lateCallbackFactor{ 1.5 };
+    /**highest CPU load a block size may run at*/
+    static constexpr double maxCpuLoad{ 0.75 };
+    static constexpr int warmUpMs{ 500 };
+    static constexpr int trialMs{ 3000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LatencyTester)
+};
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    LibraryImporter.cpp
+    Created: 23 Apr 2024 7:52:14pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "LibraryImporter.h"
+
+//==============================================================================
+LibraryImporter::LibraryImporter(juce::AudioFormatManager& _formatManager,
+                                 WaveformAnalyser& _analyser
+                                ) : formatManager(_formatManager),
+                                    analyser(_analyser),
+                                    workers(juce::SystemStats::getNumCpus()),
+                                    cancelled(false),
+                                    numFiles(0),
+                                    numFinished(0)
+{
+}
+
+LibraryImporter::~LibraryImporter()
+{
+    cancel();
+    workers.removeAllJobs(true, 10000);
+}
+
+void LibraryImporter::start(const juce::Array<juce::File>& files, std::unordered_set<juce::uint64> known)
+{
+    if (isRunning())
+    {
+        DBG("LibraryImporter::start an import is already running");
+        return;
+    }
+
+    {
+        const juce::ScopedLock sl(lock);
+        knownFingerprints = std::move(known);
+        results.clear();
+    }
+    cancelled = false;
+    numFiles = files.size();
+    numFinished = 0;
+    for (const juce::File& file : files)
+    {
+        workers.addJob([this, file] { importFile(file); });
+    }
+}
+
+void LibraryImporter::cancel()
+{
+    cancelled = true;
+    // jobs that have not started are dropped, running ones see the flag
+    workers.removeAllJobs(false, 0);
+}
+
+bool LibraryImporter::isRunning() const
+{
+    return workers.getNumJobs() > 0;
+}
+
+bool LibraryImporter::wasCancelled() const
+{
+    return cancelled;
+}
+
+double LibraryImporter::getProgress() const
+{
+    return numFiles > 0 ? numFinished / (double) numFiles : 0.0;
+}
+
+int LibraryImporter::getNumFiles() const
+{
+    return numFiles;
+}
+
+std::vector<LibraryImporter::Result> LibraryImporter::takeResults()
+{
+    const juce::ScopedLock sl(lock);
+    std::vector<Result> finished;
+    finished.swap(results);
+    return finished;
+}
+
+void LibraryImporter::importFile(const juce::File& file)
+{
+    if (cancelled)
+    {
+        return;
+    }
+
+    Result result{ Track{ file }, Outcome::added };
+    result.track.fingerprint = TrackFingerprint::compute(file);
+    bool firstCopy{ false };
+    if (result.track.fingerprint != 0)
+    {
+        const juce::ScopedLock sl(lock);
+        firstCopy = knownFingerprints.insert(result.track.fingerprint).second;
+    }
+
+    if (result.track.fingerprint == 0)
+    {
+        result.outcome = Outcome::unreadable;
+    }
+    else if (!firstCopy)
+    {
+        // the library decides between a duplicate and a moved file
+        result.outcome = Outcome::duplicate;
+    }
+    else
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+        if (reader == nullptr)
+        {
+            DBG("LibraryImporter could not read " << file.getFullPathName());
+            result.outcome = Outcome::unreadable;
+        }
+        else
+        {
+            result.track.readMetadata(*reader);
+            result.track.dateAdded = juce::Time::currentTimeMillis();
+            if (!analyser.analyseAndStore(result.track.fingerprint, *reader, [this] { return cancelled.load(); }))
+            {
+                // still added, the deck analyses it when it is loaded
+                DBG("LibraryImporter no bands for " << file.getFullPathName());
+            }
+        }
+    }
+
+    {
+        const juce::ScopedLock sl(lock);
+        results.push_back(std::move(result));
+    }
+    ++numFinished;
+}
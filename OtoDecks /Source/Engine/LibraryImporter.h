@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    LibraryImporter.h
+    Created: 23 Apr 2024 7:52:14pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <unordered_set>
+#include <vector>
+#include "Track.h"
+#include "TrackFingerprint.h"
+#include "WaveformAnalyser.h"
+
+//==============================================================================
+/*
+    Imports a batch of files on every core. Each file is a job of its own
+    that hashes it, reads its tags and decodes it once for both the band
+    analysis and the waveform peaks, so the library only has to add the
+    finished tracks. Files whose audio is already in the library, or
+    earlier in the same batch, stop after hashing and come back as
+    duplicates for a single summary.
+*/
+class LibraryImporter
+{
+public:
+    enum class Outcome
+    {
+        added,
+        duplicate,
+        unreadable
+    };
+
+    struct Result
+    {
+        Track track;
+        Outcome outcome;
+    };
+
+    LibraryImporter(juce::AudioFormatManager& _formatManager, WaveformAnalyser& _analyser);
+    /**Cancels the import and waits for the running jobs to stop*/
+    ~LibraryImporter();
+
+    /**Starts importing the files, audio with a fingerprint in known is a duplicate*/
+    void start(const juce::Array<juce::File>& files, std::unordered_set<juce::uint64> known);
+    /**Drops the files not started yet and stops the analysis of the running ones*/
+    void cancel();
+    /**Checks if any job is still queued or running*/
+    bool isRunning() const;
+    bool wasCancelled() const;
+    /**Gets the share of files finished, 0 to 1*/
+    double getProgress() const;
+    /**Gets the number of files in the batch*/
+    int getNumFiles() const;
+    /**Moves out the results finished since the last call*/
+    std::vector<Result> takeResults();
+
+private:
+    /**The job run for every file on the pool*/
+    void importFile(const juce::File& file);
+
+    juce::AudioFormatManager& formatManager;
+    WaveformAnalyser& analyser;
+    juce::ThreadPool workers;
+
+    std::atomic<bool> cancelled;
+    std::atomic<int> numFiles;
+    std::atomic<int> numFinished;
+
+    // shared between the workers and the message thread
+    juce::CriticalSection lock;
+    /**fingerprints of the library and of the files claimed so far in this batch*/
+    std::unordered_set<juce::uint64> knownFingerprints;
+    std::vector<Result> results;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryImporter)
+};
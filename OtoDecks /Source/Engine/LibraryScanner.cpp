@@ -0,0 +1,365 @@
+/*
+  ==============================================================================
+
+    LibraryScanner.cpp
+    Created: 18 Mar 2024 10:15:36pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "LibraryScanner.h"
+#include "TrackFingerprint.h"
+
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+LibraryScanner::LibraryScanner(juce::AudioFormatManager& _formatManager,
+                               Callback _onChanges
+                              ) : juce::Thread("Library Scanner"),
+                                  formatManager(_formatManager),
+                                  onChanges(std::move(_onChanges)),
+                                  fullScanRequested(false)
+{
+#if JUCE_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        DBG("LibraryScanner inotify not available, changes are only found by rescanning");
+    }
+#endif
+    startThread();
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+#if JUCE_LINUX
+    if (inotifyFd >= 0)
+    {
+        close(inotifyFd);
+    }
+#endif
+}
+
+void LibraryScanner::setKnownFiles(std::unordered_map<juce::String, FileStamp> files)
+{
+    const juce::ScopedLock sl(lock);
+    pendingKnownFiles = std::make_unique<std::unordered_map<juce::String, FileStamp>>(std::move(files));
+}
+
+void LibraryScanner::addRoot(const juce::File& folder)
+{
+    if (!folder.isDirectory())
+    {
+        DBG("LibraryScanner::addRoot " << folder.getFullPathName() << " is not a folder");
+        return;
+    }
+    {
+        const juce::ScopedLock sl(lock);
+        if (roots.contains(folder))
+        {
+            return;
+        }
+        roots.add(folder);
+        rootsToScan.add(folder);
+    }
+    notify();
+}
+
+juce::Array<juce::File> LibraryScanner::getRoots() const
+{
+    const juce::ScopedLock sl(lock);
+    return roots;
+}
+
+void LibraryScanner::rescanAll()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        fullScanRequested = true;
+    }
+    notify();
+}
+
+void LibraryScanner::run()
+{
+#if !JUCE_LINUX
+    juce::uint32 lastFullScan{ juce::Time::getMillisecondCounter() };
+#endif
+
+    while (!threadShouldExit())
+    {
+        Changes changes;
+        juce::Array<juce::File> newRoots;
+        juce::Array<juce::File> allRoots;
+        bool fullScan;
+        {
+            const juce::ScopedLock sl(lock);
+            if (pendingKnownFiles != nullptr)
+            {
+                knownFiles = std::move(*pendingKnownFiles);
+                pendingKnownFiles.reset();
+            }
+            newRoots.swapWith(rootsToScan);
+            allRoots = roots;
+            fullScan = fullScanRequested;
+            fullScanRequested = false;
+        }
+
+        // formats are registered by now, so the wildcard is complete
+        wildcard = formatManager.getWildcardForAllFormats();
+
+#if !JUCE_LINUX
+        if (juce::Time::getMillisecondCounter() - lastFullScan > (juce::uint32) pollIntervalMs)
+        {
+            fullScan = true;
+        }
+#endif
+
+        ScanPass pass;
+        for (const juce::File& root : (fullScan ? allRoots : newRoots))
+        {
+#if JUCE_LINUX
+            addWatches(root);
+#endif
+            scanDirectory(root, true, changes, pass);
+        }
+        removeMissing(pass, changes);
+#if !JUCE_LINUX
+        if (fullScan)
+        {
+            lastFullScan = juce::Time::getMillisecondCounter();
+        }
+#endif
+        postChanges(changes);
+
+#if JUCE_LINUX
+        if (inotifyFd < 0)
+        {
+            wait(-1);
+            continue;
+        }
+
+        pollfd descriptor{ inotifyFd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 500) <= 0)
+        {
+            continue;
+        }
+
+        // let a burst of events settle, e.g. a folder being copied in
+        juce::StringArray dirtyDirs;
+        juce::StringArray dirtyTrees;
+        do
+        {
+            readEvents(dirtyDirs, dirtyTrees);
+        }
+        while (!threadShouldExit() && poll(&descriptor, 1, 1000) > 0);
+
+        ScanPass dirtyPass;
+        for (const juce::String& dir : dirtyTrees)
+        {
+            addWatches(juce::File{ dir });
+            scanDirectory(juce::File{ dir }, true, changes, dirtyPass);
+        }
+        for (const juce::String& dir : dirtyDirs)
+        {
+            scanDirectory(juce::File{ dir }, false, changes, dirtyPass);
+        }
+        removeMissing(dirtyPass, changes);
+        postChanges(changes);
+#else
+        wait(pollIntervalMs);
+#endif
+    }
+}
+
+void LibraryScanner::scanDirectory(const juce::File& dir, bool recursive, Changes& changes, ScanPass& pass)
+{
+    (recursive ? pass.trees : pass.dirs).insert(dir.getFullPathName());
+
+    for (const juce::DirectoryEntry& entry : juce::RangedDirectoryIterator(dir,
+                                                                           recursive,
+                                                                           wildcard,
+                                                                           juce::File::findFiles))
+    {
+        if (threadShouldExit())
+        {
+            return;
+        }
+
+        juce::File file{ entry.getFile() };
+        juce::String path{ file.getFullPathName() };
+        FileStamp stamp{ entry.getFileSize(), entry.getModificationTime().toMilliseconds() };
+        pass.present.insert(path);
+
+        auto known = knownFiles.find(path);
+        if (known == knownFiles.end())
+        {
+            if (probe(file, stamp, changes.added))
+            {
+                knownFiles[path] = stamp;
+            }
+        }
+        else if (!(known->second == stamp))
+        {
+            if (probe(file, stamp, changes.modified))
+            {
+                known->second = stamp;
+            }
+        }
+    }
+}
+
+void LibraryScanner::removeMissing(const ScanPass& pass, Changes& changes)
+{
+    // a scan cut short did not see everything, so it cannot tell what has gone
+    if (threadShouldExit() || (pass.dirs.empty() && pass.trees.empty()))
+    {
+        return;
+    }
+
+    // anything known in a scanned folder that was not seen has gone, one sweep whatever the number of folders
+    for (auto it = knownFiles.begin(); it != knownFiles.end();)
+    {
+        bool below{ false };
+        if (pass.present.count(it->first) == 0)
+        {
+            juce::File parent{ juce::File{ it->first }.getParentDirectory() };
+            below = pass.dirs.count(parent.getFullPathName()) > 0;
+            for (; !below && !parent.isRoot(); parent = parent.getParentDirectory())
+            {
+                below = pass.trees.count(parent.getFullPathName()) > 0;
+            }
+        }
+        if (below)
+        {
+            changes.removed.add(it->first);
+            it = knownFiles.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+bool LibraryScanner::probe(const juce::File& file, const FileStamp& stamp, std::vector<Track>& tracks)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+    if (reader == nullptr)
+    {
+        // possibly still being copied, the next change event probes it again
+        DBG("LibraryScanner could not read " << file.getFullPathName());
+        return false;
+    }
+
+    Track track{ file };
+    track.readMetadata(*reader);
+    track.fileSize = stamp.size;
+    track.modificationTime = stamp.modificationTime;
+    track.fingerprint = TrackFingerprint::compute(file);
+    track.dateAdded = juce::Time::currentTimeMillis();
+    tracks.push_back(track);
+    return true;
+}
+
+void LibraryScanner::postChanges(Changes& changes)
+{
+    if (changes.isEmpty() || threadShouldExit())
+    {
+        return;
+    }
+
+    DBG("LibraryScanner found " << (int) changes.added.size() << " new, "
+        << (int) changes.modified.size() << " modified and "
+        << changes.removed.size() << " removed files");
+
+    auto result = std::make_shared<Changes>(std::move(changes));
+    changes = Changes{};
+    Callback callback{ onChanges };
+    juce::MessageManager::callAsync([callback, result] { callback(std::move(*result)); });
+}
+
+#if JUCE_LINUX
+void LibraryScanner::addWatches(const juce::File& dir)
+{
+    if (inotifyFd < 0 || !dir.isDirectory())
+    {
+        return;
+    }
+
+    const juce::uint32 mask{ IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                             | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR };
+
+    juce::Array<juce::File> dirs{ dir };
+    for (const juce::DirectoryEntry& entry : juce::RangedDirectoryIterator(dir, true, "*",
+                                                                           juce::File::findDirectories))
+    {
+        dirs.add(entry.getFile());
+    }
+
+    for (const juce::File& d : dirs)
+    {
+        int wd{ inotify_add_watch(inotifyFd, d.getFullPathName().toRawUTF8(), mask) };
+        if (wd >= 0)
+        {
+            watchedDirs[wd] = d.getFullPathName();
+        }
+        else
+        {
+            DBG("LibraryScanner could not watch " << d.getFullPathName());
+        }
+    }
+}
+
+void LibraryScanner::readEvents(juce::StringArray& dirtyDirs, juce::StringArray& dirtyTrees)
+{
+    alignas(inotify_event) char buffer[8192];
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* ptr = buffer; ptr < buffer + length;)
+        {
+            const inotify_event* event{ reinterpret_cast<const inotify_event*>(ptr) };
+            ptr += sizeof(inotify_event) + event->len;
+
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                // events were lost, only walking every root again finds what they said
+                DBG("LibraryScanner inotify queue overflowed, rescanning everything");
+                const juce::ScopedLock sl(lock);
+                fullScanRequested = true;
+                continue;
+            }
+
+            auto watched = watchedDirs.find(event->wd);
+            if (watched == watchedDirs.end())
+            {
+                continue;
+            }
+            if ((event->mask & IN_IGNORED) != 0)
+            {
+                watchedDirs.erase(watched);
+                continue;
+            }
+
+            if ((event->mask & IN_ISDIR) != 0 && event->len > 0)
+            {
+                // a whole folder appeared or went away
+                dirtyTrees.addIfNotAlreadyThere(juce::File{ watched->second }.getChildFile(event->name).getFullPathName());
+            }
+            else
+            {
+                dirtyDirs.addIfNotAlreadyThere(watched->second);
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    LibraryScanner.h
+    Created: 18 Mar 2024 10:15:36pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_events/juce_events.h>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include "Track.h"
+
+//==============================================================================
+/*
+    Keeps the library in sync with a set of watched root folders. Files are
+    only probed when they are new or their size or modification time changed.
+    On Linux directory changes come from inotify and only the directories
+    that changed are rescanned; elsewhere the roots are polled.
+*/
+class LibraryScanner : private juce::Thread
+{
+public:
+    struct FileStamp
+    {
+        juce::int64 size;
+        juce::int64 modificationTime;
+        bool operator==(const FileStamp& other) const
+        {
+            return size == other.size && modificationTime == other.modificationTime;
+        }
+    };
+
+    struct Changes
+    {
+        std::vector<Track> added;
+        std::vector<Track> modified;
+        juce::StringArray removed;
+        bool isEmpty() const { return added.empty() && modified.empty() && removed.isEmpty(); }
+    };
+
+    using Callback = std::function<void(Changes)>;
+
+    /**onChanges is called on the message thread after each scan that found changes*/
+    LibraryScanner(juce::AudioFormatManager& _formatManager, Callback _onChanges);
+    ~LibraryScanner() override;
+
+    /**Sets the files the library already holds so they are not probed again*/
+    void setKnownFiles(std::unordered_map<juce::String, FileStamp> files);
+    /**Starts watching folder and scans it in the background*/
+    void addRoot(const juce::File& folder);
+    /**Gets the folders being watched*/
+    juce::Array<juce::File> getRoots() const;
+    /**Walks every root again, still only probing changed files*/
+    void rescanAll();
+
+private:
+    /**What a round of scans saw, so files that went away are found in one sweep*/
+    struct ScanPass
+    {
+        std::unordered_set<juce::String> present;
+        /**folders scanned without their subfolders*/
+        std::unordered_set<juce::String> dirs;
+        /**folders scanned with everything below them*/
+        std::unordered_set<juce::String> trees;
+    };
+
+    void run() override;
+    /**Compares the files in dir against the known files, collecting new and modified ones*/
+    void scanDirectory(const juce::File& dir, bool recursive, Changes& changes, ScanPass& pass);
+    /**Removes the known files in the scanned folders that the scans did not see*/
+    void removeMissing(const ScanPass& pass, Changes& changes);
+    bool probe(const juce::File& file, const FileStamp& stamp, std::vector<Track>& tracks);
+    void postChanges(Changes& changes);
+
+    juce::AudioFormatManager& formatManager;
+    Callback onChanges;
+
+    juce::CriticalSection lock;
+    juce::Array<juce::File> roots;
+    juce::Array<juce::File> rootsToScan;
+    std::unique_ptr<std::unordered_map<juce::String, FileStamp>> pendingKnownFiles;
+    bool fullScanRequested;
+
+    // only touched by the scanner thread
+    std::unordered_map<juce::String, FileStamp> knownFiles;
+    juce::String wildcard;
+
+#if JUCE_LINUX
+    void addWatches(const juce::File& dir);
+    /**Reads pending inotify events into the set of directories to rescan*/
+    void readEvents(juce::StringArray& dirtyDirs, juce::StringArray& dirtyTrees);
+
+    int inotifyFd;
+    std::unordered_map<int, juce::String> watchedDirs;
+#else
+    static constexpr int pollIntervalMs{ 30000 };
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryScanner)
+};
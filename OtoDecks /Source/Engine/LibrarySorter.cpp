@@ -0,0 +1,433 @@
+/*
+  ==============================================================================
+
+    LibrarySorter.cpp
+    Created: 14 Mar 2024 8:47:03pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "LibrarySorter.h"
+
+namespace
+{
+    /**Maps a double onto an unsigned integer with the same ordering*/
+    juce::uint64 orderedBits(double value)
+    {
+        juce::uint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x8000000000000000ull) != 0 ? ~bits : bits | 0x8000000000000000ull;
+    }
+
+    /**Maps a signed integer onto an unsigned integer with the same ordering*/
+    juce::uint64 orderedBits(juce::int64 value)
+    {
+        return (juce::uint64) value ^ 0x8000000000000000ull;
+    }
+
+    /**Parses seconds, also accepting minutes:seconds*/
+    double parseFilterNumber(const juce::String& text)
+    {
+        if (text.containsChar(':'))
+        {
+            return text.upToFirstOccurrenceOf(":", false, false).getDoubleValue() * 60.0
+                 + text.fromFirstOccurrenceOf(":", false, false).getDoubleValue();
+        }
+        return text.getDoubleValue();
+    }
+
+    TrackFilter::Range parseRange(const juce::String& text)
+    {
+        TrackFilter::Range range;
+        range.active = true;
+        if (text.startsWithChar('>'))
+        {
+            range.min = parseFilterNumber(text.substring(1));
+        }
+        else if (text.startsWithChar('<'))
+        {
+            range.max = parseFilterNumber(text.substring(1));
+        }
+        else if (text.containsChar('-'))
+        {
+            range.min = parseFilterNumber(text.upToFirstOccurrenceOf("-", false, false));
+            range.max = parseFilterNumber(text.fromFirstOccurrenceOf("-", false, false));
+        }
+        else
+        {
+            range.min = range.max = parseFilterNumber(text);
+        }
+        return range;
+    }
+
+    template <typename ValueType>
+    void applyRange(const TrackFilter::Range& range,
+                    const std::vector<ValueType>& column,
+                    std::vector<juce::uint8>& mask)
+    {
+        if (!range.active)
+        {
+            return;
+        }
+        const size_t n{ column.size() };
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] &= (juce::uint8) range.contains((double) column[i]);
+        }
+    }
+}
+
+//==============================================================================
+bool TrackFilter::isEmpty() const
+{
+    return !duration.active && !bpm.active && !bitrate.active
+        && !sampleRate.active && !playCount.active && key < 0;
+}
+
+void TrackFilter::apply(const TrackLibrary::Columns& columns, std::vector<juce::uint8>& mask) const
+{
+    applyRange(duration, columns.durations, mask);
+    applyRange(bpm, columns.bpms, mask);
+    applyRange(bitrate, columns.bitrates, mask);
+    applyRange(sampleRate, columns.sampleRates, mask);
+    applyRange(playCount, columns.playCounts, mask);
+
+    if (key >= 0)
+    {
+        const size_t n{ columns.keys.size() };
+        for (size_t i = 0; i < n; ++i)
+        {
+            mask[i] &= (juce::uint8) (columns.keys[i] == key);
+        }
+    }
+}
+
+TrackFilter TrackFilter::parse(const juce::String& text, juce::String& remainingText)
+{
+    TrackFilter filter;
+    juce::StringArray remaining;
+
+    for (const juce::String& token : juce::StringArray::fromTokens(text, " ", "\""))
+    {
+        juce::String field{ token.upToFirstOccurrenceOf(":", false, false).toLowerCase() };
+        juce::String value{ token.fromFirstOccurrenceOf(":", false, false) };
+
+        if (!token.containsChar(':') || value.isEmpty())
+        {
+            remaining.add(token);
+        }
+        else if (field == "bpm")
+        {
+            filter.bpm = parseRange(value);
+        }
+        else if (field == "key")
+        {
+            filter.key = Track::parseKey(value);
+        }
+        else if (field == "dur" || field == "time")
+        {
+            filter.duration = parseRange(value);
+        }
+        else if (field == "kbps" || field == "bitrate")
+        {
+            filter.bitrate = parseRange(value);
+        }
+        else if (field == "rate" || field == "khz")
+        {
+            filter.sampleRate = parseRange(value);
+            // allow "rate:44.1" as well as "rate:44100"
+            if (filter.sampleRate.max < 1000.0)
+            {
+                filter.sampleRate.min *= 1000.0;
+                filter.sampleRate.max *= 1000.0;
+            }
+        }
+        else if (field == "plays")
+        {
+            filter.playCount = parseRange(value);
+        }
+        else
+        {
+            remaining.add(token);
+        }
+    }
+
+    remainingText = remaining.joinIntoString(" ");
+    return filter;
+}
+
+//==============================================================================
+LibrarySorter::LibrarySorter() : juce::Thread("Library Sorter"),
+                                 workers(juce::SystemStats::getNumCpus())
+{
+    startThread();
+}
+
+LibrarySorter::~LibrarySorter()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+}
+
+void LibrarySorter::requestView(TrackLibrary::Columns snapshot,
+                                std::vector<SortKey> sortKeys,
+                                TrackFilter filter,
+                                Callback onFinished)
+{
+    auto request = std::make_unique<Request>();
+    request->columns = std::move(snapshot);
+    request->sortKeys = std::move(sortKeys);
+    request->filter = filter;
+    request->onFinished = std::move(onFinished);
+    {
+        const juce::ScopedLock sl(requestLock);
+        pendingRequest = std::move(request);
+    }
+    notify();
+}
+
+void LibrarySorter::run()
+{
+    while (!threadShouldExit())
+    {
+        std::unique_ptr<Request> request;
+        {
+            const juce::ScopedLock sl(requestLock);
+            request = std::move(pendingRequest);
+        }
+
+        if (request == nullptr)
+        {
+            wait(-1);
+            continue;
+        }
+
+        double startTime{ juce::Time::getMillisecondCounterHiRes() };
+        std::vector<TrackId> view{ buildView(*request) };
+        DBG("LibrarySorter built view of " << (int) view.size() << " rows in "
+            << juce::Time::getMillisecondCounterHiRes() - startTime << " ms");
+
+        bool superseded;
+        {
+            const juce::ScopedLock sl(requestLock);
+            superseded = pendingRequest != nullptr;
+        }
+
+        if (!superseded && !threadShouldExit())
+        {
+            Callback onFinished{ request->onFinished };
+            juce::MessageManager::callAsync([onFinished, view] { onFinished(view); });
+        }
+    }
+}
+
+std::vector<TrackId> LibrarySorter::buildView(const Request& request)
+{
+    const TrackLibrary::Columns& columns{ request.columns };
+    const int numTracks{ (int) columns.ids.size() };
+
+    std::vector<juce::uint8> mask(numTracks, 1);
+    request.filter.apply(columns, mask);
+
+    // the id always breaks ties, ids grow with insertion so that is the default order
+    const int numKeys{ juce::jmin((int) request.sortKeys.size(), maxSortKeys) };
+    std::vector<std::vector<juce::uint64>> keyColumns(numKeys);
+    runOnWorkers(numKeys, [&](int k)
+    {
+        buildKeys(columns, request.sortKeys[k], keyColumns[k]);
+    });
+
+    std::vector<SortEntry> entries;
+    entries.reserve(numTracks);
+    for (int i = 0; i < numTracks; ++i)
+    {
+        if (mask[i] != 0)
+        {
+            SortEntry entry;
+            for (int k = 0; k < maxSortKeys; ++k)
+            {
+                entry.keys[k] = k < numKeys ? keyColumns[k][i] : 0;
+            }
+            entry.id = columns.ids[i];
+            entries.push_back(entry);
+        }
+    }
+
+    parallelSort(entries, numKeys);
+
+    std::vector<TrackId> view;
+    view.reserve(entries.size());
+    for (const SortEntry& entry : entries)
+    {
+        view.push_back(entry.id);
+    }
+    return view;
+}
+
+void LibrarySorter::buildKeys(const TrackLibrary::Columns& columns,
+                              const SortKey& sortKey,
+                              std::vector<juce::uint64>& keys)
+{
+    const size_t n{ columns.ids.size() };
+    keys.resize(n);
+
+    switch (sortKey.column)
+    {
+        case TrackLibrary::Column::title:
+        {
+            // titles are ranked once so the main sort only compares integers
+            std::vector<juce::String> titles(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                titles[i] = columns.getTitle(i);
+            }
+            std::vector<int> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&titles](int a, int b)
+            {
+                return titles[a].compareNatural(titles[b]) < 0;
+            });
+            juce::uint64 rank{ 0 };
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (i > 0 && titles[order[i]].compareNatural(titles[order[i - 1]]) != 0)
+                {
+                    ++rank;
+                }
+                keys[order[i]] = rank;
+            }
+            break;
+        }
+        case TrackLibrary::Column::duration:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits(columns.durations[i]);
+            break;
+        case TrackLibrary::Column::bpm:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits((double) columns.bpms[i]);
+            break;
+        case TrackLibrary::Column::key:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits((juce::int64) columns.keys[i]);
+            break;
+        case TrackLibrary::Column::bitrate:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits((juce::int64) columns.bitrates[i]);
+            break;
+        case TrackLibrary::Column::sampleRate:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits((juce::int64) columns.sampleRates[i]);
+            break;
+        case TrackLibrary::Column::dateAdded:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits(columns.datesAdded[i]);
+            break;
+        case TrackLibrary::Column::playCount:
+            for (size_t i = 0; i < n; ++i) keys[i] = orderedBits((juce::int64) columns.playCounts[i]);
+            break;
+        default:
+            std::fill(keys.begin(), keys.end(), 0);
+            break;
+    }
+
+    if (!sortKey.forwards)
+    {
+        for (juce::uint64& key : keys)
+        {
+            key = ~key;
+        }
+    }
+}
+
+void LibrarySorter::parallelSort(std::vector<SortEntry>& entries, int numKeys)
+{
+    auto less = [numKeys](const SortEntry& a, const SortEntry& b)
+    {
+        for (int k = 0; k < numKeys; ++k)
+        {
+            if (a.keys[k] != b.keys[k])
+            {
+                return a.keys[k] < b.keys[k];
+            }
+        }
+        return a.id < b.id;
+    };
+
+    const size_t minChunkSize{ 16384 };
+    const int numChunks{ juce::jlimit(1, workers.getNumThreads(), (int) (entries.size() / minChunkSize)) };
+    if (numChunks == 1)
+    {
+        std::sort(entries.begin(), entries.end(), less);
+        return;
+    }
+
+    // sort equal chunks on every worker...
+    std::vector<size_t> runs(numChunks + 1);
+    for (int i = 0; i <= numChunks; ++i)
+    {
+        runs[i] = entries.size() * i / numChunks;
+    }
+    runOnWorkers(numChunks, [&](int i)
+    {
+        std::sort(entries.begin() + runs[i], entries.begin() + runs[i + 1], less);
+    });
+
+    // ...then merge neighbouring runs pairwise until one run is left
+    std::vector<SortEntry> scratch(entries.size());
+    std::vector<SortEntry>* source{ &entries };
+    std::vector<SortEntry>* destination{ &scratch };
+    while (runs.size() > 2)
+    {
+        const int numRuns{ (int) runs.size() - 1 };
+        runOnWorkers(numRuns / 2, [&](int pair)
+        {
+            size_t lo{ runs[2 * pair] };
+            size_t mid{ runs[2 * pair + 1] };
+            size_t hi{ runs[2 * pair + 2] };
+            std::merge(source->begin() + lo, source->begin() + mid,
+                       source->begin() + mid, source->begin() + hi,
+                       destination->begin() + lo, less);
+        });
+        if (numRuns % 2 != 0)
+        {
+            std::copy(source->begin() + runs[numRuns - 1], source->end(),
+                      destination->begin() + runs[numRuns - 1]);
+        }
+
+        std::vector<size_t> mergedRuns;
+        for (size_t i = 0; i < runs.size(); i += 2)
+        {
+            mergedRuns.push_back(runs[i]);
+        }
+        if (mergedRuns.back() != runs.back())
+        {
+            mergedRuns.push_back(runs.back());
+        }
+        runs.swap(mergedRuns);
+        std::swap(source, destination);
+    }
+
+    if (source != &entries)
+    {
+        entries.swap(scratch);
+    }
+}
+
+void LibrarySorter::runOnWorkers(int numJobs, std::function<void(int)> job)
+{
+    if (numJobs <= 0)
+    {
+        return;
+    }
+
+    std::atomic<int> remaining{ numJobs };
+    juce::WaitableEvent finished;
+    for (int i = 0; i < numJobs; ++i)
+    {
+        workers.addJob([&, i]
+        {
+            job(i);
+            if (--remaining == 0)
+            {
+                finished.signal();
+            }
+        });
+    }
+    finished.wait();
+}
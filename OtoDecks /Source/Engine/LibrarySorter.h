@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    LibrarySorter.h
+    Created: 14 Mar 2024 8:47:03pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include <vector>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <atomic>
+#include "TrackLibrary.h"
+
+//==============================================================================
+/*
+    Range predicates over the library columns. Each predicate is evaluated
+    column by column over the whole array rather than track by track.
+*/
+struct TrackFilter
+{
+    /**Inclusive numeric range, unbounded ends are +-infinity*/
+    struct Range
+    {
+        double min{ -std::numeric_limits<double>::infinity() };
+        double max{ std::numeric_limits<double>::infinity() };
+        bool active{ false };
+        bool contains(double value) const { return value >= min && value <= max; }
+    };
+
+    Range duration;
+    Range bpm;
+    Range bitrate;
+    Range sampleRate;
+    Range playCount;
+    /**Camelot key index, -1 for any key*/
+    int key{ -1 };
+
+    /**Checks if no predicate is set*/
+    bool isEmpty() const;
+    /**Clears mask entries of tracks that do not pass every predicate*/
+    void apply(const TrackLibrary::Columns& columns, std::vector<juce::uint8>& mask) const;
+
+    /**Parses tokens like "bpm:120-128", "key:8A", "dur:<4:00" or "plays:>0".
+       Anything that is not a filter token is returned in remainingText.*/
+    static TrackFilter parse(const juce::String& text, juce::String& remainingText);
+};
+
+//==============================================================================
+/*
+    Filters and sorts snapshots of the library on a background thread so
+    re-sorting a large collection never blocks the message thread. Sorting
+    precomputes one order-preserving integer key per sort column and then
+    sorts chunks in parallel before merging them.
+*/
+class LibrarySorter : private juce::Thread
+{
+public:
+    static constexpr int maxSortKeys = 3;
+
+    struct SortKey
+    {
+        TrackLibrary::Column column;
+        bool forwards;
+    };
+
+    using Callback = std::function<void(std::vector<TrackId>)>;
+
+    LibrarySorter();
+    ~LibrarySorter() override;
+
+    /**Builds the visible row order from snapshot in the background and calls
+       onFinished with it on the message thread. A newer request replaces a
+       pending one, whose callback is then never called.*/
+    void requestView(TrackLibrary::Columns snapshot,
+                     std::vector<SortKey> sortKeys,
+                     TrackFilter filter,
+                     Callback onFinished);
+
+private:
+    struct Request
+    {
+        TrackLibrary::Columns columns;
+        std::vector<SortKey> sortKeys;
+        TrackFilter filter;
+        Callback onFinished;
+    };
+
+    struct SortEntry
+    {
+        juce::uint64 keys[maxSortKeys];
+        TrackId id;
+    };
+
+    void run() override;
+    std::vector<TrackId> buildView(const Request& request);
+    void buildKeys(const TrackLibrary::Columns& columns,
+                   const SortKey& sortKey,
+                   std::vector<juce::uint64>& keys);
+    void parallelSort(std::vector<SortEntry>& entries, int numKeys);
+    /**Runs job(0) .. job(numJobs - 1) on the worker pool and waits for all of them*/
+    void runOnWorkers(int numJobs, std::function<void(int)> job);
+
+    juce::CriticalSection requestLock;
+    std::unique_ptr<Request> pendingRequest;
+    juce::ThreadPool workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibrarySorter)
+};
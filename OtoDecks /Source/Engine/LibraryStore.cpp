@@ -0,0 +1,562 @@
+/*
+  ==============================================================================
+
+    LibraryStore.cpp
+    Created: 14 Apr 2024 8:41:09pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "LibraryStore.h"
+
+//==============================================================================
+LibraryStore::AudioData::AudioData() : loopStart(-1),
+                                       loopEnd(-1)
+{
+    cues.fill(-1.0);
+}
+
+LibraryStore::LibraryStore(const juce::File& _directory) : juce::Thread("Library Store"),
+                                                           directory(_directory),
+                                                           snapshotFile(_directory.getChildFile("library.snapshot")),
+                                                           logFile(_directory.getChildFile("library.wal")),
+                                                           opened(false),
+                                                           created(false),
+                                                           generation(0),
+                                                           logSize(0)
+{
+    if (!directory.createDirectory())
+    {
+        DBG("LibraryStore could not create " << directory.getFullPathName());
+        return;
+    }
+    created = !snapshotFile.existsAsFile() && !logFile.existsAsFile();
+
+    const juce::ScopedLock fl(fileLock);
+    const juce::ScopedLock sl(stateLock);
+    char magic[magicSize];
+    if (snapshotFile.existsAsFile())
+    {
+        juce::FileInputStream in{ snapshotFile };
+        if (!in.openedOk() || in.read(magic, magicSize) != magicSize
+            || std::memcmp(magic, snapshotMagic, magicSize) != 0)
+        {
+            // do not open, the next compaction would overwrite whatever is in there
+            DBG("LibraryStore could not read " << snapshotFile.getFullPathName());
+            return;
+        }
+        generation = (juce::uint64) in.readInt64();
+        if (replay(in) < in.getTotalLength())
+        {
+            DBG("LibraryStore the snapshot is damaged, kept the records before the damage");
+        }
+    }
+
+    juce::int64 logEnd{ -1 };
+    if (logFile.existsAsFile())
+    {
+        juce::FileInputStream in{ logFile };
+        if (in.openedOk() && in.read(magic, magicSize) == magicSize
+            && std::memcmp(magic, logMagic, magicSize) == 0)
+        {
+            juce::uint64 logGeneration{ (juce::uint64) in.readInt64() };
+            if (logGeneration == generation)
+            {
+                logEnd = replay(in);
+                if (logEnd < in.getTotalLength())
+                {
+                    // a crash in the middle of a write, everything before it was committed
+                    DBG("LibraryStore dropped " << in.getTotalLength() - logEnd << " bytes of a torn record");
+                }
+            }
+            else
+            {
+                DBG("LibraryStore the log is older than the snapshot, its changes are already in there");
+            }
+        }
+    }
+
+    if (logEnd >= 0)
+    {
+        log = std::make_unique<juce::FileOutputStream>(logFile);
+        if (!log->openedOk())
+        {
+            DBG("LibraryStore could not write " << logFile.getFullPathName());
+            log.reset();
+            return;
+        }
+        log->setPosition(logEnd);
+        log->truncate();
+        log->flush();
+        logSize = logEnd;
+    }
+    else if (!createLog())
+    {
+        return;
+    }
+
+    opened = true;
+    startThread();
+}
+
+LibraryStore::~LibraryStore()
+{
+    stopThread(2000);
+    flush();
+}
+
+bool LibraryStore::isOpen() const
+{
+    return opened;
+}
+
+bool LibraryStore::isNew() const
+{
+    return created;
+}
+
+TrackLibrary::Columns LibraryStore::getTracks() const
+{
+    const juce::ScopedLock sl(stateLock);
+    return tracks.createSnapshot();
+}
+
+void LibraryStore::putTrack(TrackId id, const Track& track)
+{
+    juce::MemoryOutputStream payload;
+    writeTrack(payload, id, track);
+    commit(RecordType::putTrack, payload);
+}
+
+void LibraryStore::removeTrack(TrackId id)
+{
+    juce::MemoryOutputStream payload;
+    payload.writeInt((int) id);
+    commit(RecordType::removeTrack, payload);
+}
+
+void LibraryStore::recordPlay(TrackId id, int deck)
+{
+    juce::MemoryOutputStream payload;
+    writePlay(payload, Play{ id, juce::Time::currentTimeMillis(), deck });
+    commit(RecordType::play, payload);
+}
+
+std::vector<LibraryStore::Play> LibraryStore::getPlays(TrackId id) const
+{
+    const juce::ScopedLock sl(stateLock);
+    std::vector<Play> result;
+    for (const Play& play : plays)
+    {
+        if (play.id == id)
+        {
+            result.push_back(play);
+        }
+    }
+    return result;
+}
+
+void LibraryStore::setCues(juce::uint64 fingerprint, const Cues& cues)
+{
+    if (fingerprint == 0)
+    {
+        DBG("LibraryStore::setCues the audio has no fingerprint");
+        return;
+    }
+    juce::MemoryOutputStream payload;
+    writeCues(payload, fingerprint, cues);
+    commit(RecordType::cues, payload);
+}
+
+LibraryStore::Cues LibraryStore::getCues(juce::uint64 fingerprint) const
+{
+    const juce::ScopedLock sl(stateLock);
+    auto it = audioData.find(fingerprint);
+    return it != audioData.end() ? it->second.cues : AudioData{}.cues;
+}
+
+void LibraryStore::setLoop(juce::uint64 fingerprint, double start, double end)
+{
+    if (fingerprint == 0)
+    {
+        DBG("LibraryStore::setLoop the audio has no fingerprint");
+        return;
+    }
+    juce::MemoryOutputStream payload;
+    writeLoop(payload, fingerprint, start, end);
+    commit(RecordType::loop, payload);
+}
+
+bool LibraryStore::getLoop(juce::uint64 fingerprint, double& start, double& end) const
+{
+    const juce::ScopedLock sl(stateLock);
+    auto it = audioData.find(fingerprint);
+    if (it == audioData.end() || it->second.loopStart < 0 || it->second.loopEnd <= it->second.loopStart)
+    {
+        return false;
+    }
+    start = it->second.loopStart;
+    end = it->second.loopEnd;
+    return true;
+}
+
+void LibraryStore::setAnalysis(juce::uint64 fingerprint, const juce::MemoryBlock& data)
+{
+    if (fingerprint == 0)
+    {
+        DBG("LibraryStore::setAnalysis the audio has no fingerprint");
+        return;
+    }
+    juce::MemoryOutputStream payload;
+    writeAnalysis(payload, fingerprint, data);
+    commit(RecordType::analysis, payload);
+}
+
+juce::MemoryBlock LibraryStore::getAnalysis(juce::uint64 fingerprint) const
+{
+    const juce::ScopedLock sl(stateLock);
+    auto it = audioData.find(fingerprint);
+    return it != audioData.end() ? it->second.analysis : juce::MemoryBlock{};
+}
+
+void LibraryStore::flush()
+{
+    const juce::ScopedLock fl(fileLock);
+    writePending();
+}
+
+void LibraryStore::run()
+{
+    // changes made between passes are synced together, one fsync for a whole import
+    while (!threadShouldExit())
+    {
+        wait(syncIntervalMs);
+        flush();
+    }
+}
+
+void LibraryStore::commit(RecordType type, const juce::MemoryOutputStream& payload)
+{
+    const juce::ScopedLock sl(stateLock);
+    apply(type, payload.getData(), payload.getDataSize());
+    if (opened)
+    {
+        juce::MemoryOutputStream records{ pending, true };
+        writeRecord(records, type, payload.getData(), payload.getDataSize());
+    }
+}
+
+void LibraryStore::apply(RecordType type, const void* data, size_t size)
+{
+    juce::MemoryInputStream in{ data, size, false };
+    switch (type)
+    {
+        case RecordType::putTrack:
+        {
+            TrackId id{ (TrackId) in.readInt() };
+            Track track{ juce::File{ in.readString() } };
+            track.duration = in.readDouble();
+            track.bpm = in.readFloat();
+            track.key = in.readInt();
+            track.bitrate = in.readInt();
+            track.sampleRate = in.readInt();
+            track.dateAdded = in.readInt64();
+            track.playCount = in.readInt();
+            track.fileSize = in.readInt64();
+            track.modificationTime = in.readInt64();
+            track.fingerprint = (juce::uint64) in.readInt64();
+            if (tracks.contains(id))
+            {
+                tracks.setTrack(id, track);
+            }
+            else
+            {
+                tracks.addTrack(track, id);
+            }
+            break;
+        }
+        case RecordType::removeTrack:
+        {
+            TrackId id{ (TrackId) in.readInt() };
+            if (tracks.contains(id))
+            {
+                tracks.removeTrack(id);
+            }
+            plays.erase(std::remove_if(plays.begin(), plays.end(),
+                [id](const Play& play) {return play.id == id; }),
+                plays.end());
+            break;
+        }
+        case RecordType::play:
+        {
+            Play play;
+            play.id = (TrackId) in.readInt();
+            play.time = in.readInt64();
+            play.deck = in.readInt();
+            plays.push_back(play);
+            break;
+        }
+        case RecordType::cues:
+        {
+            AudioData& audio{ audioData[(juce::uint64) in.readInt64()] };
+            for (double& cue : audio.cues)
+            {
+                cue = in.readDouble();
+            }
+            break;
+        }
+        case RecordType::loop:
+        {
+            AudioData& audio{ audioData[(juce::uint64) in.readInt64()] };
+            audio.loopStart = in.readDouble();
+            audio.loopEnd = in.readDouble();
+            break;
+        }
+        case RecordType::analysis:
+        {
+            AudioData& audio{ audioData[(juce::uint64) in.readInt64()] };
+            int numBytes{ in.readInt() };
+            audio.analysis.reset();
+            in.readIntoMemoryBlock(audio.analysis, numBytes);
+            break;
+        }
+        case RecordType::trackColumns:
+        {
+            TrackLibrary::Columns columns;
+            if (columns.readFrom(in))
+            {
+                tracks.assign(std::move(columns));
+            }
+            else
+            {
+                DBG("LibraryStore::apply the stored tracks are not valid");
+            }
+            break;
+        }
+        default:
+            DBG("LibraryStore::apply unknown record type " << (int) type);
+            break;
+    }
+}
+
+juce::int64 LibraryStore::replay(juce::InputStream& in)
+{
+    juce::int64 end{ in.getPosition() };
+    juce::MemoryBlock record;
+    while (in.getNumBytesRemaining() >= 8)
+    {
+        juce::uint32 size{ (juce::uint32) in.readInt() };
+        juce::uint32 crc{ (juce::uint32) in.readInt() };
+        if (size == 0 || size > (juce::uint64) in.getNumBytesRemaining())
+        {
+            break;
+        }
+        record.setSize(size);
+        if (in.read(record.getData(), (int) size) != (int) size || crc32(record.getData(), size) != crc)
+        {
+            break;
+        }
+        apply((RecordType) (juce::uint8) record[0], record.begin() + 1, size - 1);
+        end = in.getPosition();
+    }
+    return end;
+}
+
+void LibraryStore::writeState(juce::MemoryOutputStream& out) const
+{
+    juce::MemoryOutputStream payload;
+    auto addRecord = [&out, &payload](RecordType type)
+    {
+        writeRecord(out, type, payload.getData(), payload.getDataSize());
+        payload.reset();
+    };
+
+    // the tracks go in one record of flat columns so snapshots load as bulk copies
+    tracks.createSnapshot().writeTo(payload);
+    addRecord(RecordType::trackColumns);
+    for (const auto& [fingerprint, audio] : audioData)
+    {
+        writeCues(payload, fingerprint, audio.cues);
+        addRecord(RecordType::cues);
+        if (audio.loopStart >= 0)
+        {
+            writeLoop(payload, fingerprint, audio.loopStart, audio.loopEnd);
+            addRecord(RecordType::loop);
+        }
+        if (!audio.analysis.isEmpty())
+        {
+            writeAnalysis(payload, fingerprint, audio.analysis);
+            addRecord(RecordType::analysis);
+        }
+    }
+    for (const Play& play : plays)
+    {
+        writePlay(payload, play);
+        addRecord(RecordType::play);
+    }
+}
+
+void LibraryStore::writePending()
+{
+    juce::MemoryBlock records;
+    {
+        const juce::ScopedLock sl(stateLock);
+        records.swapWith(pending);
+    }
+    appendToLog(records);
+    if (logSize > compactLogSize)
+    {
+        compact();
+    }
+}
+
+void LibraryStore::appendToLog(const juce::MemoryBlock& records)
+{
+    if (records.isEmpty() || log == nullptr)
+    {
+        return;
+    }
+    if (!log->write(records.getData(), records.getSize()))
+    {
+        DBG("LibraryStore could not append to " << logFile.getFullPathName());
+    }
+    // flushing a file stream also syncs it to disk
+    log->flush();
+    logSize += (juce::int64) records.getSize();
+}
+
+void LibraryStore::compact()
+{
+    juce::MemoryOutputStream image;
+    juce::MemoryBlock records;
+    {
+        const juce::ScopedLock sl(stateLock);
+        writeState(image);
+        // the snapshot already holds these, logging them as well would apply them twice
+        records.swapWith(pending);
+    }
+
+    juce::TemporaryFile temp{ snapshotFile };
+    bool written{ false };
+    {
+        juce::FileOutputStream out{ temp.getFile() };
+        if (out.openedOk())
+        {
+            out.write(snapshotMagic, magicSize);
+            out.writeInt64((juce::int64) (generation + 1));
+            out.write(image.getData(), image.getDataSize());
+            out.flush();
+            written = out.getStatus().wasOk();
+        }
+    }
+    // the rename is atomic, a crash leaves either the old snapshot and log or the new snapshot
+    if (!written || !temp.overwriteTargetFileWithTemporary())
+    {
+        DBG("LibraryStore could not write " << snapshotFile.getFullPathName() << ", keeping the log");
+        appendToLog(records);
+        return;
+    }
+    ++generation;
+    createLog();
+}
+
+bool LibraryStore::createLog()
+{
+    log.reset();
+    logFile.deleteFile();
+    log = std::make_unique<juce::FileOutputStream>(logFile);
+    if (!log->openedOk())
+    {
+        DBG("LibraryStore could not create " << logFile.getFullPathName());
+        log.reset();
+        return false;
+    }
+    log->write(logMagic, magicSize);
+    log->writeInt64((juce::int64) generation);
+    log->flush();
+    logSize = log->getPosition();
+    return true;
+}
+
+void LibraryStore::writeRecord(juce::OutputStream& out, RecordType type, const void* data, size_t size)
+{
+    // length and checksum first so recovery can tell a torn record from a whole one
+    juce::uint8 typeByte{ (juce::uint8) type };
+    out.writeInt((int) (size + 1));
+    out.writeInt((int) crc32(data, size, crc32(&typeByte, 1)));
+    out.writeByte((char) typeByte);
+    out.write(data, size);
+}
+
+void LibraryStore::writeTrack(juce::OutputStream& out, TrackId id, const Track& track)
+{
+    out.writeInt((int) id);
+    out.writeString(track.file.getFullPathName());
+    out.writeDouble(track.duration);
+    out.writeFloat(track.bpm);
+    out.writeInt(track.key);
+    out.writeInt(track.bitrate);
+    out.writeInt(track.sampleRate);
+    out.writeInt64(track.dateAdded);
+    out.writeInt(track.playCount);
+    out.writeInt64(track.fileSize);
+    out.writeInt64(track.modificationTime);
+    out.writeInt64((juce::int64) track.fingerprint);
+}
+
+void LibraryStore::writePlay(juce::OutputStream& out, const Play& play)
+{
+    out.writeInt((int) play.id);
+    out.writeInt64(play.time);
+    out.writeInt(play.deck);
+}
+
+void LibraryStore::writeCues(juce::OutputStream& out, juce::uint64 fingerprint, const Cues& cues)
+{
+    out.writeInt64((juce::int64) fingerprint);
+    for (double cue : cues)
+    {
+        out.writeDouble(cue);
+    }
+}
+
+void LibraryStore::writeLoop(juce::OutputStream& out, juce::uint64 fingerprint, double start, double end)
+{
+    out.writeInt64((juce::int64) fingerprint);
+    out.writeDouble(start);
+    out.writeDouble(end);
+}
+
+void LibraryStore::writeAnalysis(juce::OutputStream& out, juce::uint64 fingerprint, const juce::MemoryBlock& data)
+{
+    out.writeInt64((juce::int64) fingerprint);
+    out.writeInt((int) data.getSize());
+    out.write(data.getData(), data.getSize());
+}
+
+juce::uint32 LibraryStore::crc32(const void* data, size_t size, juce::uint32 crc)
+{
+    static const auto table = []
+    {
+        std::array<juce::uint32, 256> t;
+        for (juce::uint32 i = 0; i < 256; ++i)
+        {
+            juce::uint32 c{ i };
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const juce::uint8* bytes{ static_cast<const juce::uint8*>(data) };
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    LibraryStore.h
+    Created: 14 Apr 2024 8:41:09pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Track.h"
+#include "TrackLibrary.h"
+#include "HotCuePreroll.h"
+
+//==============================================================================
+/*
+    Crash safe store for the library. Every change is appended as one small
+    checksummed record to a write-ahead log, so an update costs the size of
+    the change and not of the library. A background thread writes the
+    records gathered since its last pass and syncs them to disk together,
+    anything synced survives a crash. When the log grows too long the whole
+    state is written to a fresh snapshot and the log starts over.
+
+    Tracks are keyed by their TrackId, cues, loops and analysis results by
+    the fingerprint of their audio so they follow the track when it moves.
+*/
+class LibraryStore : private juce::Thread
+{
+public:
+    static constexpr int numCues{ HotCuePreroll::numHotCues };
+    using Cues = std::array<double, numCues>;
+
+    /**One time a track was loaded to a deck*/
+    struct Play
+    {
+        TrackId id;
+        /**milliseconds since epoch*/
+        juce::int64 time;
+        int deck;
+    };
+
+    /**Opens the store in the directory and recovers the last committed state*/
+    LibraryStore(const juce::File& _directory);
+    /**Syncs every pending change before closing*/
+    ~LibraryStore() override;
+
+    /**Checks if the store could be opened*/
+    bool isOpen() const;
+    /**Checks if there was no store in the directory yet*/
+    bool isNew() const;
+
+    /**Gets every stored track with the id it was stored under, as one bulk copy*/
+    TrackLibrary::Columns getTracks() const;
+    /**Adds or replaces the stored track with this id*/
+    void putTrack(TrackId id, const Track& track);
+    /**Removes the track and its play history*/
+    void removeTrack(TrackId id);
+
+    /**Adds a play of the track to the history*/
+    void recordPlay(TrackId id, int deck);
+    /**Gets every play of the track, oldest first*/
+    std::vector<Play> getPlays(TrackId id) const;
+
+    /**Stores the hot cues of some audio in seconds, -1 for a cue that is not set*/
+    void setCues(juce::uint64 fingerprint, const Cues& cues);
+    /**Gets the stored hot cues of some audio, -1 for a cue that is not set*/
+    Cues getCues(juce::uint64 fingerprint) const;
+    /**Stores the relative loop positions of some audio, negative to remove the loop*/
+    void setLoop(juce::uint64 fingerprint, double start, double end);
+    /**Gets the stored loop of some audio, returns false if it has none*/
+    bool getLoop(juce::uint64 fingerprint, double& start, double& end) const;
+    /**Stores the analysis results of some audio, their format is up to the analyser*/
+    void setAnalysis(juce::uint64 fingerprint, const juce::MemoryBlock& data);
+    /**Gets the stored analysis results of some audio, empty if there are none*/
+    juce::MemoryBlock getAnalysis(juce::uint64 fingerprint) const;
+
+    /**Writes and syncs every pending change before returning*/
+    void flush();
+
+private:
+    enum class RecordType : juce::uint8
+    {
+        putTrack = 1,
+        removeTrack,
+        play,
+        cues,
+        loop,
+        analysis,
+        /**every track at once, written to snapshots instead of one putTrack each*/
+        trackColumns
+    };
+
+    /**Everything stored about some audio rather than a library entry*/
+    struct AudioData
+    {
+        AudioData();
+        Cues cues;
+        double loopStart;
+        double loopEnd;
+        juce::MemoryBlock analysis;
+    };
+
+    void run() override;
+    /**Applies a change to the state and queues its record for the next sync*/
+    void commit(RecordType type, const juce::MemoryOutputStream& payload);
+    /**Decodes one record and applies it to the state, the caller holds stateLock*/
+    void apply(RecordType type, const void* data, size_t size);
+    /**Applies every valid record of a file after its header, returns the end of the last one*/
+    juce::int64 replay(juce::InputStream& in);
+    /**Writes the records of the whole state, the caller holds stateLock*/
+    void writeState(juce::MemoryOutputStream& out) const;
+    /**Writes the queued records to the log and syncs it, the caller holds fileLock*/
+    void writePending();
+    /**Appends records to the log and syncs it, the caller holds fileLock*/
+    void appendToLog(const juce::MemoryBlock& records);
+    /**Replaces the snapshot with the current state and empties the log, the caller holds fileLock*/
+    void compact();
+    /**Starts an empty log for the current generation, the caller holds fileLock*/
+    bool createLog();
+
+    static void writeRecord(juce::OutputStream& out, RecordType type, const void* data, size_t size);
+    static void writeTrack(juce::OutputStream& out, TrackId id, const Track& track);
+    static void writePlay(juce::OutputStream& out, const Play& play);
+    static void writeCues(juce::OutputStream& out, juce::uint64 fingerprint, const Cues& cues);
+    static void writeLoop(juce::OutputStream& out, juce::uint64 fingerprint, double start, double end);
+    static void writeAnalysis(juce::OutputStream& out, juce::uint64 fingerprint, const juce::MemoryBlock& data);
+    /**CRC-32 of the data, continuing from the CRC of the bytes before it*/
+    static juce::uint32 crc32(const void* data, size_t size, juce::uint32 crc = 0);
+
+    juce::File directory;
+    juce::File snapshotFile;
+    juce::File logFile;
+    bool opened;
+    bool created;
+
+    // serialises syncs and compaction between the message and store threads
+    juce::CriticalSection fileLock;
+    std::unique_ptr<juce::FileOutputStream> log;
+    /**bumped by every compaction, a log from an older generation is already in the snapshot*/
+    juce::uint64 generation;
+    juce::int64 logSize;
+
+    // the committed state and the records not yet synced
+    mutable juce::CriticalSection stateLock;
+    TrackLibrary tracks;
+    std::unordered_map<juce::uint64, AudioData> audioData;
+    std::vector<Play> plays;
+    juce::MemoryBlock pending;
+
+    static constexpr int syncIntervalMs{ 250 };
+    static constexpr juce::int64 compactLogSize{ 4 * 1024 * 1024 };
+    static constexpr const char* snapshotMagic{ "OTOSNAP1" };
+    static constexpr const char* logMagic{ "OTOWAL01" };
+    static constexpr int magicSize{ 8 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryStore)
+};
@@ -0,0 +1,276 @@
+/*
+  ==============================================================================
+
+    MidiController.cpp
+    Created: 14 Apr 2024 7:52:19pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "MidiController.h"
+
+//==============================================================================
+MidiController::MidiController(DJAudioPlayer* _deck1,
+                               DJAudioPlayer* _deck2,
+                               const juce::File& _mappingFile
+                              ) : decks{ _deck1, _deck2 },
+                                  mappingFile(_mappingFile),
+                                  learnTarget(0),
+                                  numMessages(0),
+                                  meanLatency(0),
+                                  sumSquares(0),
+                                  maxLatency(0)
+{
+    for (auto& mapping : mappings)
+    {
+        mapping = 0;
+    }
+    loadMappings();
+}
+
+MidiController::~MidiController()
+{
+    for (auto& input : inputs)
+    {
+        input->stop();
+    }
+    // a mapping learnt just before closing is still saved
+    handleUpdateNowIfNeeded();
+}
+
+juce::File MidiController::getDefaultMappingFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("OtoDecks").getChildFile("midi-mapping.txt");
+}
+
+void MidiController::start()
+{
+    for (const juce::MidiDeviceInfo& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (auto input = juce::MidiInput::openDevice(device.identifier, this))
+        {
+            DBG("MidiController::start opened " << device.name);
+            input->start();
+            inputs.push_back(std::move(input));
+        }
+    }
+
+    // not supported on Windows, where this just returns nullptr
+    if (auto virtualInput = juce::MidiInput::createNewDevice(virtualInputName, this))
+    {
+        virtualInput->start();
+        inputs.push_back(std::move(virtualInput));
+    }
+}
+
+void MidiController::learn(int deck, Control control)
+{
+    if (!juce::isPositiveAndBelow(deck, numDecks) || control == Control::none || control >= Control::numControls)
+    {
+        DBG("MidiController::learn no such deck or control");
+        return;
+    }
+    learnTarget = (juce::uint16) ((deck << 8) | (int) control);
+}
+
+void MidiController::clearMappings()
+{
+    for (auto& mapping : mappings)
+    {
+        mapping = 0;
+    }
+    saveMappings();
+}
+
+bool MidiController::isLearning() const
+{
+    return learnTarget.load() != 0;
+}
+
+MidiController::Stats MidiController::getStats() const
+{
+    const juce::SpinLock::ScopedLockType sl(statsLock);
+    Stats stats;
+    stats.numMessages = numMessages;
+    stats.meanLatency = meanLatency;
+    stats.maxLatency = maxLatency;
+    stats.jitter = numMessages > 1 ? std::sqrt(sumSquares / (numMessages - 1)) : 0.0;
+    return stats;
+}
+
+juce::String MidiController::getControlName(Control control)
+{
+    switch (control)
+    {
+        case Control::playPause: return "Play/Pause";
+        case Control::stop:      return "Stop";
+        case Control::volume:    return "Volume";
+        case Control::pitch:     return "Pitch";
+        case Control::jogTouch:  return "Jog Touch";
+        case Control::jog:       return "Jog Wheel";
+        case Control::hotCue1:   return "Hot Cue 1";
+        case Control::hotCue2:   return "Hot Cue 2";
+        case Control::hotCue3:   return "Hot Cue 3";
+        case Control::hotCue4:   return "Hot Cue 4";
+        case Control::pfl:       return "PFL";
+        case Control::filter:    return "Filter";
+        default:                 return {};
+    }
+}
+
+void MidiController::handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message)
+{
+    // timestamps are in seconds of the hi-res millisecond counter, taken when JUCE receives the message
+    if (message.getTimeStamp() > 0)
+    {
+        recordLatency(juce::Time::getMillisecondCounterHiRes() - message.getTimeStamp() * 1000.0);
+    }
+
+    const bool isNote{ message.isNoteOnOrOff() };
+    if (!isNote && !message.isController())
+    {
+        return;
+    }
+    const int index{ tableIndex(isNote, message.getChannel() - 1,
+                                isNote ? message.getNoteNumber() : message.getControllerNumber()) };
+
+    // the first note on or CC after a learn takes the mapping
+    juce::uint16 target{ learnTarget.load() };
+    if (target != 0 && (message.isNoteOn() || message.isController())
+        && learnTarget.compare_exchange_strong(target, 0))
+    {
+        mappings[(size_t) index] = target;
+        // never touch the disk on the MIDI thread
+        triggerAsyncUpdate();
+        return;
+    }
+
+    const juce::uint16 mapping{ mappings[(size_t) index].load() };
+    if (mapping != 0)
+    {
+        apply(*decks[(size_t) (mapping >> 8)], (Control) (mapping & 0xff), message);
+    }
+}
+
+void MidiController::apply(DJAudioPlayer& deck, Control control, const juce::MidiMessage& message)
+{
+    // buttons that send a CC are down at 64 and above, like a sustain pedal
+    const bool pressed{ message.isNoteOn() || (message.isController() && message.getControllerValue() >= 64) };
+    const int value{ message.isController() ? message.getControllerValue() : 0 };
+
+    switch (control)
+    {
+        case Control::playPause:
+            if (pressed)
+            {
+                deck.isPlaying() ? deck.stop() : deck.play();
+            }
+            break;
+        case Control::stop:
+            if (pressed)
+            {
+                deck.stop();
+            }
+            break;
+        case Control::volume:
+            deck.setGain(value / 127.0);
+            break;
+        case Control::pitch:
+            // centre detent at 64 is normal speed
+            deck.setSpeed(1.0 + pitchRange * juce::jlimit(-1.0, 1.0, (value - 64) / 63.0));
+            break;
+        case Control::jogTouch:
+            pressed ? (void) deck.beginScratch() : deck.endScratch();
+            break;
+        case Control::jog:
+        {
+            // relative encoder, 1 to 63 forwards and 65 to 127 backwards
+            const int ticks{ value < 64 ? value : value - 128 };
+            deck.scratch(ticks * jogSecondsPerTick);
+            break;
+        }
+        case Control::hotCue1:
+        case Control::hotCue2:
+        case Control::hotCue3:
+        case Control::hotCue4:
+            if (pressed)
+            {
+                const int cue{ (int) control - (int) Control::hotCue1 };
+                deck.hasHotCue(cue) ? deck.triggerHotCue(cue) : deck.setHotCue(cue);
+            }
+            break;
+        case Control::pfl:
+            if (pressed)
+            {
+                deck.setCueEnabled(!deck.isCueEnabled());
+            }
+            break;
+        case Control::filter:
+            // centre detent at 64 is off, low-pass below and high-pass above
+            deck.setFilter(juce::jlimit(-1.0, 1.0, (value - 64) / 63.0));
+            break;
+        default:
+            break;
+    }
+}
+
+void MidiController::handleAsyncUpdate()
+{
+    saveMappings();
+}
+
+void MidiController::recordLatency(double latencyMs)
+{
+    // Welford's running mean and variance, no history kept
+    const juce::SpinLock::ScopedLockType sl(statsLock);
+    ++numMessages;
+    const double delta{ latencyMs - meanLatency };
+    meanLatency += delta / numMessages;
+    sumSquares += delta * (latencyMs - meanLatency);
+    maxLatency = juce::jmax(maxLatency, latencyMs);
+}
+
+int MidiController::tableIndex(bool isNote, int channel, int number)
+{
+    return ((isNote ? 1 : 0) * 16 + (channel & 15)) * 128 + (number & 127);
+}
+
+void MidiController::loadMappings()
+{
+    // one mapping per line: index deck control
+    juce::StringArray lines;
+    mappingFile.readLines(lines);
+    for (const juce::String& line : lines)
+    {
+        juce::StringArray fields{ juce::StringArray::fromTokens(line, false) };
+        if (fields.size() != 3)
+        {
+            continue;
+        }
+        const int index{ fields[0].getIntValue() };
+        const int deck{ fields[1].getIntValue() };
+        const int control{ fields[2].getIntValue() };
+        if (juce::isPositiveAndBelow(index, tableSize) && juce::isPositiveAndBelow(deck, numDecks)
+            && control > 0 && control < (int) Control::numControls)
+        {
+            mappings[(size_t) index] = (juce::uint16) ((deck << 8) | control);
+        }
+    }
+}
+
+void MidiController::saveMappings() const
+{
+    juce::String text;
+    for (int i = 0; i < tableSize; ++i)
+    {
+        const juce::uint16 mapping{ mappings[(size_t) i].load() };
+        if (mapping != 0)
+        {
+            text << i << " " << (mapping >> 8) << " " << (mapping & 0xff) << "\n";
+        }
+    }
+    mappingFile.getParentDirectory().createDirectory();
+    mappingFile.replaceWithText(text);
+}
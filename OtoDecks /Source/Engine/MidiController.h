@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    MidiController.h
+    Created: 14 Apr 2024 7:52:19pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "DJAudioPlayer.h"
+
+//==============================================================================
+/*
+    Routes MIDI controllers to the decks. Messages are looked up in a
+    learnable table and applied straight from the MIDI thread through the
+    decks' command queues and atomic parameters, so they never wait for the
+    message thread. Every input device is opened, plus a virtual input that
+    other software can send to, and the delay from a message's timestamp to
+    its callback is measured.
+*/
+class MidiController : private juce::MidiInputCallback,
+                       private juce::AsyncUpdater
+{
+public:
+    static constexpr int numDecks{ 2 };
+    /**seconds of track one tick of a jog wheel moves the platter*/
+    static constexpr double jogSecondsPerTick{ 0.002 };
+    /**pitch fader range either side of normal speed*/
+    static constexpr double pitchRange{ 0.08 };
+
+    /**What a control on the controller does to its deck*/
+    enum class Control : juce::uint8
+    {
+        none = 0,
+        playPause,
+        stop,
+        volume,
+        pitch,
+        jogTouch,
+        jog,
+        hotCue1,
+        hotCue2,
+        hotCue3,
+        hotCue4,
+        pfl,
+        filter,
+        numControls
+    };
+
+    /**Dispatch latency in milliseconds, from the timestamp JUCE gives a message when
+       it arrives to the callback. Time spent in the driver and the cable is not in it*/
+    struct Stats
+    {
+        int numMessages;
+        double meanLatency;
+        double maxLatency;
+        /**standard deviation of the latency*/
+        double jitter;
+    };
+
+    /**Learnt mappings are loaded from and saved to the mapping file*/
+    MidiController(DJAudioPlayer* _deck1, DJAudioPlayer* _deck2, const juce::File& _mappingFile);
+    ~MidiController() override;
+
+    /**Gets the mapping file in the user's application data*/
+    static juce::File getDefaultMappingFile();
+    /**Name of the virtual input other software can send to*/
+    static constexpr const char* virtualInputName{ "OtoDecks Virtual In" };
+
+    /**Opens every MIDI input and the virtual port*/
+    void start();
+    /**Maps the next control moved on the controller to this deck control*/
+    void learn(int deck, Control control);
+    /**Removes every mapping*/
+    void clearMappings();
+    /**Checks if a learn is waiting for a control to be moved*/
+    bool isLearning() const;
+    Stats getStats() const;
+    /**Gets a readable name of a control*/
+    static juce::String getControlName(Control control);
+
+private:
+    void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override;
+    /**Writes a learnt mapping to disk, on the message thread*/
+    void handleAsyncUpdate() override;
+    /**Carries out a mapped message on a deck, on the MIDI thread*/
+    void apply(DJAudioPlayer& deck, Control control, const juce::MidiMessage& message);
+    void recordLatency(double latencyMs);
+
+    /**Index of a message in the table: notes and CCs, per channel and number*/
+    static int tableIndex(bool isNote, int channel, int number);
+    void loadMappings();
+    void saveMappings() const;
+
+    std::array<DJAudioPlayer*, numDecks> decks;
+    const juce::File mappingFile;
+    std::vector<std::unique_ptr<juce::MidiInput>> inputs;
+
+    // deck in the high byte and control in the low byte, 0 is unmapped
+    static constexpr int tableSize{ 2 * 16 * 128 };
+    std::array<std::atomic<juce::uint16>, tableSize> mappings;
+    std::atomic<juce::uint16> learnTarget;
+
+    juce::SpinLock statsLock;
+    int numMessages;
+    double meanLatency;
+    double sumSquares;
+    double maxLatency;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiController)
+};
@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    OtoEngine.cpp
+    Created: 2 May 2024 7:31:40pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "OtoEngine.h"
+#include "TrackFingerprint.h"
+
+//==============================================================================
+OtoEngine::OtoEngine(const juce::File& _dataDirectory,
+                     WaveformSink* waveforms
+                    ) : dataDirectory(_dataDirectory),
+                        libraryStore(_dataDirectory.getChildFile("Library")),
+                        prefetcher(formatManager, waveforms),
+                        analyser(formatManager, _dataDirectory.getChildFile("Waveforms"), waveforms),
+                        player1(formatManager),
+                        player2(formatManager),
+                        decks{ &player1, &player2 },
+                        samplePads(formatManager),
+                        autoDJ(mixer, &player1, &player2),
+                        eventLog(mixer)
+{
+    // nothing is decoded before the first load, so registering here is early enough
+    formatManager.registerBasicFormats();
+
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        mixer.addDeck(decks[deck]);
+        // loads swap in tracks that were already decoded
+        decks[deck]->setPrefetcher(&prefetcher);
+        decks[deck]->setEventLog(&eventLog, deck);
+        loadedTracks[deck].cues.fill(-1.0);
+    }
+    mixer.setSamplePads(&samplePads);
+    mixer.setEventLog(&eventLog);
+    startTimer(500);
+}
+
+OtoEngine::~OtoEngine()
+{
+    stopTimer();
+    fingerprinter.removeAllJobs(true, 10000);
+    recorder.stop();
+    eventLog.close();
+}
+
+juce::File OtoEngine::getDefaultDataDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile("OtoDecks");
+}
+
+void OtoEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    mixer.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    recorder.prepareToPlay(sampleRate);
+    eventLog.setDeviceFormat(sampleRate, samplesPerBlockExpected);
+}
+
+void OtoEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    mixer.getNextAudioBlock(bufferToFill);
+    // the master bus is channels 1/2, the cue bus is never recorded
+    recorder.pushBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void OtoEngine::releaseResources()
+{
+    mixer.releaseResources();
+}
+
+void OtoEngine::loadTrack(int deck, const juce::URL& audioURL, juce::uint64 fingerprint)
+{
+    if (!juce::isPositiveAndBelow(deck, numDecks))
+    {
+        DBG("OtoEngine::loadTrack there is no deck " << deck);
+        return;
+    }
+    // whatever the last track changed is stored before its cues are replaced
+    saveCuesIfChanged(deck);
+    decks[deck]->loadURL(audioURL, fingerprint);
+    LoadedTrack& loaded{ loadedTracks[deck] };
+    loaded.fingerprint = fingerprint;
+    ++loaded.generation;
+    restoreCues(deck);
+    if (fingerprint == 0 && audioURL.isLocalFile())
+    {
+        // hashing the whole file would stall the message thread, the cues follow once it is done
+        const int generation{ loaded.generation };
+        fingerprinter.addJob([this, audioURL, deck, generation]
+        {
+            const juce::uint64 found{ TrackFingerprint::compute(audioURL.getLocalFile()) };
+            const juce::ScopedLock sl(fingerprintLock);
+            fingerprinted.push_back({ audioURL, found, deck, generation });
+        });
+    }
+    listeners.call([deck, &audioURL, fingerprint](Listener& l) { l.trackLoaded(deck, audioURL, fingerprint); });
+}
+
+juce::uint64 OtoEngine::getLoadedFingerprint(int deck) const
+{
+    return juce::isPositiveAndBelow(deck, numDecks) ? loadedTracks[deck].fingerprint : 0;
+}
+
+bool OtoEngine::openSessionLog()
+{
+    return eventLog.open(dataDirectory.getChildFile("Sessions")
+                             .getChildFile(juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S") + ".otolog"));
+}
+
+void OtoEngine::addListener(Listener* listener)
+{
+    listeners.add(listener);
+}
+
+void OtoEngine::removeListener(Listener* listener)
+{
+    listeners.remove(listener);
+}
+
+DJAudioPlayer& OtoEngine::getDeck(int deck)
+{
+    jassert(juce::isPositiveAndBelow(deck, numDecks));
+    return *decks[deck];
+}
+
+DeckMixer& OtoEngine::getMixer()
+{
+    return mixer;
+}
+
+SamplePads& OtoEngine::getSamplePads()
+{
+    return samplePads;
+}
+
+AutoDJ& OtoEngine::getAutoDJ()
+{
+    return autoDJ;
+}
+
+LibraryStore& OtoEngine::getLibraryStore()
+{
+    return libraryStore;
+}
+
+TrackPrefetcher& OtoEngine::getPrefetcher()
+{
+    return prefetcher;
+}
+
+WaveformAnalyser& OtoEngine::getAnalyser()
+{
+    return analyser;
+}
+
+SessionRecorder& OtoEngine::getRecorder()
+{
+    return recorder;
+}
+
+juce::AudioFormatManager& OtoEngine::getFormatManager()
+{
+    return formatManager;
+}
+
+void OtoEngine::timerCallback()
+{
+    applyFingerprints();
+    for (int deck = 0; deck < numDecks; ++deck)
+    {
+        saveCuesIfChanged(deck);
+    }
+}
+
+void OtoEngine::restoreCues(int deck)
+{
+    // cues belong to the audio, so they come back wherever the file is now
+    DJAudioPlayer& player{ *decks[deck] };
+    LoadedTrack& loaded{ loadedTracks[deck] };
+    loaded.cues = libraryStore.getCues(loaded.fingerprint);
+    for (int i = 0; i < HotCuePreroll::numHotCues; ++i)
+    {
+        if (loaded.cues[i] >= 0)
+        {
+            player.setHotCue(i, loaded.cues[i]);
+        }
+    }
+    loaded.loopStart = -1;
+    loaded.loopEnd = -1;
+    if (libraryStore.getLoop(loaded.fingerprint, loaded.loopStart, loaded.loopEnd))
+    {
+        player.setLoopStart(loaded.loopStart);
+        player.setLoopEnd(loaded.loopEnd);
+    }
+}
+
+void OtoEngine::saveCuesIfChanged(int deck)
+{
+    DJAudioPlayer& player{ *decks[deck] };
+    LoadedTrack& loaded{ loadedTracks[deck] };
+    if (loaded.fingerprint == 0)
+    {
+        return;
+    }
+
+    LibraryStore::Cues cues;
+    for (int i = 0; i < HotCuePreroll::numHotCues; ++i)
+    {
+        cues[i] = player.getHotCue(i);
+    }
+    if (cues != loaded.cues)
+    {
+        loaded.cues = cues;
+        libraryStore.setCues(loaded.fingerprint, cues);
+    }
+
+    double loopStart{ player.isLooping() ? player.getLoopStart() : -1.0 };
+    double loopEnd{ player.isLooping() ? player.getLoopEnd() : -1.0 };
+    if (loopStart != loaded.loopStart || loopEnd != loaded.loopEnd)
+    {
+        loaded.loopStart = loopStart;
+        loaded.loopEnd = loopEnd;
+        libraryStore.setLoop(loaded.fingerprint, loopStart, loopEnd);
+    }
+}
+
+void OtoEngine::applyFingerprints()
+{
+    std::vector<Fingerprinted> found;
+    {
+        const juce::ScopedLock sl(fingerprintLock);
+        std::swap(found, fingerprinted);
+    }
+    for (const Fingerprinted& track : found)
+    {
+        LoadedTrack& loaded{ loadedTracks[track.deck] };
+        // skipped if another track went onto the deck while this one was hashed
+        if (track.generation != loaded.generation || track.fingerprint == 0)
+        {
+            continue;
+        }
+        loaded.fingerprint = track.fingerprint;
+        restoreCues(track.deck);
+        listeners.call([&track](Listener& l) { l.trackFingerprinted(track.deck, track.audioURL, track.fingerprint); });
+    }
+}
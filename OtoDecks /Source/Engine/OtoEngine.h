@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    OtoEngine.h
+    Created: 2 May 2024 7:31:40pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include <vector>
+#include "DJAudioPlayer.h"
+#include "DeckMixer.h"
+#include "DeckEventLog.h"
+#include "SamplePads.h"
+#include "SessionRecorder.h"
+#include "LibraryStore.h"
+#include "TrackPrefetcher.h"
+#include "WaveformAnalyser.h"
+#include "WaveformSink.h"
+#include "AutoDJ.h"
+
+//==============================================================================
+/*
+    Everything that makes sound or keeps the library, without a window: the
+    decks, the mixer, the sample pads, the auto DJ, the library store, prefetching, analysis,
+    the session log and the recorder. The GUI and the headless player both
+    drive it through this class and play it as an audio source; loads go
+    through loadTrack so every front end gets the stored cues and loops and
+    hears about the load. The hot cues and loop of each deck are saved
+    whenever they change, whoever changed them.
+*/
+class OtoEngine : public juce::AudioSource,
+                  private juce::Timer
+{
+public:
+    static constexpr int numDecks{ 2 };
+
+    /**Hears about tracks being loaded, on the message thread*/
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual void trackLoaded(int deck, const juce::URL& audioURL, juce::uint64 fingerprint) {}
+        /**The fingerprint of a track loaded without one, once it has been hashed*/
+        virtual void trackFingerprinted(int deck, const juce::URL& audioURL, juce::uint64 fingerprint) {}
+    };
+
+    /**Keeps the library, waveform bands and session logs in the data directory.
+       Waveforms go to the sink when one is given, it has to outlive the engine.*/
+    OtoEngine(const juce::File& _dataDirectory, WaveformSink* waveforms = nullptr);
+    ~OtoEngine() override;
+
+    /**Gets the folder the app keeps its data in for the current user*/
+    static juce::File getDefaultDataDirectory();
+
+    /**Implement AudioSource, the master goes to outputs 1/2 and the cue bus to 3/4*/
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Loads a track onto deck 0 or 1 with its stored cues and loop. A fingerprint of 0 is
+       computed in the background and the cues are restored when it arrives*/
+    void loadTrack(int deck, const juce::URL& audioURL, juce::uint64 fingerprint = 0);
+    /**Gets the fingerprint of the audio on a deck, 0 if nothing is loaded*/
+    juce::uint64 getLoadedFingerprint(int deck) const;
+    /**Starts a new session log named after the current time, so the set can be rendered again*/
+    bool openSessionLog();
+
+    void addListener(Listener* listener);
+    void removeListener(Listener* listener);
+
+    DJAudioPlayer& getDeck(int deck);
+    DeckMixer& getMixer();
+    SamplePads& getSamplePads();
+    AutoDJ& getAutoDJ();
+    LibraryStore& getLibraryStore();
+    TrackPrefetcher& getPrefetcher();
+    WaveformAnalyser& getAnalyser();
+    SessionRecorder& getRecorder();
+    juce::AudioFormatManager& getFormatManager();
+
+private:
+    /**The cues and loop of a deck as they were last stored*/
+    struct LoadedTrack
+    {
+        juce::uint64 fingerprint{ 0 };
+        LibraryStore::Cues cues;
+        double loopStart{ -1 };
+        double loopEnd{ -1 };
+        /**counts the loads, so a late fingerprint is not given to the next track*/
+        int generation{ 0 };
+    };
+
+    /**A fingerprint hashed in the background for a deck*/
+    struct Fingerprinted
+    {
+        juce::URL audioURL;
+        juce::uint64 fingerprint;
+        int deck;
+        int generation;
+    };
+
+    /**Saves the cues and loops of every deck that changed since they were stored*/
+    void timerCallback() override;
+    /**Sets the cues and loop saved with the audio just loaded onto a deck*/
+    void restoreCues(int deck);
+    void saveCuesIfChanged(int deck);
+    /**Gives the decks the fingerprints hashed since the last call*/
+    void applyFingerprints();
+
+    const juce::File dataDirectory;
+    juce::AudioFormatManager formatManager;
+    LibraryStore libraryStore;
+    TrackPrefetcher prefetcher;
+    WaveformAnalyser analyser;
+
+    DJAudioPlayer player1;
+    DJAudioPlayer player2;
+    std::array<DJAudioPlayer*, numDecks> decks;
+    DeckMixer mixer;
+    SamplePads samplePads;
+    AutoDJ autoDJ;
+    DeckEventLog eventLog;
+    SessionRecorder recorder;
+
+    std::array<LoadedTrack, numDecks> loadedTracks;
+    juce::ListenerList<Listener> listeners;
+
+    // tracks loaded without a fingerprint are hashed here, off the message thread
+    juce::CriticalSection fingerprintLock;
+    std::vector<Fingerprinted> fingerprinted;
+    juce::ThreadPool fingerprinter{ 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OtoEngine)
+};
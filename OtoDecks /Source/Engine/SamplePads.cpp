@@ -0,0 +1,330 @@
+/*
+  ==============================================================================
+
+    SamplePads.cpp
+    Created: 9 May 2024 7:48:12pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "SamplePads.h"
+
+//==============================================================================
+SamplePads::SamplePads(juce::AudioFormatManager& _formatManager
+                      ) : formatManager(_formatManager),
+                          arenaSampleRate(0),
+                          lastGeneration(0),
+                          numScheduled(0)
+{
+}
+
+SamplePads::~SamplePads()
+{
+}
+
+void SamplePads::prepareToPlay(double sampleRate)
+{
+    const juce::ScopedLock sl(loadLock);
+    if (sampleRate == arenaSampleRate)
+    {
+        return;
+    }
+    // the pads are stored at the device rate, so decode them again
+    arenaSampleRate = sampleRate;
+    std::array<juce::AudioBuffer<float>, numPads> pads;
+    std::array<juce::uint32, numPads> generations;
+    for (int i = 0; i < numPads; ++i)
+    {
+        if (files[i] != juce::File{})
+        {
+            pads[i] = decode(files[i], sampleRate);
+        }
+        generations[i] = ++lastGeneration;
+    }
+    swapArena(pack(pads, generations));
+}
+
+void SamplePads::renderBlock(juce::AudioBuffer<float>& output, int firstChannel, int startSample, int numSamples,
+                             juce::int64 blockStart)
+{
+    // take every trigger queued since the last block, they wait here until they are due
+    int start1, size1, start2, size2;
+    triggerFifo.prepareToRead(triggerFifo.getNumReady(), start1, size1, start2, size2);
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        if (numScheduled < maxPendingTriggers)
+        {
+            scheduled[(size_t) numScheduled++] = pendingTriggers[(size_t) (i < size1 ? start1 + i : start2 + i - size1)];
+        }
+    }
+    triggerFifo.finishedRead(size1 + size2);
+
+    const juce::int64 blockEnd{ blockStart + numSamples };
+    for (int i = 0; i < numScheduled;)
+    {
+        if (scheduled[(size_t) i].samplePosition < blockEnd)
+        {
+            startVoice(scheduled[(size_t) i], blockStart);
+            scheduled[(size_t) i] = scheduled[(size_t) --numScheduled];
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    // never wait here, if the arena is being swapped the pads skip a block but keep time with the master
+    juce::SpinLock::ScopedTryLockType lock(arenaLock);
+    if (!lock.isLocked() || arena == nullptr)
+    {
+        for (Voice& voice : voices)
+        {
+            voice.position += numSamples;
+        }
+        return;
+    }
+    for (Voice& voice : voices)
+    {
+        if (voice.pad < 0)
+        {
+            continue;
+        }
+        // positions are within the pad, so only a voice whose own pad was decoded again has to stop
+        const juce::uint32 generation{ arena->generations[(size_t) voice.pad] };
+        if (voice.generation == 0)
+        {
+            voice.generation = generation;
+        }
+        else if (voice.generation != generation)
+        {
+            voice.pad = -1;
+            continue;
+        }
+        const int length{ arena->lengths[(size_t) voice.pad] };
+        // a voice triggered inside this block starts on its exact sample
+        const int skip{ juce::jmax(0, -voice.position) };
+        const int from{ juce::jmax(0, voice.position) };
+        const int count{ juce::jmin(length - from, numSamples - skip) };
+        for (int ch = 0; ch < 2 && count > 0; ++ch)
+        {
+            output.addFrom(firstChannel + ch, startSample + skip, arena->pcm, ch,
+                           arena->starts[(size_t) voice.pad] + from, count, voice.gain);
+        }
+        voice.position += numSamples;
+        if (voice.position >= length)
+        {
+            voice.pad = -1;
+        }
+    }
+}
+
+bool SamplePads::loadPad(int pad, const juce::File& file)
+{
+    if (!juce::isPositiveAndBelow(pad, numPads))
+    {
+        DBG("SamplePads::loadPad there is no pad " << pad);
+        return false;
+    }
+
+    const juce::ScopedLock sl(loadLock);
+    if (arenaSampleRate <= 0)
+    {
+        // nothing to decode to yet, prepareToPlay decodes it at the device rate
+        std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+        if (reader == nullptr)
+        {
+            DBG("SamplePads::loadPad could not read " << file.getFullPathName());
+            return false;
+        }
+        files[pad] = file;
+        return true;
+    }
+
+    juce::AudioBuffer<float> audio{ decode(file, arenaSampleRate) };
+    if (audio.getNumSamples() == 0)
+    {
+        DBG("SamplePads::loadPad could not read " << file.getFullPathName());
+        return false;
+    }
+    std::array<juce::AudioBuffer<float>, numPads> pads;
+    std::array<juce::uint32, numPads> generations;
+    for (int i = 0; i < numPads; ++i)
+    {
+        pads[i] = i == pad ? std::move(audio) : copyPad(i);
+        generations[i] = i == pad ? ++lastGeneration : getGeneration(i);
+    }
+    files[pad] = file;
+    swapArena(pack(pads, generations));
+    return true;
+}
+
+void SamplePads::clearPad(int pad)
+{
+    if (!juce::isPositiveAndBelow(pad, numPads))
+    {
+        DBG("SamplePads::clearPad there is no pad " << pad);
+        return;
+    }
+
+    const juce::ScopedLock sl(loadLock);
+    files[pad] = juce::File{};
+    if (arena == nullptr)
+    {
+        return;
+    }
+    std::array<juce::AudioBuffer<float>, numPads> pads;
+    std::array<juce::uint32, numPads> generations;
+    for (int i = 0; i < numPads; ++i)
+    {
+        if (i != pad)
+        {
+            pads[i] = copyPad(i);
+        }
+        generations[i] = i == pad ? ++lastGeneration : getGeneration(i);
+    }
+    swapArena(pack(pads, generations));
+}
+
+juce::File SamplePads::getPadFile(int pad) const
+{
+    if (!juce::isPositiveAndBelow(pad, numPads))
+    {
+        return {};
+    }
+    const juce::ScopedLock sl(loadLock);
+    return files[pad];
+}
+
+bool SamplePads::trigger(int pad, juce::int64 samplePosition, float gain)
+{
+    if (!juce::isPositiveAndBelow(pad, numPads))
+    {
+        DBG("SamplePads::trigger there is no pad " << pad);
+        return false;
+    }
+
+    const juce::ScopedLock sl(triggerLock);
+    int start1, size1, start2, size2;
+    triggerFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 == 0)
+    {
+        DBG("SamplePads::trigger too many triggers are waiting");
+        return false;
+    }
+    pendingTriggers[(size_t) start1] = Trigger{ samplePosition, gain, pad };
+    triggerFifo.finishedWrite(1);
+    return true;
+}
+
+std::unique_ptr<SamplePads::Arena> SamplePads::pack(const std::array<juce::AudioBuffer<float>, numPads>& pads,
+                                                    const std::array<juce::uint32, numPads>& generations)
+{
+    int total{ 0 };
+    for (const auto& pad : pads)
+    {
+        total += pad.getNumSamples();
+    }
+
+    auto packed = std::make_unique<Arena>();
+    packed->pcm.setSize(2, total);
+    packed->generations = generations;
+    int start{ 0 };
+    for (int i = 0; i < numPads; ++i)
+    {
+        const int length{ pads[i].getNumSamples() };
+        for (int ch = 0; ch < 2 && length > 0; ++ch)
+        {
+            packed->pcm.copyFrom(ch, start, pads[i], ch, 0, length);
+        }
+        packed->starts[i] = start;
+        packed->lengths[i] = length;
+        start += length;
+    }
+    return packed;
+}
+
+juce::AudioBuffer<float> SamplePads::copyPad(int pad) const
+{
+    // only the loaders replace the arena, so it can be read here without the spin lock
+    if (arena == nullptr || arena->lengths[pad] == 0)
+    {
+        return {};
+    }
+    const int length{ arena->lengths[pad] };
+    juce::AudioBuffer<float> copy{ 2, length };
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        copy.copyFrom(ch, 0, arena->pcm, ch, arena->starts[pad], length);
+    }
+    return copy;
+}
+
+juce::uint32 SamplePads::getGeneration(int pad) const
+{
+    return arena != nullptr ? arena->generations[(size_t) pad] : 0;
+}
+
+juce::AudioBuffer<float> SamplePads::decode(const juce::File& file, double sampleRate) const
+{
+    std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(file) };
+    if (reader == nullptr || reader->lengthInSamples <= 0 || sampleRate <= 0)
+    {
+        return {};
+    }
+
+    const int numSourceSamples{ (int) juce::jmin(reader->lengthInSamples,
+                                                 (juce::int64) (maxPadSeconds * reader->sampleRate)) };
+    juce::AudioBuffer<float> source{ 2, numSourceSamples };
+    source.clear();
+    // a mono file is read into both channels
+    reader->read(&source, 0, numSourceSamples, 0, true, true);
+    if (reader->sampleRate == sampleRate)
+    {
+        return source;
+    }
+
+    // the resampler low-passes before dropping the rate, so pads above the device rate do not alias
+    const double ratio{ reader->sampleRate / sampleRate };
+    const int numOutputSamples{ (int) (numSourceSamples / ratio) };
+    juce::MemoryAudioSource memorySource{ source, false };
+    juce::ResamplingAudioSource resampler{ &memorySource, false, 2 };
+    resampler.setResamplingRatio(ratio);
+    resampler.prepareToPlay(numOutputSamples, sampleRate);
+    juce::AudioBuffer<float> audio{ 2, numOutputSamples };
+    resampler.getNextAudioBlock(juce::AudioSourceChannelInfo{ audio });
+    resampler.releaseResources();
+    return audio;
+}
+
+void SamplePads::swapArena(std::unique_ptr<Arena> newArena)
+{
+    {
+        const juce::SpinLock::ScopedLockType sl(arenaLock);
+        std::swap(arena, newArena);
+    }
+    // the old arena is freed here, outside the lock
+}
+
+void SamplePads::startVoice(const Trigger& trigger, juce::int64 blockStart)
+{
+    // a free voice, or else the one that has played longest
+    Voice* chosen{ &voices[0] };
+    for (Voice& voice : voices)
+    {
+        if (voice.pad < 0)
+        {
+            chosen = &voice;
+            break;
+        }
+        if (voice.position > chosen->position)
+        {
+            chosen = &voice;
+        }
+    }
+    chosen->pad = trigger.pad;
+    chosen->generation = 0;
+    // anything already due starts on the first sample of the block
+    chosen->position = -(int) juce::jmax((juce::int64) 0, trigger.samplePosition - blockStart);
+    chosen->gain = trigger.gain;
+}
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    SamplePads.h
+    Created: 9 May 2024 7:48:12pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <array>
+#include <memory>
+
+//==============================================================================
+/*
+    A bank of pads for short one-shots played over the decks. Every pad is
+    decoded once, at the device rate, into one shared block of memory, so a
+    trigger never opens a file or resamples. Triggers are stamped with the
+    engine sample they start on and reach the audio thread through a
+    lock-free FIFO; a fixed pool of voices plays them, each voice being no
+    more than a pad and a read position added straight onto the master.
+*/
+class SamplePads
+{
+public:
+    static constexpr int numPads{ 8 };
+    static constexpr int maxVoices{ 16 };
+    /**longer files are cut, the pads are for one-shots*/
+    static constexpr double maxPadSeconds{ 10.0 };
+
+    SamplePads(juce::AudioFormatManager& _formatManager);
+    ~SamplePads();
+
+    /**Decodes every pad again if the device rate changed, call before the device starts*/
+    void prepareToPlay(double sampleRate);
+    /**Adds the voices playing in a block to two channels of the output, audio thread only*/
+    void renderBlock(juce::AudioBuffer<float>& output, int firstChannel, int startSample, int numSamples,
+                     juce::int64 blockStart);
+
+    /**Decodes a one-shot onto a pad, returns false if it could not be read. Not for the audio thread*/
+    bool loadPad(int pad, const juce::File& file);
+    /**Empties a pad. Not for the audio thread*/
+    void clearPad(int pad);
+    /**Gets the file on a pad, or an empty file if nothing is loaded*/
+    juce::File getPadFile(int pad) const;
+    /**Plays a pad from an engine sample, anything already due starts with the next block.
+       Returns false if too many triggers are waiting. Not for the audio thread*/
+    bool trigger(int pad, juce::int64 samplePosition, float gain = 1.0f);
+
+private:
+    /**Every pad back to back in one stereo buffer at the device rate*/
+    struct Arena
+    {
+        juce::AudioBuffer<float> pcm;
+        std::array<int, numPads> starts{};
+        std::array<int, numPads> lengths{};
+        /**a new one every time a pad is decoded, voices started on an older one stop*/
+        std::array<juce::uint32, numPads> generations{};
+    };
+
+    struct Trigger
+    {
+        juce::int64 samplePosition;
+        float gain;
+        int pad;
+    };
+
+    /**A pad playing, a negative position is the samples left before it starts*/
+    struct Voice
+    {
+        int pad{ -1 };
+        int position{ 0 };
+        float gain{ 0 };
+        /**the generation of the pad it plays, 0 until its first block is rendered*/
+        juce::uint32 generation{ 0 };
+    };
+
+    /**Packs decoded pads back to back into a new arena*/
+    static std::unique_ptr<Arena> pack(const std::array<juce::AudioBuffer<float>, numPads>& pads,
+                                       const std::array<juce::uint32, numPads>& generations);
+    /**Copies a pad out of the current arena, under the load lock*/
+    juce::AudioBuffer<float> copyPad(int pad) const;
+    /**Gets the generation of a pad in the current arena, under the load lock*/
+    juce::uint32 getGeneration(int pad) const;
+    /**Reads a file into a stereo buffer at the given rate, empty if it could not be read*/
+    juce::AudioBuffer<float> decode(const juce::File& file, double sampleRate) const;
+    /**Hands a new arena to the audio thread and frees the old one outside the lock*/
+    void swapArena(std::unique_ptr<Arena> newArena);
+    /**Starts a trigger on a free voice, or on the one that has played longest*/
+    void startVoice(const Trigger& trigger, juce::int64 blockStart);
+
+    juce::AudioFormatManager& formatManager;
+
+    // files and the arena are built by the message thread and prepareToPlay, one at a time
+    juce::CriticalSection loadLock;
+    std::array<juce::File, numPads> files;
+    /**the rate the arena is decoded at, 0 before the device starts*/
+    double arenaSampleRate;
+    /**the generation given to the pad decoded last*/
+    juce::uint32 lastGeneration;
+
+    // the arena is swapped by the loaders and read by the audio thread
+    juce::SpinLock arenaLock;
+    std::unique_ptr<Arena> arena;
+
+    // triggers are handed to the audio thread through a lock-free FIFO, producers take a lock
+    static constexpr int maxPendingTriggers{ 64 };
+    juce::AbstractFifo triggerFifo{ maxPendingTriggers };
+    std::array<Trigger, maxPendingTriggers> pendingTriggers;
+    juce::CriticalSection triggerLock;
+
+    // audio thread only
+    std::array<Trigger, maxPendingTriggers> scheduled;
+    int numScheduled;
+    std::array<Voice, maxVoices> voices;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplePads)
+};
@@ -0,0 +1,349 @@
+/*
+  ==============================================================================
+
+    ScratchEngine.cpp
+    Created: 11 Apr 2024 9:26:48pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "ScratchEngine.h"
+
+namespace
+{
+    /**samples decoded per time slice, small enough not to hold up the read-ahead*/
+    constexpr int chunkSamples{ 1 << 15 };
+}
+
+//==============================================================================
+ScratchEngine::ScratchEngine(juce::AudioSource* _input,
+                             juce::TimeSliceThread& _thread
+                            ) : input(_input),
+                                thread(_thread),
+                                numDecoded(0),
+                                numReadySamples(0),
+                                trackSampleRate(0),
+                                touched(false),
+                                pendingMove(0),
+                                active(false),
+                                platterSeconds(0),
+                                trackChanged(false),
+                                state(State::idle),
+                                deviceSampleRate(0),
+                                position(0),
+                                velocity(0),
+                                target(0),
+                                handoffPosition(0),
+                                deckPosition(0),
+                                deckPlaying(false),
+                                deckSpeed(1.0),
+                                deckGain(1.0f),
+                                hasSeekRequest(false),
+                                seekRequest(0)
+{
+    thread.addTimeSliceClient(this);
+}
+
+ScratchEngine::~ScratchEngine()
+{
+    thread.removeTimeSliceClient(this);
+}
+
+void ScratchEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    deviceSampleRate = sampleRate;
+}
+
+void ScratchEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (trackChanged.exchange(false))
+    {
+        // a platter still spinning on the last track must not carry over to this one
+        state = State::idle;
+        velocity = 0;
+        hasSeekRequest = false;
+    }
+
+    // never wait here, if the track is being swapped the input plays instead
+    juce::SpinLock::ScopedTryLockType lock(trackLock);
+    const juce::AudioBuffer<float>* buffer{ lock.isLocked() ? track.get() : nullptr };
+    const double rate{ trackSampleRate.load() };
+
+    if (state == State::idle)
+    {
+        if (!touched || buffer == nullptr || numReadySamples.load() == 0 || deviceSampleRate <= 0)
+        {
+            pendingMove = 0;
+            input->getNextAudioBlock(bufferToFill);
+            return;
+        }
+        // the hand lands on the platter where the deck is
+        state = State::scratching;
+        position = deckPosition * rate;
+        target = position;
+        velocity = deckPlaying ? deckSpeed : 0;
+        active = true;
+    }
+    else if (buffer == nullptr)
+    {
+        state = State::idle;
+        active = false;
+        input->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    target += pendingMove.exchange(0) * rate;
+    int handover{ renderScratch(bufferToFill, *buffer) };
+    platterSeconds = position / rate;
+    if (handover < bufferToFill.numSamples)
+    {
+        input->getNextAudioBlock(juce::AudioSourceChannelInfo{ bufferToFill.buffer,
+                                                               bufferToFill.startSample + handover,
+                                                               bufferToFill.numSamples - handover });
+    }
+}
+
+int ScratchEngine::renderScratch(const juce::AudioSourceChannelInfo& bufferToFill, const juce::AudioBuffer<float>& buffer)
+{
+    const double rate{ trackSampleRate.load() };
+    const int length{ numReadySamples.load(std::memory_order_acquire) };
+    if (length <= 0)
+    {
+        // the track is being replaced, nothing to scratch so the input plays the block
+        state = State::idle;
+        active = false;
+        return 0;
+    }
+    // source samples the platter moves per output sample at a velocity of 1
+    const double step{ rate / deviceSampleRate };
+    const double followCoeff{ 1.0 - std::exp(-1.0 / (0.005 * deviceSampleRate)) };
+    const double motorCoeff{ 1.0 - std::exp(-5.0 / (motorSeconds * deviceSampleRate)) };
+    const bool isTouched{ touched.load() };
+
+    if (isTouched && state == State::handoff)
+    {
+        state = State::scratching;
+        target = position;
+    }
+
+    for (int i = 0; i < bufferToFill.numSamples; ++i)
+    {
+        double targetVelocity{ deckPlaying ? deckSpeed : 0.0 };
+        if (isTouched)
+        {
+            targetVelocity = juce::jlimit(-maxVelocity, maxVelocity, (target - position) / (followSeconds * rate));
+        }
+        velocity += (targetVelocity - velocity) * (isTouched ? followCoeff : motorCoeff);
+        position = juce::jlimit(0.0, (double) (length - 1), position + velocity * step);
+
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+        {
+            const int source{ ch % buffer.getNumChannels() };
+            bufferToFill.buffer->setSample(ch, bufferToFill.startSample + i,
+                                           hermite(buffer.getReadPointer(source), length, position) * deckGain);
+        }
+
+        if (isTouched)
+        {
+            continue;
+        }
+        if (state == State::scratching && deckPlaying && std::abs(velocity - deckSpeed) < 0.01)
+        {
+            // up to speed, position the input ahead so it has time to read ahead
+            velocity = deckSpeed;
+            handoffPosition = juce::jmin(position + handoffSeconds * deckSpeed * rate, (double) (length - 1));
+            hasSeekRequest = true;
+            seekRequest = handoffPosition / rate;
+            state = State::handoff;
+        }
+        else if (state == State::scratching && !deckPlaying && std::abs(velocity) < 0.001)
+        {
+            hasSeekRequest = true;
+            seekRequest = position / rate;
+            state = State::idle;
+            active = false;
+            return i + 1;
+        }
+        else if (state == State::handoff && !deckPlaying)
+        {
+            state = State::scratching;
+        }
+        else if (state == State::handoff && position >= handoffPosition)
+        {
+            state = State::idle;
+            active = false;
+            return i + 1;
+        }
+    }
+    return bufferToFill.numSamples;
+}
+
+float ScratchEngine::hermite(const float* data, int numSamples, double position)
+{
+    const int i{ (int) position };
+    const float t{ (float) (position - i) };
+    auto sample = [&](int index) { return juce::isPositiveAndBelow(index, numSamples) ? data[index] : 0.0f; };
+    const float y0{ sample(i - 1) };
+    const float y1{ sample(i) };
+    const float y2{ sample(i + 1) };
+    const float y3{ sample(i + 2) };
+
+    const float c1{ 0.5f * (y2 - y0) };
+    const float c2{ y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3 };
+    const float c3{ 0.5f * (y3 - y0) + 1.5f * (y1 - y2) };
+    return ((c3 * t + c2) * t + c1) * t + y1;
+}
+
+void ScratchEngine::releaseResources()
+{
+    input->releaseResources();
+}
+
+void ScratchEngine::setReader(juce::AudioFormatReader* newReader, bool decodeNow)
+{
+    release();
+    std::unique_ptr<juce::AudioFormatReader> oldReader;
+    std::shared_ptr<juce::AudioBuffer<float>> oldTrack;
+    {
+        const juce::ScopedLock sl(readerLock);
+        oldReader = std::move(reader);
+        reader.reset(newReader);
+        numDecoded = 0;
+        {
+            const juce::SpinLock::ScopedLockType tl(trackLock);
+            std::swap(oldTrack, track);
+            numReadySamples = 0;
+        }
+        trackSampleRate = newReader != nullptr ? newReader->sampleRate : 0.0;
+    }
+    trackChanged = true;
+    active = false;
+
+    if (decodeNow)
+    {
+        while (decodeChunk())
+        {
+        }
+    }
+    else
+    {
+        thread.moveToFrontOfQueue(this);
+    }
+    // the old track and reader are freed here, outside both locks
+}
+
+void ScratchEngine::setTrack(std::shared_ptr<juce::AudioBuffer<float>> decodedTrack, double sampleRate)
+{
+    release();
+    std::unique_ptr<juce::AudioFormatReader> oldReader;
+    std::shared_ptr<juce::AudioBuffer<float>> oldTrack{ std::move(decodedTrack) };
+    {
+        const juce::ScopedLock sl(readerLock);
+        // no reader, so decodeChunk never writes to the shared buffer
+        oldReader = std::move(reader);
+        numDecoded = 0;
+        {
+            const juce::SpinLock::ScopedLockType tl(trackLock);
+            std::swap(oldTrack, track);
+            numReadySamples.store(track != nullptr ? track->getNumSamples() : 0, std::memory_order_release);
+        }
+        trackSampleRate = sampleRate;
+    }
+    trackChanged = true;
+    active = false;
+    // the old track and reader are freed here, outside both locks
+}
+
+void ScratchEngine::setDeckState(double positionSeconds, bool playing, double speed, float gain)
+{
+    deckPosition = positionSeconds;
+    deckPlaying = playing;
+    deckSpeed = speed;
+    deckGain = gain;
+}
+
+bool ScratchEngine::touch()
+{
+    if (numReadySamples.load() == 0)
+    {
+        DBG("ScratchEngine::touch the track is not decoded yet");
+        return false;
+    }
+    touched = true;
+    return true;
+}
+
+void ScratchEngine::moveBy(double deltaSeconds)
+{
+    double expected{ pendingMove.load() };
+    while (!pendingMove.compare_exchange_weak(expected, expected + deltaSeconds))
+    {
+    }
+}
+
+void ScratchEngine::release()
+{
+    touched = false;
+}
+
+bool ScratchEngine::isActive() const
+{
+    return active.load();
+}
+
+double ScratchEngine::getPosition() const
+{
+    return platterSeconds.load();
+}
+
+bool ScratchEngine::takeSeekRequest(double& seconds)
+{
+    if (!hasSeekRequest)
+    {
+        return false;
+    }
+    hasSeekRequest = false;
+    seconds = seekRequest;
+    return true;
+}
+
+int ScratchEngine::useTimeSlice()
+{
+    return decodeChunk() ? 1 : 500;
+}
+
+bool ScratchEngine::decodeChunk()
+{
+    const juce::ScopedLock sl(readerLock);
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+    {
+        return false;
+    }
+    const int length{ (int) juce::jmin(reader->lengthInSamples, (juce::int64) std::numeric_limits<int>::max()) };
+    if (numDecoded >= length)
+    {
+        return false;
+    }
+
+    std::shared_ptr<juce::AudioBuffer<float>> buffer;
+    {
+        const juce::SpinLock::ScopedLockType tl(trackLock);
+        buffer = track;
+    }
+    if (buffer == nullptr)
+    {
+        // allocated here so the message thread never waits on it
+        buffer = std::make_shared<juce::AudioBuffer<float>>((int) juce::jmin(reader->numChannels, 2u), length);
+        const juce::SpinLock::ScopedLockType tl(trackLock);
+        track = buffer;
+    }
+
+    // the audio thread only reads below numReadySamples, so this part is ours
+    const int numSamples{ juce::jmin(chunkSamples, length - (int) numDecoded) };
+    reader->read(buffer.get(), (int) numDecoded, numSamples, numDecoded, true, true);
+    numDecoded += numSamples;
+    numReadySamples.store((int) numDecoded, std::memory_order_release);
+    return numDecoded < length;
+}
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    ScratchEngine.h
+    Created: 11 Apr 2024 9:26:48pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+/*
+    Vinyl style scratching for a deck. The whole track is decoded in the
+    background, and while the platter is touched the deck plays that buffer
+    at any signed velocity, following the position the user drags to with
+    4-point Hermite interpolation. On release the platter spins back up to
+    the deck speed and hands over to the normal input once the input has
+    been positioned and read ahead.
+*/
+class ScratchEngine : public juce::AudioSource,
+                      private juce::TimeSliceClient
+{
+public:
+    /**how far behind the drag target the platter lags, smooths out mouse steps*/
+    static constexpr double followSeconds{ 0.02 };
+    /**time the platter takes to spin back up or stop after release*/
+    static constexpr double motorSeconds{ 0.15 };
+    /**how far ahead the input is positioned on release, in seconds of track*/
+    static constexpr double handoffSeconds{ 0.25 };
+    static constexpr double maxVelocity{ 8.0 };
+
+    ScratchEngine(juce::AudioSource* _input, juce::TimeSliceThread& _thread);
+    ~ScratchEngine() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Takes ownership of a reader for the loaded track and decodes it,
+       on the time slice thread or right away for offline renders*/
+    void setReader(juce::AudioFormatReader* newReader, bool decodeNow);
+    /**Uses a track that was already decoded elsewhere, the buffer is only read*/
+    void setTrack(std::shared_ptr<juce::AudioBuffer<float>> decodedTrack, double sampleRate);
+    /**Tells the engine where the deck is before each block, audio thread only*/
+    void setDeckState(double positionSeconds, bool playing, double speed, float gain);
+
+    /**Puts a hand on the platter, returns false if the track is not decoded yet*/
+    bool touch();
+    /**Moves the platter by some seconds of track, negative is backwards*/
+    void moveBy(double deltaSeconds);
+    /**Lets go of the platter*/
+    void release();
+
+    /**Checks if the engine is playing instead of the input*/
+    bool isActive() const;
+    /**Gets the platter position in seconds while active*/
+    double getPosition() const;
+    /**Gets a position the input has to be moved to, audio thread only*/
+    bool takeSeekRequest(double& seconds);
+
+private:
+    enum class State
+    {
+        idle,
+        scratching,
+        handoff
+    };
+
+    int useTimeSlice() override;
+    /**Decodes the next chunk of the track, returns false when it is all done*/
+    bool decodeChunk();
+    /**Renders the decoded track from offset, returns the sample the input takes over at*/
+    int renderScratch(const juce::AudioSourceChannelInfo& bufferToFill, const juce::AudioBuffer<float>& track);
+    static float hermite(const float* data, int numSamples, double position);
+
+    juce::AudioSource* input;
+    juce::TimeSliceThread& thread;
+
+    // decoding state, shared between the message and time slice threads
+    juce::CriticalSection readerLock;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::int64 numDecoded;
+
+    // the decoded track, swapped under the lock and only try-locked on the audio thread
+    juce::SpinLock trackLock;
+    std::shared_ptr<juce::AudioBuffer<float>> track;
+    std::atomic<int> numReadySamples;
+    std::atomic<double> trackSampleRate;
+
+    std::atomic<bool> touched;
+    std::atomic<double> pendingMove;
+    std::atomic<bool> active;
+    std::atomic<double> platterSeconds;
+    /**set when a new track comes in, the audio thread lets go of the old one's platter*/
+    std::atomic<bool> trackChanged;
+
+    // audio thread only
+    State state;
+    double deviceSampleRate;
+    double position;
+    double velocity;
+    double target;
+    double handoffPosition;
+    double deckPosition;
+    bool deckPlaying;
+    double deckSpeed;
+    float deckGain;
+    bool hasSeekRequest;
+    double seekRequest;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScratchEngine)
+};
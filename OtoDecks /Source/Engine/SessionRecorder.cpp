@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    SessionRecorder.cpp
+    Created: 4 Apr 2024 8:12:37pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "SessionRecorder.h"
+
+//==============================================================================
+SessionRecorder::SessionRecorder() : juce::Thread("Session Recorder"),
+                                     recording(false),
+                                     sampleRate(0),
+                                     overruns(0),
+                                     samplesWritten(0)
+{
+    // allocated once so a long session never touches the heap again
+    fifoBuffer.setSize(numChannels, fifoSize);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    stop();
+}
+
+void SessionRecorder::prepareToPlay(double _sampleRate)
+{
+    if (recording && _sampleRate != sampleRate)
+    {
+        DBG("SessionRecorder::prepareToPlay sample rate changed while recording, stop and start again");
+    }
+    sampleRate = _sampleRate;
+}
+
+void SessionRecorder::pushBlock(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+    if (!recording.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    if (fifo.getFreeSpace() < numSamples)
+    {
+        ++overruns;
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        // mono devices feed the same channel to both sides
+        int source{ juce::jmin(ch, buffer.getNumChannels() - 1) };
+        if (size1 > 0)
+            fifoBuffer.copyFrom(ch, start1, buffer, source, startSample, size1);
+        if (size2 > 0)
+            fifoBuffer.copyFrom(ch, start2, buffer, source, startSample + size1, size2);
+    }
+    fifo.finishedWrite(size1 + size2);
+}
+
+bool SessionRecorder::start(const juce::File& file)
+{
+    stop();
+    if (sampleRate <= 0)
+    {
+        DBG("SessionRecorder::start the audio device is not running");
+        return false;
+    }
+
+    std::unique_ptr<juce::AudioFormat> format;
+    if (file.hasFileExtension(".flac"))
+    {
+        format = std::make_unique<juce::FlacAudioFormat>();
+    }
+    else
+    {
+        format = std::make_unique<juce::WavAudioFormat>();
+    }
+
+    file.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream{ file.createOutputStream() };
+    if (stream == nullptr)
+    {
+        DBG("SessionRecorder::start cannot write to " << file.getFullPathName());
+        return false;
+    }
+
+    // 24 bit for both, WAV switches to RF64 by itself once it passes 4GB
+    writer.reset(format->createWriterFor(stream.get(), sampleRate, numChannels, 24, {}, 0));
+    if (writer == nullptr)
+    {
+        DBG("SessionRecorder::start cannot create a writer for " << file.getFullPathName());
+        return false;
+    }
+    stream.release();
+
+    fifo.reset();
+    overruns = 0;
+    samplesWritten = 0;
+    recording.store(true, std::memory_order_release);
+    startThread();
+    return true;
+}
+
+void SessionRecorder::stop()
+{
+    if (!recording)
+    {
+        return;
+    }
+    recording.store(false, std::memory_order_release);
+    stopThread(2000);
+    drainFifo();
+    writer.reset();
+}
+
+bool SessionRecorder::isRecording() const
+{
+    return recording.load();
+}
+
+int SessionRecorder::getNumOverruns() const
+{
+    return overruns.load();
+}
+
+double SessionRecorder::getRecordedSeconds() const
+{
+    return sampleRate > 0 ? (double) samplesWritten.load() / sampleRate : 0.0;
+}
+
+void SessionRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        drainFifo();
+        // the audio thread never signals us, that would take a lock
+        wait(20);
+    }
+}
+
+void SessionRecorder::drainFifo()
+{
+    int numReady{ fifo.getNumReady() };
+    if (numReady == 0 || writer == nullptr)
+    {
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+    if (size1 > 0)
+        writer->writeFromAudioSampleBuffer(fifoBuffer, start1, size1);
+    if (size2 > 0)
+        writer->writeFromAudioSampleBuffer(fifoBuffer, start2, size2);
+    fifo.finishedRead(size1 + size2);
+    samplesWritten += size1 + size2;
+}
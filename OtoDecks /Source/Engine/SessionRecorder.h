@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    SessionRecorder.h
+    Created: 4 Apr 2024 8:12:37pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <memory>
+
+//==============================================================================
+/*
+    Records the master output to a WAV or FLAC file. The audio thread only
+    copies each block into a fixed size lock-free FIFO, a background thread
+    drains it and does all of the encoding and disk I/O. If the disk falls
+    behind for longer than the FIFO holds, whole blocks are dropped and
+    counted as overruns instead of blocking the callback.
+*/
+class SessionRecorder : private juce::Thread
+{
+public:
+    /**Capacity of the FIFO, about 20 seconds at 48kHz*/
+    static constexpr int fifoSize{ 1 << 20 };
+    static constexpr int numChannels{ 2 };
+
+    SessionRecorder();
+    ~SessionRecorder() override;
+
+    /**Tells the recorder the device rate, call from prepareToPlay*/
+    void prepareToPlay(double sampleRate);
+    /**Copies the first two channels of the block into the FIFO, safe on the audio thread*/
+    void pushBlock(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    /**Starts writing to file, the format is picked from its extension*/
+    bool start(const juce::File& file);
+    /**Writes out whatever is left in the FIFO and closes the file*/
+    void stop();
+
+    bool isRecording() const;
+    /**Gets the number of blocks dropped because the FIFO was full*/
+    int getNumOverruns() const;
+    /**Gets the length of the recording so far in seconds*/
+    double getRecordedSeconds() const;
+
+private:
+    void run() override;
+    /**Moves everything in the FIFO into the writer*/
+    void drainFifo();
+
+    juce::AbstractFifo fifo{ fifoSize };
+    juce::AudioBuffer<float> fifoBuffer;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    std::atomic<bool> recording;
+    std::atomic<double> sampleRate;
+    std::atomic<int> overruns;
+    std::atomic<juce::int64> samplesWritten;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SessionRecorder)
+};
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    StringArena.cpp
+    Created: 25 Apr 2024 10:14:37pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "StringArena.h"
+
+//==============================================================================
+StringArena::Handle StringArena::add(const juce::String& text)
+{
+    const char* data{ text.toRawUTF8() };
+    const size_t numBytes{ text.getNumBytesAsUTF8() };
+    Handle handle{ (juce::uint32) bytes.size(), (juce::uint32) numBytes };
+    bytes.insert(bytes.end(), data, data + numBytes);
+    return handle;
+}
+
+StringArena::Handle StringArena::intern(const juce::String& text)
+{
+    const char* data{ text.toRawUTF8() };
+    const size_t numBytes{ text.getNumBytesAsUTF8() };
+    const juce::uint64 key{ hash(data, numBytes) };
+    auto it = interned.find(key);
+    if (it != interned.end())
+    {
+        if (equals(it->second, data, numBytes))
+        {
+            return it->second;
+        }
+        // a hash collision, the string is stored again but not interned
+        return add(text);
+    }
+    Handle handle{ add(text) };
+    interned.emplace(key, handle);
+    return handle;
+}
+
+StringArena::Handle StringArena::addPrefix(Handle whole, const juce::String& text)
+{
+    const size_t numBytes{ text.getNumBytesAsUTF8() };
+    if (numBytes <= whole.numBytes && equals(Handle{ whole.offset, (juce::uint32) numBytes }, text.toRawUTF8(), numBytes))
+    {
+        return Handle{ whole.offset, (juce::uint32) numBytes };
+    }
+    return add(text);
+}
+
+void StringArena::addToIndex(Handle handle)
+{
+    if (isValid(handle))
+    {
+        interned.emplace(hash(bytes.data() + handle.offset, handle.numBytes), handle);
+    }
+}
+
+juce::String StringArena::get(Handle handle) const
+{
+    if (handle.numBytes == 0 || !isValid(handle))
+    {
+        return {};
+    }
+    const char* start{ bytes.data() + handle.offset };
+    return juce::String{ juce::CharPointer_UTF8{ start }, juce::CharPointer_UTF8{ start + handle.numBytes } };
+}
+
+size_t StringArena::getNumBytes() const
+{
+    return bytes.size();
+}
+
+void StringArena::reserve(size_t numBytes)
+{
+    bytes.reserve(numBytes);
+}
+
+void StringArena::clear()
+{
+    bytes.clear();
+    interned.clear();
+}
+
+void StringArena::writeTo(juce::OutputStream& out) const
+{
+    out.writeInt64((juce::int64) bytes.size());
+    out.write(bytes.data(), bytes.size());
+}
+
+bool StringArena::readFrom(juce::InputStream& in)
+{
+    clear();
+    juce::int64 numBytes{ in.readInt64() };
+    if (numBytes < 0 || numBytes > in.getNumBytesRemaining() || numBytes > (juce::int64) std::numeric_limits<juce::uint32>::max())
+    {
+        return false;
+    }
+    bytes.resize((size_t) numBytes);
+    return in.read(bytes.data(), (int) numBytes) == (int) numBytes;
+}
+
+bool StringArena::isValid(Handle handle) const
+{
+    return (size_t) handle.offset + handle.numBytes <= bytes.size();
+}
+
+juce::uint64 StringArena::hash(const char* data, size_t numBytes)
+{
+    // FNV-1a, the strings are short so a simple hash is enough
+    juce::uint64 h{ 14695981039346656037ull };
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        h = (h ^ (juce::uint8) data[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+bool StringArena::equals(Handle handle, const char* data, size_t numBytes) const
+{
+    return handle.numBytes == numBytes
+        && isValid(handle)
+        && std::memcmp(bytes.data() + handle.offset, data, numBytes) == 0;
+}
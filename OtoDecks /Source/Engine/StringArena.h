@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    StringArena.h
+    Created: 25 Apr 2024 10:14:37pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <unordered_map>
+#include <vector>
+
+//==============================================================================
+/*
+    Keeps many short strings back to back in one block of UTF-8 bytes. A
+    string is referred to by a handle of its offset and length, so a column
+    of them is a flat array that is copied and saved in bulk. Strings that
+    repeat, like the folders of a library, are interned and stored once.
+    Nothing is freed, the owner builds a fresh arena when too much of it
+    belongs to strings that are no longer used.
+*/
+class StringArena
+{
+public:
+    struct Handle
+    {
+        juce::uint32 offset{ 0 };
+        juce::uint32 numBytes{ 0 };
+    };
+
+    /**Appends the string, use for strings that rarely repeat*/
+    Handle add(const juce::String& text);
+    /**Returns the handle of an equal interned string, or adds and interns this one*/
+    Handle intern(const juce::String& text);
+    /**Points into the start of whole if text is exactly those bytes, otherwise adds text*/
+    Handle addPrefix(Handle whole, const juce::String& text);
+    /**Makes a string added in bulk, e.g. by readFrom, findable by intern*/
+    void addToIndex(Handle handle);
+
+    juce::String get(Handle handle) const;
+    /**Gets the bytes in use, strings that are no longer referred to included*/
+    size_t getNumBytes() const;
+    void reserve(size_t numBytes);
+    void clear();
+
+    void writeTo(juce::OutputStream& out) const;
+    /**Reads bytes written by writeTo, returns false if the data is not valid*/
+    bool readFrom(juce::InputStream& in);
+    /**Checks if the handle lies inside the arena, for handles read from disk*/
+    bool isValid(Handle handle) const;
+
+private:
+    static juce::uint64 hash(const char* data, size_t numBytes);
+    bool equals(Handle handle, const char* data, size_t numBytes) const;
+
+    std::vector<char> bytes;
+    /**interned strings by the hash of their bytes*/
+    std::unordered_map<juce::uint64, Handle> interned;
+
+    JUCE_LEAK_DETECTOR (StringArena)
+};
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    Track.cpp
+    Created: 19 Feb 2024 11:20:25pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "Track.h"
+
+//==============================================================================
+Track::Track(juce::File _file) : file(_file),
+title(_file.getFileNameWithoutExtension()),
+duration(0),
+bpm(0),
+key(-1),
+bitrate(0),
+sampleRate(0),
+dateAdded(0),
+playCount(0),
+fileSize(0),
+modificationTime(0),
+fingerprint(0)
+{
+    DBG("Created track with title: " << title);
+}
+
+void Track::readMetadata(const juce::AudioFormatReader& reader)
+{
+    sampleRate = juce::roundToInt(reader.sampleRate);
+    duration = reader.sampleRate > 0 ? reader.lengthInSamples / reader.sampleRate : 0;
+    fileSize = file.getSize();
+    modificationTime = file.getLastModificationTime().toMilliseconds();
+    if (duration > 0)
+    {
+        bitrate = juce::roundToInt(fileSize * 8 / duration / 1000.0);
+    }
+
+    // tempo and key only if the file carries them, names vary by format
+    const juce::StringPairArray& metadata{ reader.metadataValues };
+    for (const char* name : { "bpm", "tempo", "TBPM", juce::WavAudioFormat::acidTempo })
+    {
+        if (metadata.getValue(name, {}).isNotEmpty())
+        {
+            bpm = metadata.getValue(name, {}).getFloatValue();
+            break;
+        }
+    }
+    for (const char* name : { "key", "initialkey", "TKEY" })
+    {
+        if (metadata.getValue(name, {}).isNotEmpty())
+        {
+            key = parseKey(metadata.getValue(name, {}));
+            break;
+        }
+    }
+}
+
+bool Track::operator==(const Track& other) const
+{
+    return fingerprint != 0 ? fingerprint == other.fingerprint : file == other.file;
+}
+
+int Track::parseKey(const juce::String& text)
+{
+    juce::String k{ text.trim() };
+    if (k.isEmpty())
+    {
+        return -1;
+    }
+
+    // Camelot notation, e.g. "8A" or "12b"
+    juce::juce_wchar last{ juce::CharacterFunctions::toUpperCase(k.getLastCharacter()) };
+    if ((last == 'A' || last == 'B') && k.dropLastCharacters(1).containsOnly("0123456789"))
+    {
+        int number{ k.dropLastCharacters(1).getIntValue() };
+        if (number >= 1 && number <= 12)
+        {
+            return (number - 1) * 2 + (last == 'B' ? 1 : 0);
+        }
+        return -1;
+    }
+
+    // musical notation, e.g. "F#m", "Bb" or "C minor"
+    static const int pitchClasses[]{ 9, 11, 0, 2, 4, 5, 7 }; // A B C D E F G
+    juce::juce_wchar note{ juce::CharacterFunctions::toUpperCase(k[0]) };
+    if (note < 'A' || note > 'G')
+    {
+        return -1;
+    }
+    int pc{ pitchClasses[note - 'A'] };
+    juce::String rest{ k.substring(1).trim() };
+    if (rest.startsWithChar('#'))
+    {
+        pc += 1;
+        rest = rest.substring(1);
+    }
+    else if (rest.startsWithChar('b'))
+    {
+        pc += 11;
+        rest = rest.substring(1);
+    }
+    pc %= 12;
+    bool minor{ rest.startsWithIgnoreCase("min")
+                || (rest.startsWithChar('m') && !rest.startsWithIgnoreCase("maj")) };
+
+    // walk the circle of fifths onto the Camelot wheel
+    int number{ (pc * 7 + (minor ? 4 : 7)) % 12 + 1 };
+    return (number - 1) * 2 + (minor ? 0 : 1);
+}
+
+juce::String Track::keyToString(int key)
+{
+    if (key < 0 || key > 23)
+    {
+        return {};
+    }
+    return juce::String(key / 2 + 1) + (key % 2 == 0 ? "A" : "B");
+}
+
+bool Track::keysAreCompatible(int keyA, int keyB)
+{
+    if (keyA < 0 || keyB < 0)
+    {
+        return true;
+    }
+    // one step around the wheel, or the relative major or minor
+    int steps{ std::abs(keyA / 2 - keyB / 2) };
+    steps = juce::jmin(steps, 12 - steps);
+    return keyA % 2 == keyB % 2 ? steps <= 1 : steps == 0;
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    Track.h
+    Created: 19 Feb 2024 11:20:12pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <juce_audio_formats/juce_audio_formats.h>
+
+class Track
+{
+    public:
+        Track(juce::File _file);
+        juce::File file;
+        juce::String title;
+        /**length in seconds*/
+        double duration;
+        /**tempo in beats per minute, 0 if unknown*/
+        float bpm;
+        /**Camelot key index 0-23, -1 if unknown*/
+        int key;
+        /**average bitrate in kbps*/
+        int bitrate;
+        /**sample rate of the file in Hz*/
+        int sampleRate;
+        /**milliseconds since epoch when the track was added*/
+        juce::int64 dateAdded;
+        int playCount;
+        /**size of the file in bytes when it was last probed*/
+        juce::int64 fileSize;
+        /**modification time of the file in ms when it was last probed*/
+        juce::int64 modificationTime;
+        /**content hash of the audio payload, the identity of the track, 0 if unknown*/
+        juce::uint64 fingerprint;
+        
+        /**Fills in length, format and tag metadata from a reader for this file*/
+        void readMetadata(const juce::AudioFormatReader& reader);
+
+        /**objects are compared by the fingerprint of their audio*/
+        bool operator==(const Track& other) const;
+
+        /**Parses a key like "8A", "Am" or "F#" into a Camelot index, -1 if not a key*/
+        static int parseKey(const juce::String& text);
+        /**Formats a Camelot index as e.g. "8A", empty if unknown*/
+        static juce::String keyToString(int key);
+        /**Checks if two Camelot keys mix harmonically, an unknown key mixes with anything*/
+        static bool keysAreCompatible(int keyA, int keyB);
+};
@@ -0,0 +1,248 @@
+/*
+  ==============================================================================
+
+    TrackFingerprint.cpp
+    Created: 21 Mar 2024 7:38:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TrackFingerprint.h"
+
+namespace
+{
+    constexpr juce::uint64 prime1{ 11400714785074694791ull };
+    constexpr juce::uint64 prime2{ 14029467366897019727ull };
+    constexpr juce::uint64 prime3{ 1609587929392839161ull };
+    constexpr juce::uint64 prime4{ 9650029242287828579ull };
+    constexpr juce::uint64 prime5{ 2870177450012600261ull };
+
+    inline juce::uint64 rotl(juce::uint64 x, int bits)
+    {
+        return (x << bits) | (x >> (64 - bits));
+    }
+
+    inline juce::uint64 read64(const juce::uint8* p)
+    {
+        juce::uint64 v;
+        std::memcpy(&v, p, sizeof(v));
+        return juce::ByteOrder::swapIfBigEndian(v);
+    }
+
+    inline juce::uint32 read32(const juce::uint8* p)
+    {
+        juce::uint32 v;
+        std::memcpy(&v, p, sizeof(v));
+        return juce::ByteOrder::swapIfBigEndian(v);
+    }
+
+    inline juce::uint64 round(juce::uint64 acc, juce::uint64 input)
+    {
+        acc += input * prime2;
+        return rotl(acc, 31) * prime1;
+    }
+
+    inline juce::uint64 mergeRound(juce::uint64 acc, juce::uint64 value)
+    {
+        acc ^= round(0, value);
+        return acc * prime1 + prime4;
+    }
+
+    bool matches(const juce::uint8* data, size_t start, size_t end, const char* tag, size_t length)
+    {
+        return end >= start + length && std::memcmp(data + start, tag, length) == 0;
+    }
+}
+
+//==============================================================================
+juce::uint64 TrackFingerprint::hash(const void* data, size_t numBytes, juce::uint64 seed)
+{
+    // four independent lanes over 32 byte stripes, xxHash64 style
+    const juce::uint8* p{ static_cast<const juce::uint8*>(data) };
+    const juce::uint8* const end{ p + numBytes };
+    juce::uint64 h;
+
+    if (numBytes >= 32)
+    {
+        const juce::uint8* const limit{ end - 32 };
+        juce::uint64 v1{ seed + prime1 + prime2 };
+        juce::uint64 v2{ seed + prime2 };
+        juce::uint64 v3{ seed };
+        juce::uint64 v4{ seed - prime1 };
+        do
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        }
+        while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    }
+    else
+    {
+        h = seed + prime5;
+    }
+
+    h += (juce::uint64) numBytes;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= (juce::uint64) read32(p) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h ^= (*p) * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+void TrackFingerprint::findPayload(const juce::uint8* data, size_t& start, size_t& end)
+{
+    // RIFF/WAVE: only the data chunk
+    if (matches(data, start, end, "RIFF", 4) && matches(data, start + 8, end, "WAVE", 4))
+    {
+        size_t pos{ start + 12 };
+        while (pos + 8 <= end)
+        {
+            juce::uint32 size{ juce::ByteOrder::littleEndianInt(data + pos + 4) };
+            if (matches(data, pos, end, "data", 4))
+            {
+                start = pos + 8;
+                end = juce::jmin(end, start + (size_t) size);
+                return;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        return;
+    }
+
+    // AIFF: only the sound data chunk
+    if (matches(data, start, end, "FORM", 4))
+    {
+        size_t pos{ start + 12 };
+        while (pos + 8 <= end)
+        {
+            juce::uint32 size{ juce::ByteOrder::bigEndianInt(data + pos + 4) };
+            if (matches(data, pos, end, "SSND", 4))
+            {
+                start = pos + 8;
+                end = juce::jmin(end, start + (size_t) size);
+                return;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        return;
+    }
+
+    // FLAC: skip the metadata blocks, the frames follow the last one
+    if (matches(data, start, end, "fLaC", 4))
+    {
+        size_t pos{ start + 4 };
+        while (pos + 4 <= end)
+        {
+            bool isLast{ (data[pos] & 0x80) != 0 };
+            size_t size{ ((size_t) data[pos + 1] << 16) | ((size_t) data[pos + 2] << 8) | data[pos + 3] };
+            pos += 4 + size;
+            if (isLast)
+            {
+                break;
+            }
+        }
+        start = juce::jmin(pos, end);
+        return;
+    }
+
+    // MP3 and friends: ID3v2 in front, ID3v1 and APEv2 at the back
+    if (matches(data, start, end, "ID3", 3) && end - start >= 10)
+    {
+        size_t size{ ((size_t) (data[start + 6] & 0x7f) << 21) | ((size_t) (data[start + 7] & 0x7f) << 14)
+                   | ((size_t) (data[start + 8] & 0x7f) << 7) | (size_t) (data[start + 9] & 0x7f) };
+        bool hasFooter{ (data[start + 5] & 0x10) != 0 };
+        start = juce::jmin(end, start + 10 + size + (hasFooter ? 10 : 0));
+    }
+    if (end - start >= 128 && matches(data, end - 128, end, "TAG", 3))
+    {
+        end -= 128;
+    }
+    if (end - start >= 32 && matches(data, end - 32, end, "APETAGEX", 8))
+    {
+        size_t size{ juce::ByteOrder::littleEndianInt(data + end - 32 + 12) };
+        bool hasHeader{ (juce::ByteOrder::littleEndianInt(data + end - 32 + 20) & 0x80000000u) != 0 };
+        size_t tagLength{ size + (hasHeader ? 32 : 0) };
+        end = tagLength <= end - start ? end - tagLength : start;
+    }
+}
+
+juce::uint64 TrackFingerprint::compute(const juce::File& file)
+{
+    juce::MemoryMappedFile mapped{ file, juce::MemoryMappedFile::readOnly };
+    if (mapped.getData() == nullptr || mapped.getSize() == 0)
+    {
+        DBG("TrackFingerprint::compute could not map " << file.getFullPathName());
+        return 0;
+    }
+
+    const juce::uint8* data{ static_cast<const juce::uint8*>(mapped.getData()) };
+    size_t start{ 0 };
+    size_t end{ mapped.getSize() };
+    findPayload(data, start, end);
+
+    juce::uint64 fingerprint{ hash(data + start, end - start) };
+    // 0 is reserved for unknown
+    return fingerprint != 0 ? fingerprint : 1;
+}
+
+juce::String TrackFingerprint::toString(juce::uint64 fingerprint)
+{
+    return juce::String::toHexString((juce::int64) fingerprint).paddedLeft('0', 16);
+}
+
+juce::uint64 TrackFingerprint::fromString(const juce::String& text)
+{
+    return (juce::uint64) text.trim().getHexValue64();
+}
+
+//==============================================================================
+FingerprintInputSource::FingerprintInputSource(const juce::File& _file,
+                                               juce::uint64 _fingerprint
+                                              ) : file(_file),
+                                                  fingerprint(_fingerprint)
+{
+}
+
+juce::InputStream* FingerprintInputSource::createInputStream()
+{
+    return file.createInputStream().release();
+}
+
+juce::InputStream* FingerprintInputSource::createInputStreamFor(const juce::String& relatedItemPath)
+{
+    return file.getSiblingFile(relatedItemPath).createInputStream().release();
+}
+
+juce::int64 FingerprintInputSource::hashCode() const
+{
+    return (juce::int64) fingerprint;
+}
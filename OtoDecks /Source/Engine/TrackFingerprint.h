@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    TrackFingerprint.h
+    Created: 21 Mar 2024 7:38:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+//==============================================================================
+/*
+    Fast content hash of the audio payload of a file. Tag blocks (ID3, APE,
+    FLAC metadata, non-audio RIFF/AIFF chunks) are skipped, so retagging,
+    renaming or moving a file keeps its fingerprint. 0 means unknown.
+*/
+class TrackFingerprint
+{
+public:
+    /**Hashes the audio payload of file, returns 0 if it cannot be read*/
+    static juce::uint64 compute(const juce::File& file);
+
+    /**Formats a fingerprint as 16 hex digits*/
+    static juce::String toString(juce::uint64 fingerprint);
+    /**Parses 16 hex digits back into a fingerprint, 0 if empty*/
+    static juce::uint64 fromString(const juce::String& text);
+
+    /**64 bit hash of a block of memory*/
+    static juce::uint64 hash(const void* data, size_t numBytes, juce::uint64 seed = 0);
+
+private:
+    /**Narrows [start, end) of a mapped file down to the bytes that hold audio*/
+    static void findPayload(const juce::uint8* data, size_t& start, size_t& end);
+};
+
+//==============================================================================
+/*
+    Input source for a local file that identifies itself by content
+    fingerprint, so thumbnail caches find waveforms of moved files.
+*/
+class FingerprintInputSource : public juce::InputSource
+{
+public:
+    FingerprintInputSource(const juce::File& _file, juce::uint64 _fingerprint);
+
+    juce::InputStream* createInputStream() override;
+    juce::InputStream* createInputStreamFor(const juce::String& relatedItemPath) override;
+    juce::int64 hashCode() const override;
+
+private:
+    juce::File file;
+    juce::uint64 fingerprint;
+};
@@ -0,0 +1,550 @@
+/*
+  ==============================================================================
+
+    TrackLibrary.cpp
+    Created: 12 Mar 2024 9:02:41pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TrackLibrary.h"
+
+namespace
+{
+    constexpr int columnsVersion{ 1 };
+
+    template <typename Value>
+    void writeColumn(juce::OutputStream& out, const std::vector<Value>& column)
+    {
+        static_assert(std::is_trivially_copyable<Value>::value, "columns are written as raw bytes");
+        out.write(column.data(), column.size() * sizeof(Value));
+    }
+
+    template <typename Value>
+    bool readColumn(juce::InputStream& in, std::vector<Value>& column, size_t numTracks)
+    {
+        const size_t numBytes{ numTracks * sizeof(Value) };
+        if ((juce::int64) numBytes > in.getNumBytesRemaining())
+        {
+            return false;
+        }
+        column.resize(numTracks);
+        return in.read(column.data(), (int) numBytes) == (int) numBytes;
+    }
+
+    juce::uint64 hashPath(const juce::String& path)
+    {
+        return (juce::uint64) path.hashCode64();
+    }
+}
+
+//==============================================================================
+juce::String TrackLibrary::Columns::getTitle(size_t index) const
+{
+    return strings.get(titles[index]);
+}
+
+juce::String TrackLibrary::Columns::getPath(size_t index) const
+{
+    juce::String folder{ strings.get(folders[index]) };
+    if (!folder.endsWith(juce::File::getSeparatorString()))
+    {
+        folder << juce::File::getSeparatorString();
+    }
+    return folder + strings.get(fileNames[index]);
+}
+
+void TrackLibrary::Columns::writeTo(juce::OutputStream& out) const
+{
+    out.writeInt(columnsVersion);
+    out.writeInt((int) ids.size());
+    strings.writeTo(out);
+    writeColumn(out, ids);
+    writeColumn(out, folders);
+    writeColumn(out, fileNames);
+    writeColumn(out, titles);
+    writeColumn(out, durations);
+    writeColumn(out, bpms);
+    writeColumn(out, keys);
+    writeColumn(out, bitrates);
+    writeColumn(out, sampleRates);
+    writeColumn(out, datesAdded);
+    writeColumn(out, playCounts);
+    writeColumn(out, fileSizes);
+    writeColumn(out, modificationTimes);
+    writeColumn(out, fingerprints);
+}
+
+bool TrackLibrary::Columns::readFrom(juce::InputStream& in)
+{
+    const int version{ in.readInt() };
+    const int numTracks{ in.readInt() };
+    if (version != columnsVersion || numTracks < 0 || !strings.readFrom(in))
+    {
+        return false;
+    }
+    const size_t n{ (size_t) numTracks };
+    if (!readColumn(in, ids, n)
+        || !readColumn(in, folders, n)
+        || !readColumn(in, fileNames, n)
+        || !readColumn(in, titles, n)
+        || !readColumn(in, durations, n)
+        || !readColumn(in, bpms, n)
+        || !readColumn(in, keys, n)
+        || !readColumn(in, bitrates, n)
+        || !readColumn(in, sampleRates, n)
+        || !readColumn(in, datesAdded, n)
+        || !readColumn(in, playCounts, n)
+        || !readColumn(in, fileSizes, n)
+        || !readColumn(in, modificationTimes, n)
+        || !readColumn(in, fingerprints, n))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (!strings.isValid(folders[i]) || !strings.isValid(fileNames[i]) || !strings.isValid(titles[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//==============================================================================
+TrackLibrary::TrackLibrary() : nextId(invalidId + 1),
+                               unusedStringBytes(0)
+{
+}
+
+TrackId TrackLibrary::addTrack(const Track& track, TrackId id)
+{
+    if (id == invalidId)
+    {
+        id = nextId++;
+    }
+    else if (contains(id))
+    {
+        DBG("TrackLibrary::addTrack id " << (int) id << " is already in use");
+        return invalidId;
+    }
+    else
+    {
+        // new tracks never take an id that was saved before
+        nextId = juce::jmax(nextId, id + 1);
+    }
+    const int index{ (int) columns.ids.size() };
+    indexById[id] = index;
+    idByPathHash[hashPath(track.file.getFullPathName())] = id;
+    if (track.fingerprint != 0)
+    {
+        idByFingerprint[track.fingerprint] = id;
+    }
+
+    columns.ids.push_back(id);
+    columns.folders.emplace_back();
+    columns.fileNames.emplace_back();
+    columns.titles.emplace_back();
+    storeStrings(index, track.file, track.title);
+    columns.durations.push_back(track.duration);
+    columns.bpms.push_back(track.bpm);
+    columns.keys.push_back((juce::int8) track.key);
+    columns.bitrates.push_back(track.bitrate);
+    columns.sampleRates.push_back(track.sampleRate);
+    columns.datesAdded.push_back(track.dateAdded);
+    columns.playCounts.push_back(track.playCount);
+    columns.fileSizes.push_back(track.fileSize);
+    columns.modificationTimes.push_back(track.modificationTime);
+    columns.fingerprints.push_back(track.fingerprint);
+    return id;
+}
+
+bool TrackLibrary::removeTrack(TrackId id)
+{
+    int index{ indexOf(id) };
+    if (index < 0)
+    {
+        DBG("TrackLibrary::removeTrack no track with id " << (int) id);
+        return false;
+    }
+
+    eraseIfMapped(idByPathHash, hashPath(columns.getPath(index)), id);
+    eraseIfMapped(idByFingerprint, columns.fingerprints[index], id);
+    releaseStrings(index);
+
+    // swap the last track into the hole so removal is O(1)
+    int last{ (int) columns.ids.size() - 1 };
+    if (index != last)
+    {
+        std::swap(columns.ids[index], columns.ids[last]);
+        std::swap(columns.folders[index], columns.folders[last]);
+        std::swap(columns.fileNames[index], columns.fileNames[last]);
+        std::swap(columns.titles[index], columns.titles[last]);
+        std::swap(columns.durations[index], columns.durations[last]);
+        std::swap(columns.bpms[index], columns.bpms[last]);
+        std::swap(columns.keys[index], columns.keys[last]);
+        std::swap(columns.bitrates[index], columns.bitrates[last]);
+        std::swap(columns.sampleRates[index], columns.sampleRates[last]);
+        std::swap(columns.datesAdded[index], columns.datesAdded[last]);
+        std::swap(columns.playCounts[index], columns.playCounts[last]);
+        std::swap(columns.fileSizes[index], columns.fileSizes[last]);
+        std::swap(columns.modificationTimes[index], columns.modificationTimes[last]);
+        std::swap(columns.fingerprints[index], columns.fingerprints[last]);
+        indexById[columns.ids[index]] = index;
+    }
+
+    columns.ids.pop_back();
+    columns.folders.pop_back();
+    columns.fileNames.pop_back();
+    columns.titles.pop_back();
+    columns.durations.pop_back();
+    columns.bpms.pop_back();
+    columns.keys.pop_back();
+    columns.bitrates.pop_back();
+    columns.sampleRates.pop_back();
+    columns.datesAdded.pop_back();
+    columns.playCounts.pop_back();
+    columns.fileSizes.pop_back();
+    columns.modificationTimes.pop_back();
+    columns.fingerprints.pop_back();
+    indexById.erase(id);
+    compactStringsIfNeeded();
+    return true;
+}
+
+void TrackLibrary::setTrack(TrackId id, const Track& track)
+{
+    int index{ indexOf(id) };
+    if (index < 0)
+    {
+        DBG("TrackLibrary::setTrack no track with id " << (int) id);
+        return;
+    }
+
+    if (columns.getPath(index) != track.file.getFullPathName())
+    {
+        relocateTrack(id, track.file);
+    }
+    if (columns.getTitle(index) != track.title)
+    {
+        releaseStrings(index);
+        storeStrings(index, track.file, track.title);
+    }
+    updateTrack(id, track);
+    columns.datesAdded[index] = track.dateAdded;
+    columns.playCounts[index] = track.playCount;
+    compactStringsIfNeeded();
+}
+
+void TrackLibrary::assign(Columns newColumns)
+{
+    clear();
+    columns = std::move(newColumns);
+    const int numTracks{ getNumTracks() };
+    indexById.reserve(numTracks);
+    idByPathHash.reserve(numTracks);
+    idByFingerprint.reserve(numTracks);
+    for (int index = 0; index < numTracks; ++index)
+    {
+        const TrackId id{ columns.ids[index] };
+        indexById[id] = index;
+        idByPathHash[hashPath(columns.getPath(index))] = id;
+        if (columns.fingerprints[index] != 0)
+        {
+            idByFingerprint[columns.fingerprints[index]] = id;
+        }
+        // let new tracks in known folders share the stored folder names
+        columns.strings.addToIndex(columns.folders[index]);
+        nextId = juce::jmax(nextId, id + 1);
+    }
+}
+
+void TrackLibrary::clear()
+{
+    indexById.clear();
+    idByPathHash.clear();
+    idByFingerprint.clear();
+    columns = Columns{};
+    unusedStringBytes = 0;
+}
+
+void TrackLibrary::reserve(int numTracks)
+{
+    indexById.reserve(numTracks);
+    idByPathHash.reserve(numTracks);
+    idByFingerprint.reserve(numTracks);
+    columns.ids.reserve(numTracks);
+    columns.folders.reserve(numTracks);
+    columns.fileNames.reserve(numTracks);
+    columns.titles.reserve(numTracks);
+    columns.durations.reserve(numTracks);
+    columns.bpms.reserve(numTracks);
+    columns.keys.reserve(numTracks);
+    columns.bitrates.reserve(numTracks);
+    columns.sampleRates.reserve(numTracks);
+    columns.datesAdded.reserve(numTracks);
+    columns.playCounts.reserve(numTracks);
+    columns.fileSizes.reserve(numTracks);
+    columns.modificationTimes.reserve(numTracks);
+    columns.fingerprints.reserve(numTracks);
+}
+
+int TrackLibrary::getNumTracks() const
+{
+    return (int) columns.ids.size();
+}
+
+TrackId TrackLibrary::getIdAt(int index) const
+{
+    return juce::isPositiveAndBelow(index, getNumTracks()) ? columns.ids[index] : invalidId;
+}
+
+bool TrackLibrary::contains(TrackId id) const
+{
+    return indexOf(id) >= 0;
+}
+
+TrackId TrackLibrary::findByFingerprint(juce::uint64 fingerprint) const
+{
+    auto it = idByFingerprint.find(fingerprint);
+    return fingerprint != 0 && it != idByFingerprint.end() ? it->second : invalidId;
+}
+
+TrackId TrackLibrary::findByPath(const juce::String& path) const
+{
+    auto it = idByPathHash.find(hashPath(path));
+    if (it == idByPathHash.end())
+    {
+        return invalidId;
+    }
+    // only the hash is kept, so make sure it is not another path with the same hash
+    int index{ indexOf(it->second) };
+    return index >= 0 && columns.getPath(index) == path ? it->second : invalidId;
+}
+
+void TrackLibrary::updateTrack(TrackId id, const Track& track)
+{
+    int index{ indexOf(id) };
+    if (index < 0)
+    {
+        DBG("TrackLibrary::updateTrack no track with id " << (int) id);
+        return;
+    }
+
+    // identity, date added and play count belong to the library, not the file
+    columns.durations[index] = track.duration;
+    columns.bpms[index] = track.bpm;
+    columns.keys[index] = (juce::int8) track.key;
+    columns.bitrates[index] = track.bitrate;
+    columns.sampleRates[index] = track.sampleRate;
+    columns.fileSizes[index] = track.fileSize;
+    columns.modificationTimes[index] = track.modificationTime;
+    setFingerprint(id, track.fingerprint);
+}
+
+void TrackLibrary::relocateTrack(TrackId id, const juce::File& newFile)
+{
+    int index{ indexOf(id) };
+    if (index < 0)
+    {
+        DBG("TrackLibrary::relocateTrack no track with id " << (int) id);
+        return;
+    }
+
+    eraseIfMapped(idByPathHash, hashPath(columns.getPath(index)), id);
+    releaseStrings(index);
+    storeStrings(index, newFile, newFile.getFileNameWithoutExtension());
+    idByPathHash[hashPath(newFile.getFullPathName())] = id;
+    compactStringsIfNeeded();
+}
+
+void TrackLibrary::setFingerprint(TrackId id, juce::uint64 fingerprint)
+{
+    int index{ indexOf(id) };
+    if (index < 0 || columns.fingerprints[index] == fingerprint)
+    {
+        return;
+    }
+
+    eraseIfMapped(idByFingerprint, columns.fingerprints[index], id);
+    columns.fingerprints[index] = fingerprint;
+    if (fingerprint != 0)
+    {
+        idByFingerprint[fingerprint] = id;
+    }
+}
+
+juce::String TrackLibrary::getTitle(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.getTitle(index);
+}
+
+double TrackLibrary::getDuration(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.durations[index];
+}
+
+float TrackLibrary::getBpm(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.bpms[index];
+}
+
+int TrackLibrary::getKey(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.keys[index];
+}
+
+int TrackLibrary::getBitrate(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.bitrates[index];
+}
+
+int TrackLibrary::getSampleRate(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.sampleRates[index];
+}
+
+juce::int64 TrackLibrary::getDateAdded(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.datesAdded[index];
+}
+
+int TrackLibrary::getPlayCount(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.playCounts[index];
+}
+
+juce::int64 TrackLibrary::getFileSize(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.fileSizes[index];
+}
+
+juce::int64 TrackLibrary::getModificationTime(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.modificationTimes[index];
+}
+
+juce::uint64 TrackLibrary::getFingerprint(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return columns.fingerprints[index];
+}
+
+juce::File TrackLibrary::getFile(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    return juce::File{ columns.getPath(index) };
+}
+
+Track TrackLibrary::getTrack(TrackId id) const
+{
+    int index{ indexOf(id) };
+    jassert(index >= 0);
+    Track track{ juce::File{ columns.getPath(index) } };
+    track.title = columns.getTitle(index);
+    track.duration = columns.durations[index];
+    track.bpm = columns.bpms[index];
+    track.key = columns.keys[index];
+    track.bitrate = columns.bitrates[index];
+    track.sampleRate = columns.sampleRates[index];
+    track.dateAdded = columns.datesAdded[index];
+    track.playCount = columns.playCounts[index];
+    track.fileSize = columns.fileSizes[index];
+    track.modificationTime = columns.modificationTimes[index];
+    track.fingerprint = columns.fingerprints[index];
+    return track;
+}
+
+juce::URL TrackLibrary::getURL(TrackId id) const
+{
+    return juce::URL{ getFile(id) };
+}
+
+void TrackLibrary::incrementPlayCount(TrackId id)
+{
+    int index{ indexOf(id) };
+    if (index >= 0)
+    {
+        ++columns.playCounts[index];
+    }
+}
+
+TrackLibrary::Columns TrackLibrary::createSnapshot() const
+{
+    return columns;
+}
+
+int TrackLibrary::indexOf(TrackId id) const
+{
+    auto it = indexById.find(id);
+    return it != indexById.end() ? it->second : -1;
+}
+
+void TrackLibrary::eraseIfMapped(std::unordered_map<juce::uint64, TrackId>& lookup, juce::uint64 key, TrackId id)
+{
+    auto it = lookup.find(key);
+    if (it != lookup.end() && it->second == id)
+    {
+        lookup.erase(it);
+    }
+}
+
+void TrackLibrary::storeStrings(int index, const juce::File& file, const juce::String& title)
+{
+    columns.folders[index] = columns.strings.intern(file.getParentDirectory().getFullPathName());
+    columns.fileNames[index] = columns.strings.add(file.getFileName());
+    columns.titles[index] = columns.strings.addPrefix(columns.fileNames[index], title);
+}
+
+void TrackLibrary::releaseStrings(int index)
+{
+    // folders are shared, only the name and a title of its own belong to the track
+    unusedStringBytes += columns.fileNames[index].numBytes;
+    if (columns.titles[index].offset != columns.fileNames[index].offset)
+    {
+        unusedStringBytes += columns.titles[index].numBytes;
+    }
+}
+
+void TrackLibrary::compactStringsIfNeeded()
+{
+    if (unusedStringBytes < minUnusedStringBytes || 2 * unusedStringBytes < columns.strings.getNumBytes())
+    {
+        return;
+    }
+
+    StringArena strings;
+    strings.reserve(columns.strings.getNumBytes() - unusedStringBytes);
+    for (size_t i = 0; i < columns.ids.size(); ++i)
+    {
+        columns.folders[i] = strings.intern(columns.strings.get(columns.folders[i]));
+        StringArena::Handle fileName{ strings.add(columns.strings.get(columns.fileNames[i])) };
+        columns.titles[i] = strings.addPrefix(fileName, columns.strings.get(columns.titles[i]));
+        columns.fileNames[i] = fileName;
+    }
+    columns.strings = std::move(strings);
+    unusedStringBytes = 0;
+}
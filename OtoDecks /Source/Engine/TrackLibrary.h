@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    TrackLibrary.h
+    Created: 12 Mar 2024 9:02:41pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "Track.h"
+#include "StringArena.h"
+
+/**Stable identifier of a track in the library, kept across runs by the LibraryStore*/
+using TrackId = juce::uint32;
+
+//==============================================================================
+/*
+    Columnar store for the track library. Every attribute lives in its own
+    array so the table only touches the columns it draws, and tracks are
+    addressed by a stable TrackId instead of their current row index.
+    Folders, file names and titles live in one string arena, so a track
+    costs a few handles and the bytes of its name, and the whole library
+    is copied, saved and loaded as a handful of flat blocks.
+*/
+class TrackLibrary
+{
+public:
+    static constexpr TrackId invalidId = 0;
+
+    /**Sortable and filterable attributes of a track*/
+    enum class Column
+    {
+        title = 1,
+        duration,
+        bpm,
+        key,
+        bitrate,
+        sampleRate,
+        dateAdded,
+        playCount
+    };
+
+    /**The column arrays, all indexed by the same storage index*/
+    struct Columns
+    {
+        std::vector<TrackId> ids;
+        StringArena strings;
+        /**folders are interned, a library holds many tracks per folder*/
+        std::vector<StringArena::Handle> folders;
+        std::vector<StringArena::Handle> fileNames;
+        /**points into the file name when the title is the name without its extension*/
+        std::vector<StringArena::Handle> titles;
+        std::vector<double> durations;
+        std::vector<float> bpms;
+        std::vector<juce::int8> keys;
+        std::vector<int> bitrates;
+        std::vector<int> sampleRates;
+        std::vector<juce::int64> datesAdded;
+        std::vector<int> playCounts;
+        std::vector<juce::int64> fileSizes;
+        std::vector<juce::int64> modificationTimes;
+        std::vector<juce::uint64> fingerprints;
+
+        juce::String getTitle(size_t index) const;
+        juce::String getPath(size_t index) const;
+        /**Writes every column as one block in the byte order of this machine*/
+        void writeTo(juce::OutputStream& out) const;
+        /**Reads columns written by writeTo, returns false if the data is not valid*/
+        bool readFrom(juce::InputStream& in);
+    };
+
+    TrackLibrary();
+
+    /**Adds the track to the store and returns its id, pass the id it was saved
+       under to keep it across runs or invalidId for a new one*/
+    TrackId addTrack(const Track& track, TrackId id = invalidId);
+    /**Removes the track with this id, returns false if it was not found*/
+    bool removeTrack(TrackId id);
+    /**Replaces every attribute of a stored track*/
+    void setTrack(TrackId id, const Track& track);
+    /**Replaces the whole library with these columns, the ids are kept*/
+    void assign(Columns newColumns);
+    /**Removes every track from the store*/
+    void clear();
+    /**Reserves space for the given number of tracks in every column*/
+    void reserve(int numTracks);
+
+    /**Gets the number of tracks in the store*/
+    int getNumTracks() const;
+    /**Gets the id of the track stored at index*/
+    TrackId getIdAt(int index) const;
+    /**Checks if a track with this id is in the store*/
+    bool contains(TrackId id) const;
+    /**Finds the track with this content fingerprint, or invalidId*/
+    TrackId findByFingerprint(juce::uint64 fingerprint) const;
+    /**Finds the track stored at this full path, or invalidId*/
+    TrackId findByPath(const juce::String& path) const;
+    /**Replaces the probed metadata of a track whose file changed on disk*/
+    void updateTrack(TrackId id, const Track& track);
+    /**Points a track at the new location of its file, keeping everything else*/
+    void relocateTrack(TrackId id, const juce::File& newFile);
+    /**Sets the fingerprint of a track that was added without one*/
+    void setFingerprint(TrackId id, juce::uint64 fingerprint);
+
+    juce::String getTitle(TrackId id) const;
+    double getDuration(TrackId id) const;
+    float getBpm(TrackId id) const;
+    int getKey(TrackId id) const;
+    int getBitrate(TrackId id) const;
+    int getSampleRate(TrackId id) const;
+    juce::int64 getDateAdded(TrackId id) const;
+    int getPlayCount(TrackId id) const;
+    juce::int64 getFileSize(TrackId id) const;
+    juce::int64 getModificationTime(TrackId id) const;
+    juce::uint64 getFingerprint(TrackId id) const;
+    juce::File getFile(TrackId id) const;
+    /**Gathers every attribute of a track back into a Track*/
+    Track getTrack(TrackId id) const;
+    /**URLs are derived on demand from the stored path*/
+    juce::URL getURL(TrackId id) const;
+
+    /**Counts one more play of the track*/
+    void incrementPlayCount(TrackId id);
+
+    /**Copies every column, used to sort and filter off the message thread*/
+    Columns createSnapshot() const;
+
+private:
+    int indexOf(TrackId id) const;
+    /**Erases key from a lookup only if it maps to id, another track may have claimed it since*/
+    static void eraseIfMapped(std::unordered_map<juce::uint64, TrackId>& lookup, juce::uint64 key, TrackId id);
+    /**Writes the file and title of the track at index into the arena*/
+    void storeStrings(int index, const juce::File& file, const juce::String& title);
+    /**Counts the bytes of the strings at index as unused*/
+    void releaseStrings(int index);
+    /**Builds a fresh arena once most of it is unused*/
+    void compactStringsIfNeeded();
+
+    TrackId nextId;
+    std::unordered_map<TrackId, int> indexById;
+    // hash lookups so identity checks do not scan the columns, the
+    // fingerprint is the primary key and the path only locates the file,
+    // paths are keyed by their hash so they are not stored twice
+    std::unordered_map<juce::uint64, TrackId> idByFingerprint;
+    std::unordered_map<juce::uint64, TrackId> idByPathHash;
+    Columns columns;
+    /**bytes of the arena that belong to removed or moved tracks*/
+    size_t unusedStringBytes;
+
+    /**the arena is rebuilt once this much of it and at least half is unused*/
+    static constexpr size_t minUnusedStringBytes{ 64 * 1024 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackLibrary)
+};
@@ -0,0 +1,202 @@
+/*
+  ==============================================================================
+
+    TrackPrefetcher.cpp
+    Created: 17 Apr 2024 9:26:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TrackPrefetcher.h"
+#include "Track.h"
+
+//==============================================================================
+TrackPrefetcher::TrackPrefetcher(juce::AudioFormatManager& _formatManager,
+                                 WaveformSink* _waveforms,
+                                 size_t _maxBytes
+                                ) : juce::Thread("Track Prefetcher"),
+                                    formatManager(_formatManager),
+                                    waveforms(_waveforms),
+                                    maxBytes(_maxBytes),
+                                    cachedBytes(0)
+{
+    startThread();
+}
+
+TrackPrefetcher::~TrackPrefetcher()
+{
+    stopThread(4000);
+}
+
+void TrackPrefetcher::setCandidates(std::vector<Candidate> newCandidates)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        candidates = std::move(newCandidates);
+    }
+    notify();
+}
+
+std::shared_ptr<const PrefetchedTrack> TrackPrefetcher::find(juce::uint64 fingerprint)
+{
+    const juce::ScopedLock sl(lock);
+    auto it = entryByFingerprint.find(fingerprint);
+    if (fingerprint == 0 || it == entryByFingerprint.end())
+    {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+size_t TrackPrefetcher::getCachedBytes() const
+{
+    const juce::ScopedLock sl(lock);
+    return cachedBytes;
+}
+
+void TrackPrefetcher::run()
+{
+    while (!threadShouldExit())
+    {
+        Candidate next;
+        int rank{ pickNext(next) };
+        if (rank < 0)
+        {
+            // everything likely is decoded, sleep until the selection changes
+            wait(-1);
+            continue;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(next.file) };
+        if (reader == nullptr || reader->lengthInSamples <= 0
+            || reader->lengthInSamples > std::numeric_limits<int>::max())
+        {
+            DBG("TrackPrefetcher could not read " << next.file.getFullPathName());
+            const juce::ScopedLock sl(lock);
+            unreadable.insert(next.fingerprint);
+            continue;
+        }
+
+        const size_t numBytes{ (size_t) reader->lengthInSamples * juce::jmin(reader->numChannels, 2u) * sizeof(float) };
+        if (numBytes > maxBytes)
+        {
+            // a long mix that would never fit, the tracks ranked below it still can
+            DBG("TrackPrefetcher " << next.file.getFullPathName() << " is larger than the whole cache");
+            const juce::ScopedLock sl(lock);
+            oversized.insert(next.fingerprint);
+            continue;
+        }
+        if (!makeRoom(numBytes, rank))
+        {
+            // the cache is full of tracks more likely than this one
+            wait(-1);
+            continue;
+        }
+
+        std::shared_ptr<PrefetchedTrack> track{ decode(*reader, next.file) };
+        if (track == nullptr)
+        {
+            continue;
+        }
+        storeWaveform(next.fingerprint, *track);
+
+        const juce::ScopedLock sl(lock);
+        if (entryByFingerprint.count(next.fingerprint) == 0)
+        {
+            entries.emplace_front(next.fingerprint, track);
+            entryByFingerprint[next.fingerprint] = entries.begin();
+            cachedBytes += numBytes;
+        }
+    }
+}
+
+int TrackPrefetcher::pickNext(Candidate& next)
+{
+    const juce::ScopedLock sl(lock);
+    for (int i = 0; i < (int) candidates.size(); ++i)
+    {
+        const Candidate& candidate{ candidates[i] };
+        if (candidate.fingerprint != 0
+            && entryByFingerprint.count(candidate.fingerprint) == 0
+            && unreadable.count(candidate.fingerprint) == 0
+            && oversized.count(candidate.fingerprint) == 0)
+        {
+            next = candidate;
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool TrackPrefetcher::makeRoom(size_t numBytes, int rank)
+{
+    const juce::ScopedLock sl(lock);
+    if (numBytes > maxBytes)
+    {
+        return false;
+    }
+
+    // candidates ranked above this one keep their place in the cache
+    std::unordered_set<juce::uint64> keep;
+    for (int i = 0; i < rank && i < (int) candidates.size(); ++i)
+    {
+        keep.insert(candidates[i].fingerprint);
+    }
+
+    auto it = entries.end();
+    while (cachedBytes + numBytes > maxBytes && it != entries.begin())
+    {
+        --it;
+        if (keep.count(it->first) != 0)
+        {
+            continue;
+        }
+        const juce::AudioBuffer<float>& audio{ *it->second->audio };
+        cachedBytes -= (size_t) audio.getNumSamples() * audio.getNumChannels() * sizeof(float);
+        entryByFingerprint.erase(it->first);
+        // a deck playing the track keeps its own reference to the buffer
+        it = entries.erase(it);
+    }
+    return cachedBytes + numBytes <= maxBytes;
+}
+
+std::shared_ptr<PrefetchedTrack> TrackPrefetcher::decode(juce::AudioFormatReader& reader, const juce::File& file)
+{
+    const int length{ (int) reader.lengthInSamples };
+    auto audio = std::make_shared<juce::AudioBuffer<float>>((int) juce::jmin(reader.numChannels, 2u), length);
+    for (int start = 0; start < length; start += chunkSamples)
+    {
+        if (threadShouldExit())
+        {
+            return nullptr;
+        }
+        reader.read(audio.get(), start, juce::jmin(chunkSamples, length - start), start, true, true);
+    }
+
+    Track track{ file };
+    track.readMetadata(reader);
+    auto result = std::make_shared<PrefetchedTrack>();
+    result->audio = std::move(audio);
+    result->sampleRate = reader.sampleRate;
+    result->bpm = track.bpm;
+    return result;
+}
+
+void TrackPrefetcher::storeWaveform(juce::uint64 fingerprint, const PrefetchedTrack& track)
+{
+    if (waveforms == nullptr)
+    {
+        return;
+    }
+    // same key as the waveform display, so loading the deck hits the cache
+    const juce::AudioBuffer<float>& audio{ *track.audio };
+    std::unique_ptr<WaveformSink::Writer> writer{ waveforms->createWriter(fingerprint, audio.getNumChannels(),
+                                                                          track.sampleRate, audio.getNumSamples()) };
+    if (writer != nullptr)
+    {
+        writer->addBlock(0, audio, 0, audio.getNumSamples());
+        writer->finish();
+    }
+}
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    TrackPrefetcher.h
+    Created: 17 Apr 2024 9:26:52pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "WaveformSink.h"
+
+/**A whole track decoded into memory, shared between the cache and the decks playing it*/
+struct PrefetchedTrack
+{
+    std::shared_ptr<juce::AudioBuffer<float>> audio;
+    double sampleRate;
+    /**tempo from the tags, 0 if unknown*/
+    float bpm;
+};
+
+//==============================================================================
+/*
+    Decodes the tracks the user is likely to load next on a background
+    thread, so loading one into a deck only swaps in a buffer. Candidates
+    come in order of likelihood and are decoded in that order into a cache
+    bounded in bytes; when it is full the least recently used track that is
+    less likely than the next candidate is dropped. The audio of each
+    decoded track is handed to the waveform sink on the way.
+*/
+class TrackPrefetcher : private juce::Thread
+{
+public:
+    /**A track worth decoding, identified by the fingerprint of its audio*/
+    struct Candidate
+    {
+        juce::uint64 fingerprint;
+        juce::File file;
+    };
+
+    static constexpr size_t defaultMaxBytes{ 512 * 1024 * 1024 };
+
+    TrackPrefetcher(juce::AudioFormatManager& _formatManager,
+                    WaveformSink* _waveforms,
+                    size_t _maxBytes = defaultMaxBytes);
+    ~TrackPrefetcher() override;
+
+    /**Replaces the tracks to decode, most likely first*/
+    void setCandidates(std::vector<Candidate> newCandidates);
+    /**Gets a decoded track and marks it as recently used, nullptr if it is not decoded yet*/
+    std::shared_ptr<const PrefetchedTrack> find(juce::uint64 fingerprint);
+    /**Gets the memory taken by the decoded tracks in the cache*/
+    size_t getCachedBytes() const;
+
+private:
+    using Entry = std::pair<juce::uint64, std::shared_ptr<const PrefetchedTrack>>;
+
+    void run() override;
+    /**Finds the most likely candidate that is not decoded yet, returns its rank or -1*/
+    int pickNext(Candidate& next);
+    /**Drops tracks less likely than the candidate of this rank until numBytes fit*/
+    bool makeRoom(size_t numBytes, int rank);
+    /**Decodes the whole track, nullptr if it could not be read*/
+    std::shared_ptr<PrefetchedTrack> decode(juce::AudioFormatReader& reader, const juce::File& file);
+    /**Hands the decoded track to the waveform sink if its waveform is not stored yet*/
+    void storeWaveform(juce::uint64 fingerprint, const PrefetchedTrack& track);
+
+    juce::AudioFormatManager& formatManager;
+    /**nullptr when nobody draws waveforms*/
+    WaveformSink* waveforms;
+    const size_t maxBytes;
+
+    // shared between the message and prefetch threads
+    mutable juce::CriticalSection lock;
+    std::vector<Candidate> candidates;
+    /**most recently used first*/
+    std::list<Entry> entries;
+    std::unordered_map<juce::uint64, std::list<Entry>::iterator> entryByFingerprint;
+    std::unordered_set<juce::uint64> unreadable;
+    /**tracks larger than the whole cache, never decoded*/
+    std::unordered_set<juce::uint64> oversized;
+    size_t cachedBytes;
+
+    /**samples decoded per read, keeps the thread responsive to exit requests*/
+    static constexpr int chunkSamples{ 1 << 16 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackPrefetcher)
+};
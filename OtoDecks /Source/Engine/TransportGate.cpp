@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    TransportGate.cpp
+    Created: 9 Apr 2024 8:40:15pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TransportGate.h"
+
+//==============================================================================
+TransportGate::TransportGate(juce::AudioSource* _input) : input(_input),
+                                                          open(false),
+                                                          level(0)
+{
+}
+
+TransportGate::~TransportGate()
+{
+}
+
+void TransportGate::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void TransportGate::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (!open && level == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    input->getNextAudioBlock(bufferToFill);
+    const float target{ open ? 1.0f : 0.0f };
+    if (level == target)
+    {
+        return;
+    }
+
+    // the ramp picks up where it was if the gate turns around mid-fade
+    const int remaining{ juce::roundToInt(std::abs(target - level) * fadeSamples) };
+    const int rampSamples{ juce::jmin(bufferToFill.numSamples, remaining) };
+    const float step{ (open ? 1.0f : -1.0f) / fadeSamples };
+    const float endLevel{ rampSamples == remaining ? target : level + step * rampSamples };
+    bufferToFill.buffer->applyGainRamp(bufferToFill.startSample, rampSamples, level, endLevel);
+    if (!open && rampSamples < bufferToFill.numSamples)
+    {
+        bufferToFill.buffer->clear(bufferToFill.startSample + rampSamples, bufferToFill.numSamples - rampSamples);
+    }
+    level = endLevel;
+}
+
+void TransportGate::releaseResources()
+{
+    input->releaseResources();
+}
+
+void TransportGate::setOpen(bool shouldBeOpen, bool fade)
+{
+    open = shouldBeOpen;
+    if (!fade)
+    {
+        level = open ? 1.0f : 0.0f;
+    }
+}
+
+bool TransportGate::isOpen() const
+{
+    return open;
+}
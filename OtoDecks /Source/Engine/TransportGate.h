@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    TransportGate.h
+    Created: 9 Apr 2024 8:40:15pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+//==============================================================================
+/*
+    Starts and stops a deck on the audio thread. The transport below it is
+    left running and is simply not pulled while the gate is closed, so play
+    and stop take effect on an exact sample without AudioTransportSource
+    waiting for its own callback. Opening and closing fade over a few
+    samples to avoid clicks.
+*/
+class TransportGate : public juce::AudioSource
+{
+public:
+    static constexpr int fadeSamples{ 128 };
+
+    TransportGate(juce::AudioSource* _input);
+    ~TransportGate() override;
+
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+    void releaseResources() override;
+
+    /**Opens or closes the gate from the next sample rendered, audio thread only*/
+    void setOpen(bool shouldBeOpen, bool fade = true);
+    /**Checks if the gate is open or opening, audio thread only*/
+    bool isOpen() const;
+
+private:
+    juce::AudioSource* input;
+    bool open;
+    float level;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportGate)
+};
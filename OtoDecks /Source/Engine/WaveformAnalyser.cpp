@@ -0,0 +1,290 @@
+/*
+  ==============================================================================
+
+    WaveformAnalyser.cpp
+    Created: 20 Apr 2024 4:18:33pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "WaveformAnalyser.h"
+
+namespace
+{
+    const char bandsMagic[8]{ 'O', 'T', 'O', 'B', 'A', 'N', 'D', 'S' };
+
+    /**Maps a level between 0 and 1 onto a byte*/
+    juce::uint8 toByte(float level)
+    {
+        return (juce::uint8) juce::jlimit(0, 255, juce::roundToInt(level * 255.0f));
+    }
+
+    /**RMS of a run of squared samples, scaled so a full scale sine reads 1*/
+    float rmsOfSquares(const float* squares, int numSamples)
+    {
+        float sum{ 0 };
+        for (int i = 0; i < numSamples; ++i)
+        {
+            sum += squares[i];
+        }
+        return std::sqrt(2.0f * sum / (float) numSamples);
+    }
+}
+
+//==============================================================================
+int WaveformBands::getNumBins() const
+{
+    return (int) peaks.size();
+}
+
+void WaveformBands::writeTo(juce::OutputStream& out) const
+{
+    out.write(bandsMagic, sizeof(bandsMagic));
+    out.writeInt(samplesPerBin);
+    out.writeDouble(sampleRate);
+    out.writeInt(getNumBins());
+    for (const std::vector<juce::uint8>* band : { &peaks, &lows, &mids, &highs })
+    {
+        out.write(band->data(), band->size());
+    }
+}
+
+bool WaveformBands::readFrom(juce::InputStream& in)
+{
+    char magic[sizeof(bandsMagic)];
+    if (in.read(magic, sizeof(magic)) != (int) sizeof(magic) || std::memcmp(magic, bandsMagic, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+    samplesPerBin = in.readInt();
+    sampleRate = in.readDouble();
+    int numBins{ in.readInt() };
+    if (samplesPerBin <= 0 || numBins < 0 || numBins > in.getNumBytesRemaining() / 4)
+    {
+        return false;
+    }
+    for (std::vector<juce::uint8>* band : { &peaks, &lows, &mids, &highs })
+    {
+        band->resize((size_t) numBins);
+        if (in.read(band->data(), numBins) != numBins)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//==============================================================================
+WaveformAnalyser::WaveformAnalyser(juce::AudioFormatManager& _formatManager,
+                                   const juce::File& _directory,
+                                   WaveformSink* _waveforms
+                                  ) : juce::Thread("Waveform Analyser"),
+                                      formatManager(_formatManager),
+                                      directory(_directory),
+                                      waveforms(_waveforms)
+{
+    directory.createDirectory();
+    startThread();
+}
+
+WaveformAnalyser::~WaveformAnalyser()
+{
+    stopThread(4000);
+}
+
+void WaveformAnalyser::request(juce::uint64 fingerprint, const juce::File& file, bool urgent)
+{
+    if (fingerprint == 0)
+    {
+        DBG("WaveformAnalyser::request the track has no fingerprint");
+        return;
+    }
+    {
+        const juce::ScopedLock sl(lock);
+        auto it = std::find_if(jobs.begin(), jobs.end(),
+            [fingerprint](const Job& job) {return job.fingerprint == fingerprint; });
+        if (it != jobs.end())
+        {
+            if (!urgent)
+            {
+                return;
+            }
+            jobs.erase(it);
+        }
+        if (urgent)
+        {
+            jobs.push_front(Job{ fingerprint, file });
+        }
+        else
+        {
+            jobs.push_back(Job{ fingerprint, file });
+        }
+    }
+    notify();
+}
+
+bool WaveformAnalyser::loadBands(juce::uint64 fingerprint, WaveformBands& bands) const
+{
+    juce::FileInputStream in{ getBandsFile(fingerprint) };
+    return in.openedOk() && bands.readFrom(in);
+}
+
+bool WaveformAnalyser::analyseAndStore(juce::uint64 fingerprint,
+                                       juce::AudioFormatReader& reader,
+                                       const std::function<bool()>& shouldStop)
+{
+    // the peaks come from the same decode as the bands
+    std::unique_ptr<WaveformSink::Writer> waveform;
+    if (waveforms != nullptr)
+    {
+        waveform = waveforms->createWriter(fingerprint, (int) juce::jmin(reader.numChannels, 2u),
+                                           reader.sampleRate, reader.lengthInSamples);
+    }
+
+    WaveformBands bands;
+    if (!analyse(reader, bands, shouldStop, waveform.get()))
+    {
+        return false;
+    }
+
+    // write to a temporary file so a crash never leaves half the bands
+    juce::File bandsFile{ getBandsFile(fingerprint) };
+    juce::TemporaryFile temp{ bandsFile };
+    {
+        juce::FileOutputStream out{ temp.getFile() };
+        if (!out.openedOk())
+        {
+            DBG("WaveformAnalyser could not write " << temp.getFile().getFullPathName());
+            return false;
+        }
+        bands.writeTo(out);
+    }
+    temp.overwriteTargetFileWithTemporary();
+    if (waveform != nullptr)
+    {
+        waveform->finish();
+    }
+    sendChangeMessage();
+    return true;
+}
+
+bool WaveformAnalyser::analyse(juce::AudioFormatReader& reader,
+                               WaveformBands& bands,
+                               const std::function<bool()>& shouldStop,
+                               WaveformSink::Writer* waveform)
+{
+    const juce::int64 length{ reader.lengthInSamples };
+    if (length <= 0 || reader.sampleRate <= 0 || reader.numChannels == 0)
+    {
+        return false;
+    }
+
+    const int numChannels{ (int) juce::jmin(reader.numChannels, 2u) };
+    const int numBins{ (int) ((length + samplesPerBin - 1) / samplesPerBin) };
+    bands.samplesPerBin = samplesPerBin;
+    bands.sampleRate = reader.sampleRate;
+    for (std::vector<juce::uint8>* band : { &bands.peaks, &bands.lows, &bands.mids, &bands.highs })
+    {
+        band->assign((size_t) numBins, 0);
+    }
+
+    juce::IIRFilter lowPass;
+    juce::IIRFilter highPass;
+    lowPass.setCoefficients(juce::IIRCoefficients::makeLowPass(reader.sampleRate, lowCrossover));
+    highPass.setCoefficients(juce::IIRCoefficients::makeHighPass(reader.sampleRate, highCrossover));
+
+    // whole bins per chunk so the filters run on across chunks and bins never straddle one
+    constexpr int binsPerChunk{ 64 };
+    constexpr int chunkSamples{ samplesPerBin * binsPerChunk };
+    juce::AudioBuffer<float> input{ numChannels, chunkSamples };
+    juce::AudioBuffer<float> split{ 3, chunkSamples };
+    for (juce::int64 start = 0; start < length; start += chunkSamples)
+    {
+        if (shouldStop())
+        {
+            return false;
+        }
+        const int numSamples{ (int) juce::jmin((juce::int64) chunkSamples, length - start) };
+        reader.read(&input, 0, numSamples, start, true, true);
+        if (waveform != nullptr)
+        {
+            waveform->addBlock(start, input, 0, numSamples);
+        }
+
+        // fold to mono and split into bands, the mid band is what both filters leave
+        float* mid{ split.getWritePointer(0) };
+        float* low{ split.getWritePointer(1) };
+        float* high{ split.getWritePointer(2) };
+        juce::FloatVectorOperations::copyWithMultiply(mid, input.getReadPointer(0), 1.0f / numChannels, numSamples);
+        for (int ch = 1; ch < numChannels; ++ch)
+        {
+            juce::FloatVectorOperations::addWithMultiply(mid, input.getReadPointer(ch), 1.0f / numChannels, numSamples);
+        }
+        juce::FloatVectorOperations::copy(low, mid, numSamples);
+        lowPass.processSamples(low, numSamples);
+        juce::FloatVectorOperations::copy(high, mid, numSamples);
+        highPass.processSamples(high, numSamples);
+        juce::FloatVectorOperations::subtract(mid, low, numSamples);
+        juce::FloatVectorOperations::subtract(mid, high, numSamples);
+        for (int band = 0; band < 3; ++band)
+        {
+            juce::FloatVectorOperations::multiply(split.getWritePointer(band), split.getReadPointer(band), numSamples);
+        }
+
+        const int firstBin{ (int) (start / samplesPerBin) };
+        for (int offset = 0, bin = firstBin; offset < numSamples; offset += samplesPerBin, ++bin)
+        {
+            const int count{ juce::jmin(samplesPerBin, numSamples - offset) };
+            float peak{ 0 };
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                juce::Range<float> range{ juce::FloatVectorOperations::findMinAndMax(input.getReadPointer(ch, offset), count) };
+                peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+            }
+            bands.peaks[(size_t) bin] = toByte(peak);
+            bands.lows[(size_t) bin] = toByte(rmsOfSquares(low + offset, count));
+            bands.mids[(size_t) bin] = toByte(rmsOfSquares(mid + offset, count));
+            bands.highs[(size_t) bin] = toByte(rmsOfSquares(high + offset, count));
+        }
+    }
+    return true;
+}
+
+void WaveformAnalyser::run()
+{
+    while (!threadShouldExit())
+    {
+        Job job;
+        bool hasJob{ false };
+        {
+            const juce::ScopedLock sl(lock);
+            if (!jobs.empty())
+            {
+                job = jobs.front();
+                jobs.pop_front();
+                hasJob = true;
+            }
+        }
+        if (!hasJob)
+        {
+            wait(-1);
+            continue;
+        }
+
+        if (getBandsFile(job.fingerprint).existsAsFile())
+        {
+            continue;
+        }
+        std::unique_ptr<juce::AudioFormatReader> reader{ formatManager.createReaderFor(job.file) };
+        if (reader == nullptr || !analyseAndStore(job.fingerprint, *reader, [this] { return threadShouldExit(); }))
+        {
+            DBG("WaveformAnalyser could not analyse " << job.file.getFullPathName());
+        }
+    }
+}
+
+juce::File WaveformAnalyser::getBandsFile(juce::uint64 fingerprint) const
+{
+    return directory.getChildFile(juce::String::toHexString((juce::int64) fingerprint).paddedLeft('0', 16) + ".bands");
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    WaveformAnalyser.h
+    Created: 20 Apr 2024 4:18:33pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_events/juce_events.h>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "WaveformSink.h"
+
+/**Peak level and low, mid and high band levels of a track, one byte each per bin*/
+struct WaveformBands
+{
+    int samplesPerBin{ 0 };
+    double sampleRate{ 0 };
+    std::vector<juce::uint8> peaks;
+    std::vector<juce::uint8> lows;
+    std::vector<juce::uint8> mids;
+    std::vector<juce::uint8> highs;
+
+    int getNumBins() const;
+    void writeTo(juce::OutputStream& out) const;
+    /**Reads bands written by writeTo, returns false if the data is not valid*/
+    bool readFrom(juce::InputStream& in);
+};
+
+//==============================================================================
+/*
+    Splits every track into low, mid and high bands once, when it is imported
+    or first loaded, and keeps the level of each band per bin in a file per
+    track. The display colours the waveform from these levels, so drawing it
+    costs no DSP at all. The peaks come from the same decode and go to the
+    waveform sink.
+*/
+class WaveformAnalyser : public juce::ChangeBroadcaster,
+                         private juce::Thread
+{
+public:
+    static constexpr int samplesPerBin{ 1000 };
+    /**crossover between the low and mid bands in Hz*/
+    static constexpr double lowCrossover{ 250.0 };
+    /**crossover between the mid and high bands in Hz*/
+    static constexpr double highCrossover{ 2500.0 };
+
+    WaveformAnalyser(juce::AudioFormatManager& _formatManager,
+                     const juce::File& _directory,
+                     WaveformSink* _waveforms);
+    ~WaveformAnalyser() override;
+
+    /**Queues a track unless its bands are already cached, urgent ones go first.
+       A change message is sent every time a track has been analysed.*/
+    void request(juce::uint64 fingerprint, const juce::File& file, bool urgent);
+    /**Loads the cached bands of a track, returns false if it was not analysed yet*/
+    bool loadBands(juce::uint64 fingerprint, WaveformBands& bands) const;
+    /**Analyses a track on the calling thread, caches its bands and hands its peaks to the sink,
+       safe to call from several threads at once*/
+    bool analyseAndStore(juce::uint64 fingerprint, juce::AudioFormatReader& reader, const std::function<bool()>& shouldStop);
+
+    /**Analyses a whole track, returns false if it has no audio or shouldStop returned true.
+       Every decoded block is also added to the waveform if one is given.*/
+    static bool analyse(juce::AudioFormatReader& reader,
+                        WaveformBands& bands,
+                        const std::function<bool()>& shouldStop,
+                        WaveformSink::Writer* waveform = nullptr);
+
+private:
+    struct Job
+    {
+        juce::uint64 fingerprint;
+        juce::File file;
+    };
+
+    void run() override;
+    /**Gets the file the bands of a track are kept in*/
+    juce::File getBandsFile(juce::uint64 fingerprint) const;
+
+    juce::AudioFormatManager& formatManager;
+    juce::File directory;
+    /**nullptr when nobody draws waveforms*/
+    WaveformSink* waveforms;
+
+    juce::CriticalSection lock;
+    std::deque<Job> jobs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformAnalyser)
+};
@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    WaveformSink.h
+    Created: 2 May 2024 7:48:05pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+
+//==============================================================================
+/*
+    Receives the audio of every track the engine decodes anyway, so whoever
+    draws waveforms can build them without decoding the track again. The
+    engine never draws anything itself; the GUI passes its thumbnail cache
+    and a headless engine passes none.
+*/
+class WaveformSink
+{
+public:
+    /**Builds the waveform of one track from its audio, in order from the start*/
+    class Writer
+    {
+    public:
+        virtual ~Writer() = default;
+        virtual void addBlock(juce::int64 startSample, const juce::AudioBuffer<float>& audio, int startOffset, int numSamples) = 0;
+        /**Stores the waveform once the whole track has been added*/
+        virtual void finish() = 0;
+    };
+
+    virtual ~WaveformSink() = default;
+
+    /**Starts the waveform of a track, nullptr if it is stored already.
+       Called from several background threads at once.*/
+    virtual std::unique_ptr<Writer> createWriter(juce::uint64 fingerprint,
+                                                 int numChannels,
+                                                 double sampleRate,
+                                                 juce::int64 numSamples) = 0;
+};
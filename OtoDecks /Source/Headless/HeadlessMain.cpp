@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    HeadlessMain.cpp
+    Created: 2 May 2024 9:02:17pm
+    Author:  Kirby Loh
+
+    Runs the engine without a window, as a playout service:
+
+        OtoDecksHeadless [--data <folder>] <track> [<track> ...]
+
+    plays the tracks through the auto DJ on the default audio device and
+    quits once the last one has played through, and
+
+        OtoDecksHeadless --replay <session.otolog> <output.wav>
+
+    renders a logged session the same way the app does.
+
+  ==============================================================================
+*/
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <deque>
+#include <iostream>
+#include "../Engine/OtoEngine.h"
+#include "../Engine/EventReplay.h"
+
+namespace
+{
+//==============================================================================
+/*
+    Feeds the files from the command line to the auto DJ, and stops the
+    message loop once the queue is empty and the last track has come round
+    to its start again, tracks repeat when they end.
+*/
+class Playout : public AutoDJ::Source,
+                private juce::Timer
+{
+public:
+    Playout(OtoEngine& _engine, const juce::Array<juce::File>& files) : engine(_engine),
+                                                                         queue(files.begin(), files.end()),
+                                                                         lastDeck(-1),
+                                                                         lastPosition(0),
+                                                                         lastTrackStarted(false)
+    {
+        engine.getAutoDJ().setSource(this);
+        engine.getAutoDJ().setEnabled(true);
+        startTimer(250);
+    }
+
+    ~Playout() override
+    {
+        stopTimer();
+        engine.getAutoDJ().setEnabled(false);
+        engine.getAutoDJ().setSource(nullptr);
+    }
+
+    bool loadNextTrack(int deck) override
+    {
+        if (queue.empty())
+        {
+            return false;
+        }
+        const juce::File file{ queue.front() };
+        queue.pop_front();
+        std::cout << "deck " << deck + 1 << ": " << file.getFullPathName() << std::endl;
+        engine.loadTrack(deck, juce::URL{ file });
+        lastDeck = deck;
+        lastPosition = 0;
+        lastTrackStarted = false;
+        return true;
+    }
+
+private:
+    void timerCallback() override
+    {
+        if (!queue.empty() || lastDeck < 0)
+        {
+            return;
+        }
+        DJAudioPlayer& deck{ engine.getDeck(lastDeck) };
+        const double position{ deck.getPositionRelative() };
+        const bool wrapped{ lastTrackStarted && position < lastPosition };
+        if (wrapped || (lastTrackStarted && !deck.isPlaying()))
+        {
+            deck.stop();
+            juce::MessageManager::getInstance()->stopDispatchLoop();
+            return;
+        }
+        lastTrackStarted = lastTrackStarted || deck.isPlaying();
+        lastPosition = position;
+    }
+
+    OtoEngine& engine;
+    std::deque<juce::File> queue;
+    /**deck the last queued track went to, -1 before the first load*/
+    int lastDeck;
+    double lastPosition;
+    bool lastTrackStarted;
+};
+
+int replay(const juce::StringArray& args)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    return EventReplay::render(juce::File{ args[1].unquoted() }, juce::File{ args[2].unquoted() }, formatManager) ? 0 : 1;
+}
+
+int play(const juce::StringArray& args)
+{
+    juce::File dataDirectory{ OtoEngine::getDefaultDataDirectory() };
+    juce::Array<juce::File> files;
+    for (int i = 0; i < args.size(); ++i)
+    {
+        if (args[i] == "--data" && i + 1 < args.size())
+        {
+            dataDirectory = juce::File{ args[++i].unquoted() };
+            continue;
+        }
+        juce::File file{ juce::File::getCurrentWorkingDirectory().getChildFile(args[i].unquoted()) };
+        if (!file.existsAsFile())
+        {
+            std::cerr << "no such file: " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+        files.add(file);
+    }
+    if (files.isEmpty())
+    {
+        std::cerr << "usage: OtoDecksHeadless [--data <folder>] <track> [<track> ...]" << std::endl
+                  << "       OtoDecksHeadless --replay <session.otolog> <output.wav>" << std::endl;
+        return 1;
+    }
+
+    OtoEngine engine{ dataDirectory };
+    engine.openSessionLog();
+
+    // outputs 1/2 carry the master, 3/4 the cue bus if the device has them
+    juce::AudioDeviceManager deviceManager;
+    const juce::String error{ deviceManager.initialiseWithDefaultDevices(0, 4) };
+    if (error.isNotEmpty())
+    {
+        std::cerr << "could not open the audio device: " << error << std::endl;
+        return 1;
+    }
+    juce::AudioSourcePlayer sourcePlayer;
+    sourcePlayer.setSource(&engine);
+    deviceManager.addAudioCallback(&sourcePlayer);
+
+    {
+        Playout playout{ engine, files };
+        juce::MessageManager::getInstance()->runDispatchLoop();
+    }
+
+    deviceManager.removeAudioCallback(&sourcePlayer);
+    sourcePlayer.setSource(nullptr);
+    return 0;
+}
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // the engine's timers and callbacks need a message thread, this one
+    juce::MessageManager::getInstance();
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+    {
+        args.add(juce::CharPointer_UTF8{ argv[i] });
+    }
+    const int result{ args.size() == 3 && args[0] == "--replay" ? replay(args) : play(args) };
+
+    juce::DeletedAtShutdown::deleteAll();
+    juce::MessageManager::deleteInstance();
+    return result;
+}
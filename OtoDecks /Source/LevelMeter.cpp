@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    LevelMeter.cpp
+    Created: 5 May 2024 9:02:31pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "LevelMeter.h"
+
+namespace
+{
+    constexpr float minMeterDecibels{ -60.0f };
+    constexpr float maxMeterDecibels{ 6.0f };
+}
+
+//==============================================================================
+LevelMeter::LevelMeter(TapAnalyser& _analyser,
+                       int _tap
+                       ) : analyser(_analyser),
+                           tap(_tap)
+{
+    setInterceptsMouseClicks(false, false);
+    startTimerHz(30);
+}
+
+LevelMeter::~LevelMeter()
+{
+}
+
+void LevelMeter::paint (juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black);
+    const float height{ (float) getHeight() };
+    const float barWidth{ getWidth() / 2.0f };
+    // green up to -12 dB, amber up to full scale, red above it
+    juce::ColourGradient gradient{ juce::Colours::red, 0.0f, 0.0f, juce::Colours::green, 0.0f, height, false };
+    gradient.addColour(1.0f - getProportion(1.0f), juce::Colours::orange);
+    gradient.addColour(1.0f - getProportion(juce::Decibels::decibelsToGain(-12.0f)), juce::Colours::green);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const float x{ ch * barWidth };
+        const float rmsTop{ height * (1.0f - getProportion(levels.rms[ch])) };
+        const float peakTop{ height * (1.0f - getProportion(levels.peak[ch])) };
+        const float holdTop{ height * (1.0f - getProportion(levels.peakHold[ch])) };
+        g.setGradientFill(gradient);
+        g.fillRect(x + 1.0f, rmsTop, barWidth - 2.0f, height - rmsTop);
+        g.setColour(juce::Colours::white.withAlpha(0.6f));
+        g.fillRect(x + 1.0f, peakTop, barWidth - 2.0f, 1.0f);
+        g.setColour(levels.peakHold[ch] >= 1.0f ? juce::Colours::red : juce::Colours::white);
+        g.fillRect(x + 1.0f, holdTop, barWidth - 2.0f, 2.0f);
+    }
+    // full scale
+    g.setColour(juce::Colours::grey);
+    g.fillRect(0.0f, height * (1.0f - getProportion(1.0f)), (float) getWidth(), 1.0f);
+}
+
+void LevelMeter::timerCallback()
+{
+    TapAnalyser::Levels latest{ analyser.getLevels(tap) };
+    if (latest.peak != levels.peak || latest.rms != levels.rms || latest.peakHold != levels.peakHold)
+    {
+        levels = latest;
+        repaint();
+    }
+}
+
+float LevelMeter::getProportion(float gain)
+{
+    const float decibels{ juce::Decibels::gainToDecibels(gain, minMeterDecibels) };
+    return juce::jmap(decibels, minMeterDecibels, maxMeterDecibels, 0.0f, 1.0f);
+}
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+    Created: 5 May 2024 9:02:31pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TapAnalyser.h"
+
+//==============================================================================
+/*
+    Stereo meter of a deck or the master: the RMS as a bar, the peak as a
+    line above it and the held peak as a marker, on a decibel scale.
+*/
+class LevelMeter  : public juce::Component,
+                    public juce::Timer
+{
+public:
+    /**Shows a deck of the analyser, or TapAnalyser::master*/
+    LevelMeter(TapAnalyser& _analyser, int _tap);
+    ~LevelMeter() override;
+
+    void paint (juce::Graphics&) override;
+    /**Picks up the latest levels from the analyser*/
+    void timerCallback() override;
+
+private:
+    /**Gets the height from the bottom a level is drawn at, as a proportion*/
+    static float getProportion(float gain);
+
+    TapAnalyser& analyser;
+    int tap;
+    TapAnalyser::Levels levels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeter)
+};
@@ -8,6 +8,7 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "Engine/EventReplay.h"
 
 //==============================================================================
 class OtoDecksApplication  : public juce::JUCEApplication
@@ -25,6 +26,19 @@ public:
     {
         // This method is where you should put your application's initialisation code..
 
+        // OtoDecks --replay <session.otolog> <output.wav> renders a logged set and quits
+        juce::StringArray args{ juce::StringArray::fromTokens(commandLine, true) };
+        if (args.size() == 3 && args[0] == "--replay")
+        {
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            bool rendered{ EventReplay::render(juce::File{ args[1].unquoted() },
+                                               juce::File{ args[2].unquoted() }, formatManager) };
+            setApplicationReturnValue(rendered ? 0 : 1);
+            quit();
+            return;
+        }
+
         mainWindow.reset (new MainWindow (getApplicationName()));
     }
 
@@ -12,24 +12,48 @@ MainComponent::MainComponent()
         && ! juce::RuntimePermissions::isGranted (juce::RuntimePermissions::recordAudio))
     {
         juce::RuntimePermissions::request (juce::RuntimePermissions::recordAudio,
-                                           [&] (bool granted) { setAudioChannels (granted ? 2 : 0, 2); });
+                                           [&] (bool granted) { setAudioChannels (granted ? 2 : 0, 4); });
     }
     else
     {
-        // Specify the number of input and output channels that we want to open
-        setAudioChannels (2, 2);
+        // Specify the number of input and output channels that we want to open,
+        // outputs 1/2 carry the master and 3/4 the headphone cue bus
+        setAudioChannels (2, 4);
     }
 
+    // every session is logged so it can be rendered again with --replay
+    engine.openSessionLog();
+    // quantised starts line up with the other deck
+    deckGUI1.setSyncSource(&engine.getDeck(1));
+    deckGUI2.setSyncSource(&engine.getDeck(0));
+
     addAndMakeVisible(deckGUI1);
     addAndMakeVisible(deckGUI2);
     addAndMakeVisible(playlistComponent);
+    addAndMakeVisible(recordButton);
+    recordButton.addListener(this);
+    recordButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::red);
+    addAndMakeVisible(midiButton);
+    midiButton.addListener(this);
+    addAndMakeVisible(latencyButton);
+    latencyButton.addListener(this);
+    addAndMakeVisible(masterMeter);
+    addAndMakeVisible(spectrumDisplay);
+    addAndMakeVisible(samplePadPanel);
+    latencyTester.onFinished = [this](const juce::String& report)
+    {
+        latencyButton.setButtonText("LATENCY");
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Audio Latency", report);
+    };
 
-    formatManager.registerBasicFormats();
+    playlistComponent.startWatchingFolders();
+    midiController.start();
 }
 
 MainComponent::~MainComponent()
 {
     // This shuts down the audio device and clears the audio source.
+    // The engine stops recording and closes the session log itself.
     shutdownAudio();
 }
 
@@ -44,15 +68,18 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
 
     // For more details, see the help for AudioProcessor::prepareToPlay()
 
-    mixerSource.addInputSource(&player1, false);
-    mixerSource.addInputSource(&player2, false);
-    player1.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    player2.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    engine.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    latencyTester.prepare(sampleRate, samplesPerBlockExpected);
 
 }
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    mixerSource.getNextAudioBlock(bufferToFill);
+    // the buffer holds the input until the mixer overwrites it
+    latencyTester.beginBlock(bufferToFill);
+    // mixes the decks and records the master
+    engine.getNextAudioBlock(bufferToFill);
+    // test clicks go out but are never recorded
+    latencyTester.endBlock(bufferToFill);
 }
 
 void MainComponent::releaseResources()
@@ -61,10 +88,7 @@ void MainComponent::releaseResources()
     // restarted due to a setting change.
 
     // For more details, see the help for AudioProcessor::releaseResources()
-    mixerSource.removeAllInputs();
-    mixerSource.releaseResources();
-    player1.releaseResources();
-    player2.releaseResources();
+    engine.releaseResources();
 }
 
 //==============================================================================
@@ -82,7 +106,158 @@ void MainComponent::resized()
     // If you add any child components, this is where you should
     // update their positions.
 
-    playlistComponent.setBounds(0, 0, getWidth() / 4, getHeight());
+    // the sample pads, then the master spectrum and meter sit under the playlist
+    const int analysisHeight{ getHeight() / 6 };
+    const int padsHeight{ getHeight() / 8 };
+    playlistComponent.setBounds(0, 0, getWidth() / 4, getHeight() - 30 - analysisHeight - padsHeight);
+    samplePadPanel.setBounds(0, getHeight() - 30 - analysisHeight - padsHeight, getWidth() / 4, padsHeight);
+    spectrumDisplay.setBounds(0, getHeight() - 30 - analysisHeight, getWidth() / 4 - 16, analysisHeight);
+    masterMeter.setBounds(getWidth() / 4 - 16, getHeight() - 30 - analysisHeight, 16, analysisHeight);
+    recordButton.setBounds(0, getHeight() - 30, getWidth() / 12, 30);
+    midiButton.setBounds(getWidth() / 12, getHeight() - 30, getWidth() / 12, 30);
+    latencyButton.setBounds(2 * getWidth() / 12, getHeight() - 30, getWidth() / 12, 30);
     deckGUI1.setBounds(getWidth() / 4, 0, 3 * getWidth() /4, getHeight() / 2);
     deckGUI2.setBounds(getWidth() / 4, getHeight() / 2, 3* getWidth() /4, getHeight() / 2);
 }
+
+void MainComponent::buttonClicked(juce::Button* button)
+{
+    if (button == &midiButton)
+    {
+        DBG("MIDI Button was clicked ");
+        showMidiMenu();
+    }
+    if (button == &latencyButton)
+    {
+        DBG("Latency Button was clicked ");
+        showLatencyMenu();
+    }
+    if (button == &recordButton)
+    {
+        DBG("Record Button was clicked ");
+        SessionRecorder& recorder{ engine.getRecorder() };
+        if (recorder.isRecording())
+        {
+            recorder.stop();
+            stopTimer();
+            recordButton.setToggleState(false, juce::dontSendNotification);
+            recordButton.setButtonText("REC");
+            if (recorder.getNumOverruns() > 0)
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Recording",
+                    juce::String(recorder.getNumOverruns()) + " blocks were dropped because the disk could not keep up.");
+            }
+            return;
+        }
+
+        juce::File defaultFile{ juce::File::getSpecialLocation(juce::File::userMusicDirectory)
+                                    .getChildFile("OtoDecks Set " + juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M") + ".wav") };
+        juce::FileChooser chooser{ "Record the set to", defaultFile, "*.wav;*.flac" };
+        if (chooser.browseForFileToSave(true) && recorder.start(chooser.getResult()))
+        {
+            recordButton.setToggleState(true, juce::dontSendNotification);
+            startTimer(500);
+        }
+    }
+}
+
+void MainComponent::timerCallback()
+{
+    const SessionRecorder& recorder{ engine.getRecorder() };
+    int seconds{ (int) recorder.getRecordedSeconds() };
+    juce::String text{ "REC " + juce::String(seconds / 3600) + ":" + juce::String((seconds / 60) % 60).paddedLeft('0', 2)
+                       + ":" + juce::String(seconds % 60).paddedLeft('0', 2) };
+    if (recorder.getNumOverruns() > 0)
+    {
+        text << " (" << recorder.getNumOverruns() << " dropped)";
+    }
+    recordButton.setButtonText(text);
+}
+
+void MainComponent::showMidiMenu()
+{
+    using Control = MidiController::Control;
+    constexpr int clearId{ 1000 };
+    constexpr int statsId{ 1001 };
+
+    // item ids encode the deck and control to learn
+    juce::PopupMenu menu;
+    for (int deck = 0; deck < MidiController::numDecks; ++deck)
+    {
+        juce::PopupMenu deckMenu;
+        for (int control = 1; control < (int) Control::numControls; ++control)
+        {
+            deckMenu.addItem(deck * 100 + control, MidiController::getControlName((Control) control));
+        }
+        menu.addSubMenu("Learn Deck " + juce::String(deck + 1), deckMenu);
+    }
+    menu.addSeparator();
+    menu.addItem(statsId, "Latency and Jitter...");
+    menu.addItem(clearId, "Clear Mappings");
+
+    juce::Component::SafePointer<MainComponent> safeThis{ this };
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&midiButton),
+        [safeThis, clearId, statsId](int result)
+        {
+            if (safeThis == nullptr || result == 0)
+            {
+                return;
+            }
+            MidiController& midi{ safeThis->midiController };
+            if (result == clearId)
+            {
+                midi.clearMappings();
+            }
+            else if (result == statsId)
+            {
+                MidiController::Stats stats{ midi.getStats() };
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "MIDI Input",
+                    juce::String(stats.numMessages) + " messages\n"
+                    + "dispatch latency " + juce::String(stats.meanLatency, 2) + " ms average, "
+                    + juce::String(stats.maxLatency, 2) + " ms worst\n"
+                    + "jitter " + juce::String(stats.jitter, 2) + " ms");
+            }
+            else
+            {
+                midi.learn(result / 100, (Control) (result % 100));
+                DBG("MainComponent::showMidiMenu move a control to map it");
+            }
+        });
+}
+
+void MainComponent::showLatencyMenu()
+{
+    constexpr int deviceId{ 1 };
+    constexpr int roundTripId{ 2 };
+    constexpr int blockSizeId{ 3 };
+
+    juce::PopupMenu menu;
+    menu.addItem(deviceId, "Device Info...");
+    menu.addItem(roundTripId, "Measure Round Trip (loop output 1 to input 1)", !latencyTester.isBusy());
+    menu.addItem(blockSizeId, "Find Smallest Block Size (play both decks first)", !latencyTester.isBusy());
+
+    juce::Component::SafePointer<MainComponent> safeThis{ this };
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&latencyButton),
+        [safeThis, deviceId, roundTripId, blockSizeId](int result)
+        {
+            if (safeThis == nullptr || result == 0)
+            {
+                return;
+            }
+            LatencyTester& tester{ safeThis->latencyTester };
+            if (result == deviceId)
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Audio Device", tester.getDeviceReport());
+                return;
+            }
+            safeThis->latencyButton.setButtonText("TESTING...");
+            if (result == roundTripId)
+            {
+                tester.startRoundTrip();
+            }
+            else if (result == blockSizeId)
+            {
+                tester.startBlockSizeSearch();
+            }
+        });
+}
@@ -2,16 +2,25 @@
 
 #include <JuceHeader.h>
 #include <juce_gui_basics/juce_gui_basics.h>
-#include "DJAudioPlayer.h"
+#include "Engine/OtoEngine.h"
+#include "Engine/MidiController.h"
+#include "Engine/LatencyTester.h"
 #include "DeckGUI.h"
 #include "PlaylistComponent.h"
+#include "ThumbnailDiskCache.h"
+#include "TapAnalyser.h"
+#include "LevelMeter.h"
+#include "SpectrumDisplay.h"
+#include "SamplePadPanel.h"
 
 //==============================================================================
 /*
     This component lives inside our window, and this is where you should put all
     your controls and content.
 */
-class MainComponent  : public juce::AudioAppComponent
+class MainComponent  : public juce::AudioAppComponent,
+                       public juce::Button::Listener,
+                       public juce::Timer
 {
 public:
     //==============================================================================
@@ -27,20 +36,40 @@ public:
     void paint (juce::Graphics& g) override;
     void resized() override;
 
+    /**implement Button::Listener*/
+    void buttonClicked(juce::Button* button) override;
+    /**Updates the record button with the length of the recording*/
+    void timerCallback() override;
+
 private:
     //==============================================================================
     // Your private member variables go here...
 
-    juce::AudioFormatManager formatManager;
-    juce::AudioThumbnailCache thumbCache{100};
+    /**the engine feeds the waveforms of the tracks it decodes into the cache*/
+    ThumbnailDiskCache thumbCache{100, WaveformDisplay::samplesPerThumbnailSample,
+                                  OtoEngine::getDefaultDataDirectory().getChildFile("Waveforms")};
+    OtoEngine engine{OtoEngine::getDefaultDataDirectory(), &thumbCache};
+
+    /**turns the mixer taps into levels and a spectrum away from the audio thread*/
+    TapAnalyser tapAnalyser{ engine.getMixer() };
+
+    DeckGUI deckGUI1{1, engine, thumbCache, tapAnalyser};
+    DeckGUI deckGUI2{2, engine, thumbCache, tapAnalyser};
+    PlaylistComponent playlistComponent{ engine };
+
+    juce::TextButton recordButton{ "REC" };
+    MidiController midiController{ &engine.getDeck(0), &engine.getDeck(1), MidiController::getDefaultMappingFile() };
+    juce::TextButton midiButton{ "MIDI" };
+    LatencyTester latencyTester{ deviceManager };
+    juce::TextButton latencyButton{ "LATENCY" };
+    LevelMeter masterMeter{ tapAnalyser, TapAnalyser::master };
+    SpectrumDisplay spectrumDisplay{ tapAnalyser };
+    SamplePadPanel samplePadPanel{ engine.getSamplePads(), engine.getMixer() };
 
-    DJAudioPlayer player1{formatManager};
-    DJAudioPlayer player2{formatManager};
-    DJAudioPlayer playerForParsingMetaData{formatManager};
-    DeckGUI deckGUI1{1, &player1, formatManager, thumbCache};
-    DeckGUI deckGUI2{2, &player2, formatManager, thumbCache};
-    PlaylistComponent playlistComponent{ &deckGUI1, &deckGUI2, &playerForParsingMetaData };
+    /**Shows the MIDI learn and statistics menu*/
+    void showMidiMenu();
+    /**Shows the device report and the latency tests*/
+    void showLatencyMenu();
 
-    juce::MixerAudioSource mixerSource;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
@@ -12,45 +12,86 @@
 #include "PlaylistComponent.h"
 
 //==============================================================================
-PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
-                                     DeckGUI* _deckGUI2,
-                                     DJAudioPlayer* _playerForParsingMetaData
-                                    ) : deckGUI1(_deckGUI1),
-                                        deckGUI2(_deckGUI2),
-                                        playerForParsingMetaData(_playerForParsingMetaData)
+PlaylistComponent::PlaylistComponent(OtoEngine& _engine
+                                    ) : engine(_engine),
+                                        formatManager(_engine.getFormatManager()),
+                                        store(_engine.getLibraryStore()),
+                                        prefetcher(_engine.getPrefetcher()),
+                                        analyser(_engine.getAnalyser()),
+                                        autoDJ(_engine.getAutoDJ()),
+                                        importer(_engine.getFormatManager(), _engine.getAnalyser()),
+                                        scanner(_engine.getFormatManager(),
+                                                [safeThis = juce::Component::SafePointer<PlaylistComponent>(this)](LibraryScanner::Changes changes)
+                                                {
+                                                    if (safeThis != nullptr)
+                                                    {
+                                                        safeThis->applyScanChanges(std::move(changes));
+                                                    }
+                                                })
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
     
     // add components
     addAndMakeVisible(importButton);
+    addAndMakeVisible(watchFolderButton);
     addAndMakeVisible(searchArea);
     addAndMakeVisible(library);
     addAndMakeVisible(loadToDeckGUI1Button);
     addAndMakeVisible(loadToDeckGUI2Button);
+    addAndMakeVisible(queueButton);
+    addAndMakeVisible(autoDJButton);
+    addAndMakeVisible(crossfadeSlider);
+    addChildComponent(importProgressBar);
+    addChildComponent(cancelImportButton);
 
     // attach listeners
     importButton.addListener(this);
+    watchFolderButton.addListener(this);
     searchArea.addListener(this);
     loadToDeckGUI1Button.addListener(this);
     loadToDeckGUI2Button.addListener(this);
+    cancelImportButton.addListener(this);
+    queueButton.addListener(this);
+    autoDJButton.addListener(this);
+    
+    // auto DJ configuration, the slider sets the crossfade length
+    autoDJButton.setClickingTogglesState(true);
+    crossfadeSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    crossfadeSlider.setRange(1.0, 30.0, 0.5);
+    crossfadeSlider.setValue(AutoDJ::defaultCrossfadeSeconds, juce::dontSendNotification);
+    crossfadeSlider.setTextValueSuffix(" s fade");
+    crossfadeSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 70, 20);
+    crossfadeSlider.onValueChange = [this] { autoDJ.setCrossfadeSeconds(crossfadeSlider.getValue()); };
+    autoDJ.setSource(this);
+    engine.addListener(this);
     
     // searchAreaconfiguration
     searchArea.setTextToShowWhenEmpty("Search Tracks Titles Here:",
                                        juce::Colours::orange);
     searchArea.onReturnKey = [this] { searchLibrary (searchArea.getText()); };
     
-    // setup table and load library from file
-    library.getHeader().addColumn("Track Titles", 1, 1);
-    library.getHeader().addColumn("Duration", 2, 1);
-    library.getHeader().addColumn("Remove", 3, 1);
+    // setup table and load library from the store
+    library.getHeader().addColumn("Track Titles", titleColumn, 1);
+    library.getHeader().addColumn("Duration", durationColumn, 1);
+    library.getHeader().addColumn("Remove", removeColumn, 1, 30, -1,
+                                  juce::TableHeaderComponent::notSortable);
+    library.getHeader().addColumn("BPM", bpmColumn, 1);
+    library.getHeader().addColumn("Key", keyColumn, 1);
+    library.getHeader().addColumn("Bitrate", bitrateColumn, 1);
+    library.getHeader().addColumn("Sample Rate", sampleRateColumn, 1);
+    library.getHeader().addColumn("Date Added", dateAddedColumn, 1);
+    library.getHeader().addColumn("Plays", playCountColumn, 1);
     library.setModel(this);
     loadLibrary();
 }
 
 PlaylistComponent::~PlaylistComponent()
 {
-    saveLibrary();
+    autoDJ.setSource(nullptr);
+    engine.removeListener(this);
+    // the library is already in the store, only the folders are saved here
+    saveWatchedFolders();
 }
 
 void PlaylistComponent::paint (juce::Graphics& g)
@@ -78,21 +119,33 @@ void PlaylistComponent::resized()
     // components that your component contains..
 
     //                   x start, y start, width, height
-    importButton.setBounds(0, 0, getWidth(), getHeight() / 16);
+    importButton.setBounds(0, 0, getWidth() / 2, getHeight() / 16);
+    importProgressBar.setBounds(0, 0, 3 * getWidth() / 8, getHeight() / 16);
+    cancelImportButton.setBounds(3 * getWidth() / 8, 0, getWidth() / 8, getHeight() / 16);
+    watchFolderButton.setBounds(getWidth() / 2, 0, getWidth() / 2, getHeight() / 16);
     searchArea.setBounds(0, getHeight() / 16, getWidth(), getHeight() / 16);
     library.setBounds(0, 2 * getHeight() / 16, getWidth(), 12 * getHeight() / 16);
-    loadToDeckGUI1Button.setBounds(0, 14 * getHeight() / 16, getWidth(), getHeight() / 16);
-    loadToDeckGUI2Button.setBounds(0, 15 * getHeight() / 16, getWidth(), getHeight() / 16);
-
-    //set columns
-    library.getHeader().setColumnWidth(1, 3 * getWidth() / 5);
-    library.getHeader().setColumnWidth(2, 1 * getWidth() / 5);
-    library.getHeader().setColumnWidth(3, 1 * getWidth() / 5);
+    loadToDeckGUI1Button.setBounds(0, 14 * getHeight() / 16, getWidth() / 2, getHeight() / 16);
+    loadToDeckGUI2Button.setBounds(getWidth() / 2, 14 * getHeight() / 16, getWidth() / 2, getHeight() / 16);
+    queueButton.setBounds(0, 15 * getHeight() / 16, getWidth() / 3, getHeight() / 16);
+    autoDJButton.setBounds(getWidth() / 3, 15 * getHeight() / 16, getWidth() / 3, getHeight() / 16);
+    crossfadeSlider.setBounds(2 * getWidth() / 3, 15 * getHeight() / 16, getWidth() / 3, getHeight() / 16);
+
+    //set columns, the metadata columns are reached by scrolling right
+    library.getHeader().setColumnWidth(titleColumn, 3 * getWidth() / 5);
+    library.getHeader().setColumnWidth(durationColumn, 1 * getWidth() / 5);
+    library.getHeader().setColumnWidth(removeColumn, 1 * getWidth() / 5);
+    library.getHeader().setColumnWidth(bpmColumn, 60);
+    library.getHeader().setColumnWidth(keyColumn, 50);
+    library.getHeader().setColumnWidth(bitrateColumn, 80);
+    library.getHeader().setColumnWidth(sampleRateColumn, 90);
+    library.getHeader().setColumnWidth(dateAddedColumn, 90);
+    library.getHeader().setColumnWidth(playCountColumn, 50);
 }
 
 int PlaylistComponent::getNumRows()
 {
-    return tracks.size();
+    return (int) rows.size();
 }
 
 void PlaylistComponent::paintRowBackground(juce::Graphics& g,
@@ -122,49 +175,130 @@ void PlaylistComponent::paintCell(juce::Graphics& g,
 {
     if (rowNumber < getNumRows())
     {
-        if (columnId == 1)
+        TrackId id{ rows[rowNumber] };
+        if (columnId == removeColumn)
         {
-            g.drawText(tracks[rowNumber].title,
+            // drawn rather than a TextButton per row so scrolling stays cheap
+            g.setColour(juce::Colours::darkred);
+            g.drawText("X",
                 2,
                 0,
                 width - 4,
                 height,
-                juce::Justification::centredLeft,
+                juce::Justification::centred,
                 true
             );
         }
-        if (columnId == 2)
+        else
         {
-            g.drawText(tracks[rowNumber].duration,
+            g.drawText(getCellText(id, columnId),
                 2,
                 0,
                 width - 4,
                 height,
-                juce::Justification::centred,
+                columnId == titleColumn ? juce::Justification::centredLeft
+                                        : juce::Justification::centred,
                 true
             );
         }
     }
 }
 
-juce::Component* PlaylistComponent::refreshComponentForCell(int rowNumber,
-                                                      int columnId,
-                                                      bool isRowSelected,
-                                                      Component* existingComponentToUpdate)
+juce::String PlaylistComponent::getCellText(TrackId id, int columnId)
+{
+    switch (columnId)
+    {
+        case titleColumn:
+            return trackLibrary.getTitle(id);
+        case durationColumn:
+            return secondsToMinutes(trackLibrary.getDuration(id));
+        case bpmColumn:
+            return trackLibrary.getBpm(id) > 0 ? juce::String(trackLibrary.getBpm(id), 1) : juce::String();
+        case keyColumn:
+            return Track::keyToString(trackLibrary.getKey(id));
+        case bitrateColumn:
+            return trackLibrary.getBitrate(id) > 0 ? juce::String(trackLibrary.getBitrate(id)) + " kbps" : juce::String();
+        case sampleRateColumn:
+            return trackLibrary.getSampleRate(id) > 0 ? juce::String(trackLibrary.getSampleRate(id) / 1000.0, 1) + " kHz" : juce::String();
+        case dateAddedColumn:
+            return trackLibrary.getDateAdded(id) > 0 ? juce::Time(trackLibrary.getDateAdded(id)).formatted("%Y-%m-%d") : juce::String();
+        case playCountColumn:
+            return juce::String(trackLibrary.getPlayCount(id));
+        default:
+            return {};
+    }
+}
+
+void PlaylistComponent::cellClicked(int rowNumber,
+                                    int columnId,
+                                    const juce::MouseEvent& event)
 {
-    if (columnId == 3)
+    if (columnId == removeColumn && rowNumber < getNumRows())
     {
-        if (existingComponentToUpdate == nullptr)
+        DBG(trackLibrary.getTitle(rows[rowNumber]) + " has been removed from the library");
+        deleteFromTracks(rowNumber);
+        library.updateContent();
+        library.repaint();
+    }
+}
+
+void PlaylistComponent::sortOrderChanged(int newSortColumnId, bool isForwards)
+{
+    static const std::map<int, TrackLibrary::Column> columnsById{
+        { titleColumn, TrackLibrary::Column::title },
+        { durationColumn, TrackLibrary::Column::duration },
+        { bpmColumn, TrackLibrary::Column::bpm },
+        { keyColumn, TrackLibrary::Column::key },
+        { bitrateColumn, TrackLibrary::Column::bitrate },
+        { sampleRateColumn, TrackLibrary::Column::sampleRate },
+        { dateAddedColumn, TrackLibrary::Column::dateAdded },
+        { playCountColumn, TrackLibrary::Column::playCount }
+    };
+
+    auto it = columnsById.find(newSortColumnId);
+    if (it == columnsById.end())
+    {
+        sortKeys.clear();
+    }
+    else
+    {
+        // previous keys stay on as secondary keys
+        TrackLibrary::Column column{ it->second };
+        sortKeys.erase(std::remove_if(sortKeys.begin(), sortKeys.end(),
+            [column](const LibrarySorter::SortKey& key) {return key.column == column; }),
+            sortKeys.end());
+        sortKeys.insert(sortKeys.begin(), LibrarySorter::SortKey{ column, isForwards });
+        if (sortKeys.size() > LibrarySorter::maxSortKeys)
         {
-            juce::TextButton* btn = new juce::TextButton{ "X" };
-            juce::String id{ std::to_string(rowNumber) };
-            btn->setComponentID(id);
-            
-            btn->addListener(this);
-            existingComponentToUpdate = btn;
+            sortKeys.resize(LibrarySorter::maxSortKeys);
         }
     }
-    return existingComponentToUpdate;
+    updateView();
+}
+
+void PlaylistComponent::updateView()
+{
+    juce::Component::SafePointer<PlaylistComponent> safeThis{ this };
+    sorter.requestView(trackLibrary.createSnapshot(), sortKeys, filter,
+        [safeThis](std::vector<TrackId> view)
+        {
+            if (safeThis == nullptr)
+            {
+                return;
+            }
+            // drop tracks removed while the view was being built
+            PlaylistComponent& self{ *safeThis };
+            view.erase(std::remove_if(view.begin(), view.end(),
+                [&self](TrackId id) {return !self.trackLibrary.contains(id); }),
+                view.end());
+            self.rows.swap(view);
+            self.library.updateContent();
+            self.library.repaint();
+            if (self.pendingSearchText.isNotEmpty())
+            {
+                self.selectTitle(self.pendingSearchText);
+            }
+        });
 }
 
 void PlaylistComponent::buttonClicked(juce::Button* button)
@@ -173,34 +307,45 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
     {
         DBG("Load Track button clicked");
         importToLibrary();
-        library.updateContent();
+    }
+    else if (button == &cancelImportButton)
+    {
+        DBG("Cancel Import button clicked");
+        importer.cancel();
+    }
+    else if (button == &watchFolderButton)
+    {
+        DBG("Watch Folder button clicked");
+        watchFolder();
     }
     else if (button == &loadToDeckGUI1Button)
     {
         DBG("Load to DeckGUI1 clicked");
-        loadInPlayer(deckGUI1);
+        loadInPlayer(0);
     }
     else if (button == &loadToDeckGUI2Button)
     {
         DBG("Load to DeckGUI2 clicked");
-        loadInPlayer(deckGUI2);
+        loadInPlayer(1);
     }
-    else
+    else if (button == &queueButton)
     {
-        int id = std::stoi(button->getComponentID().toStdString());
-        DBG(tracks[id].title + " has been removed from the library");
-        deleteFromTracks(id);
-        library.updateContent();
+        DBG("Queue for Auto DJ clicked");
+        queueSelectedTrack();
+    }
+    else if (button == &autoDJButton)
+    {
+        DBG("Auto DJ clicked");
+        autoDJ.setEnabled(autoDJButton.getToggleState());
     }
 }
 
-void PlaylistComponent::loadInPlayer(DeckGUI* deckGUI)
+void PlaylistComponent::loadInPlayer(int deck)
 {
     int selectedRow{ library.getSelectedRow() };
-    if (selectedRow != -1)
+    if (selectedRow != -1 && selectedRow < getNumRows())
     {
-        DBG("Loading Track Title: " << tracks[selectedRow].title << " to Player");
-        deckGUI->loadFile(tracks[selectedRow].URL);
+        loadTrack(rows[selectedRow], deck);
     }
     else
     {
@@ -213,41 +358,318 @@ void PlaylistComponent::loadInPlayer(DeckGUI* deckGUI)
     }
 }
 
+void PlaylistComponent::loadTrack(TrackId id, int deck)
+{
+    DBG("Loading Track Title: " << trackLibrary.getTitle(id) << " to Player");
+    // a track without a fingerprint is hashed by the engine, see trackFingerprinted
+    engine.loadTrack(deck, trackLibrary.getURL(id), trackLibrary.getFingerprint(id));
+    trackLibrary.incrementPlayCount(id);
+    storeTrack(id);
+    store.recordPlay(id, deck + 1);
+    auto row = std::find(rows.begin(), rows.end(), id);
+    if (row != rows.end())
+    {
+        library.repaintRow((int) std::distance(rows.begin(), row));
+    }
+    findCompatibleTracks(id);
+    prefetchLikelyTracks();
+}
+
+void PlaylistComponent::trackFingerprinted(int deck, const juce::URL& audioURL, juce::uint64 fingerprint)
+{
+    TrackId id{ trackLibrary.findByPath(audioURL.getLocalFile().getFullPathName()) };
+    if (id == TrackLibrary::invalidId || trackLibrary.getFingerprint(id) != 0)
+    {
+        return;
+    }
+    trackLibrary.setFingerprint(id, fingerprint);
+    storeTrack(id);
+}
+
+void PlaylistComponent::queueSelectedTrack()
+{
+    int selectedRow{ library.getSelectedRow() };
+    if (!juce::isPositiveAndBelow(selectedRow, getNumRows()))
+    {
+        DBG("PlaylistComponent::queueSelectedTrack no track is selected");
+        return;
+    }
+    autoDJQueue.push_back(rows[selectedRow]);
+    updateAutoDJButton();
+    prefetchLikelyTracks();
+}
+
+bool PlaylistComponent::loadNextTrack(int deck)
+{
+    // tracks removed from the library since they were queued are skipped
+    while (!autoDJQueue.empty() && !trackLibrary.contains(autoDJQueue.front()))
+    {
+        autoDJQueue.pop_front();
+    }
+    if (autoDJQueue.empty())
+    {
+        return false;
+    }
+    TrackId id{ autoDJQueue.front() };
+    autoDJQueue.pop_front();
+    updateAutoDJButton();
+    loadTrack(id, deck);
+    return true;
+}
+
+void PlaylistComponent::updateAutoDJButton()
+{
+    autoDJButton.setButtonText(autoDJQueue.empty() ? juce::String{ "AUTO DJ" }
+                                                   : "AUTO DJ (" + juce::String((int) autoDJQueue.size()) + ")");
+}
+
+void PlaylistComponent::selectedRowsChanged(int lastRowSelected)
+{
+    prefetchLikelyTracks();
+}
+
+void PlaylistComponent::findCompatibleTracks(TrackId id)
+{
+    // half and double time mix as well as the same tempo
+    auto tempoDistance = [](float bpm, float other)
+    {
+        if (bpm <= 0 || other <= 0)
+        {
+            return std::numeric_limits<float>::max();
+        }
+        float ratio{ other / bpm };
+        return juce::jmin(std::abs(ratio - 1.0f), std::abs(ratio * 2.0f - 1.0f), std::abs(ratio * 0.5f - 1.0f));
+    };
+
+    std::vector<std::pair<float, TrackId>> compatible;
+    float bpm{ trackLibrary.getBpm(id) };
+    int key{ trackLibrary.getKey(id) };
+    for (int i = 0; i < trackLibrary.getNumTracks(); ++i)
+    {
+        TrackId other{ trackLibrary.getIdAt(i) };
+        float distance{ tempoDistance(bpm, trackLibrary.getBpm(other)) };
+        if (other != id && distance <= maxTempoDistance && Track::keysAreCompatible(key, trackLibrary.getKey(other)))
+        {
+            compatible.emplace_back(distance, other);
+        }
+    }
+    int numCompatible{ juce::jmin(prefetchCompatible, (int) compatible.size()) };
+    std::partial_sort(compatible.begin(), compatible.begin() + numCompatible, compatible.end());
+
+    compatibleTracks.clear();
+    for (int i = 0; i < numCompatible; ++i)
+    {
+        compatibleTracks.push_back(compatible[i].second);
+    }
+}
+
+void PlaylistComponent::prefetchLikelyTracks()
+{
+    std::vector<TrackPrefetcher::Candidate> candidates;
+    auto addCandidate = [this, &candidates](TrackId id)
+    {
+        if (!trackLibrary.contains(id))
+        {
+            return;
+        }
+        // tracks without a fingerprint yet are not worth hashing just for a guess
+        juce::uint64 fingerprint{ trackLibrary.getFingerprint(id) };
+        bool added{ std::any_of(candidates.begin(), candidates.end(),
+            [fingerprint](const TrackPrefetcher::Candidate& c) {return c.fingerprint == fingerprint; }) };
+        if (fingerprint != 0 && !added)
+        {
+            candidates.push_back({ fingerprint, trackLibrary.getFile(id) });
+        }
+    };
+
+    // the auto DJ plays the front of its queue next for sure
+    if (!autoDJQueue.empty())
+    {
+        addCandidate(autoDJQueue.front());
+    }
+    // the selected row is the most likely load, then the rows around it
+    int selectedRow{ library.getSelectedRow() };
+    if (juce::isPositiveAndBelow(selectedRow, (int) rows.size()))
+    {
+        addCandidate(rows[selectedRow]);
+        for (int distance = 1; distance <= prefetchNeighbours; ++distance)
+        {
+            if (selectedRow + distance < (int) rows.size())
+            {
+                addCandidate(rows[selectedRow + distance]);
+            }
+            if (selectedRow - distance >= 0)
+            {
+                addCandidate(rows[selectedRow - distance]);
+            }
+        }
+    }
+    // then whatever mixes well with the track loaded last
+    for (TrackId id : compatibleTracks)
+    {
+        addCandidate(id);
+    }
+    prefetcher.setCandidates(std::move(candidates));
+}
+
 void PlaylistComponent::importToLibrary()
 {
     DBG("PlaylistComponent::importToLibrary called");
 
+    if (importer.isRunning())
+    {
+        DBG("PlaylistComponent::importToLibrary an import is already running");
+        return;
+    }
+
     //initialize file chooser
     juce::FileChooser chooser{ "Select files" };
     if (chooser.browseForMultipleFilesToOpen())
     {
-        for (const juce::File& file : chooser.getResults())
+        // the importer hashes, reads and analyses every file on all cores
+        std::unordered_set<juce::uint64> known;
+        for (int i = 0; i < trackLibrary.getNumTracks(); ++i)
         {
-            juce::String fileNameWithoutExtension{ file.getFileNameWithoutExtension() };
-            if (!isInTracks(fileNameWithoutExtension)) // if not already loaded
-            {
-                Track newTrack{ file };
-                juce::URL audioURL{ file };
-                newTrack.duration = getLength(audioURL) ;
-                tracks.push_back(newTrack);
-                DBG("loaded file: " << newTrack.title);
-            }
-            else // display info message
-            {
-                juce::AlertWindow::showMessageBox(juce::AlertWindow::AlertIconType::InfoIcon,
-                    "Adding Tracks information:",
-                    fileNameWithoutExtension + " had been added to the library",
-                    "OKAY",
-                    nullptr
-                );
-            }
+            known.insert(trackLibrary.getFingerprint(trackLibrary.getIdAt(i)));
+        }
+        importDuplicates.clear();
+        importUnreadable.clear();
+        numImported = 0;
+        importProgress = 0;
+        importer.start(chooser.getResults(), std::move(known));
+
+        importButton.setVisible(false);
+        importProgressBar.setVisible(true);
+        cancelImportButton.setVisible(true);
+        startTimer(100);
+    }
+}
+
+void PlaylistComponent::timerCallback()
+{
+    importProgress = importer.getProgress();
+    const bool finished{ !importer.isRunning() };
+    applyImportResults();
+    if (finished)
+    {
+        stopTimer();
+        importProgressBar.setVisible(false);
+        cancelImportButton.setVisible(false);
+        importButton.setVisible(true);
+        showImportSummary();
+    }
+}
+
+void PlaylistComponent::applyImportResults()
+{
+    std::vector<LibraryImporter::Result> results{ importer.takeResults() };
+    if (results.empty())
+    {
+        return;
+    }
+
+    for (LibraryImporter::Result& result : results)
+    {
+        const Track& track{ result.track };
+        if (result.outcome == LibraryImporter::Outcome::added)
+        {
+            addToLibrary(track);
+            ++numImported;
+            DBG("loaded file: " << track.title);
+            continue;
+        }
+        if (result.outcome == LibraryImporter::Outcome::unreadable)
+        {
+            importUnreadable.add(track.file.getFileNameWithoutExtension());
+            continue;
+        }
+
+        TrackId existing{ trackLibrary.findByFingerprint(track.fingerprint) };
+        if (existing != TrackLibrary::invalidId && !trackLibrary.getFile(existing).existsAsFile())
+        {
+            // same audio at a new place, keep its history and caches
+            DBG("relocated " << trackLibrary.getTitle(existing) << " to " << track.file.getFullPathName());
+            trackLibrary.relocateTrack(existing, track.file);
+            storeTrack(existing);
+        }
+        else
+        {
+            importDuplicates.add(track.file.getFileNameWithoutExtension());
+        }
+    }
+
+    if (!sortKeys.empty() || !filter.isEmpty())
+    {
+        updateView();
+    }
+    library.updateContent();
+}
+
+void PlaylistComponent::showImportSummary()
+{
+    if (importDuplicates.isEmpty() && importUnreadable.isEmpty() && !importer.wasCancelled())
+    {
+        return;
+    }
+
+    // a few names are enough, a whole folder of duplicates would not fit
+    constexpr int maxNamesListed{ 10 };
+    auto listNames = [](const juce::StringArray& names)
+    {
+        juce::String list;
+        for (int i = 0; i < juce::jmin(names.size(), maxNamesListed); ++i)
+        {
+            list << "\n    " << names[i];
+        }
+        if (names.size() > maxNamesListed)
+        {
+            list << "\n    and " << names.size() - maxNamesListed << " more";
         }
+        return list;
+    };
+
+    juce::String message;
+    message << numImported << " of " << importer.getNumFiles() << " tracks added to the library";
+    if (importer.wasCancelled())
+    {
+        message << ", the import was cancelled";
+    }
+    if (!importDuplicates.isEmpty())
+    {
+        message << "\n\n" << importDuplicates.size() << " had already been added:" << listNames(importDuplicates);
+    }
+    if (!importUnreadable.isEmpty())
+    {
+        message << "\n\n" << importUnreadable.size() << " could not be read:" << listNames(importUnreadable);
     }
+    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::AlertIconType::InfoIcon,
+        "Adding Tracks information:",
+        message,
+        "OKAY"
+    );
 }
 
 void PlaylistComponent::searchLibrary(juce::String searchText)
 {
     DBG("Searching library for: " << searchText);
+
+    // column filters narrow the view, the rest of the text selects a title
+    juce::String titleText;
+    TrackFilter newFilter{ TrackFilter::parse(searchText, titleText) };
+    if (!newFilter.isEmpty() || !filter.isEmpty())
+    {
+        filter = newFilter;
+        pendingSearchText = titleText;
+        updateView();
+    }
+    else
+    {
+        selectTitle(titleText);
+    }
+}
+
+void PlaylistComponent::selectTitle(juce::String searchText)
+{
     if (searchText != "")
     {
         int rowNumber = whereInTracks(searchText);
@@ -261,35 +683,137 @@ void PlaylistComponent::searchLibrary(juce::String searchText)
 
 int PlaylistComponent::whereInTracks(juce::String searchText)
 {
-    // finds index where track title contains searchText
-    auto it = find_if(tracks.begin(), tracks.end(),
-        [&searchText](const Track& obj) {return obj.title.contains(searchText); });
+    // finds row where track title contains searchText
+    auto it = find_if(rows.begin(), rows.end(),
+        [this, &searchText](TrackId id) {return trackLibrary.getTitle(id).contains(searchText); });
     int i = -1;
 
-    if (it != tracks.end())
+    if (it != rows.end())
     {
-        i = std::distance(tracks.begin(), it);
+        i = std::distance(rows.begin(), it);
     }
 
     return i;
 }
 
-bool PlaylistComponent::isInTracks(juce::String fileNameWithoutExtension)
+void PlaylistComponent::addToLibrary(const Track& track)
+{
+    TrackId id{ trackLibrary.addTrack(track) };
+    rows.push_back(id);
+    store.putTrack(id, track);
+    if (track.fingerprint != 0)
+    {
+        analyser.request(track.fingerprint, track.file, false);
+    }
+}
+
+void PlaylistComponent::storeTrack(TrackId id)
+{
+    store.putTrack(id, trackLibrary.getTrack(id));
+}
+
+void PlaylistComponent::deleteFromTracks(int rowNumber)
+{
+    trackLibrary.removeTrack(rows[rowNumber]);
+    store.removeTrack(rows[rowNumber]);
+    rows.erase(rows.begin() + rowNumber);
+}
+
+void PlaylistComponent::watchFolder()
 {
-    return (std::find(tracks.begin(), tracks.end(), fileNameWithoutExtension) != tracks.end());
+    juce::FileChooser chooser{ "Select a folder to watch" };
+    if (chooser.browseForDirectory())
+    {
+        scanner.addRoot(chooser.getResult());
+    }
 }
 
-void PlaylistComponent::deleteFromTracks(int id)
+void PlaylistComponent::startWatchingFolders()
 {
-    tracks.erase(tracks.begin() + id);
+    // files already in the library are not probed again unless they changed
+    TrackLibrary::Columns columns{ trackLibrary.createSnapshot() };
+    std::unordered_map<juce::String, LibraryScanner::FileStamp> knownFiles;
+    knownFiles.reserve(columns.ids.size());
+    for (size_t i = 0; i < columns.ids.size(); ++i)
+    {
+        // tracks saved before fingerprints existed are probed once more
+        knownFiles[columns.getPath(i)] = columns.fingerprints[i] != 0
+                                     ? LibraryScanner::FileStamp{ columns.fileSizes[i], columns.modificationTimes[i] }
+                                     : LibraryScanner::FileStamp{ -1, -1 };
+    }
+    scanner.setKnownFiles(std::move(knownFiles));
+
+    juce::StringArray folders;
+    folders.addLines(juce::File::getCurrentWorkingDirectory().getChildFile(watchedFoldersFile).loadFileAsString());
+    for (const juce::String& folder : folders)
+    {
+        if (folder.isNotEmpty())
+        {
+            scanner.addRoot(juce::File{ folder });
+        }
+    }
+}
+
+void PlaylistComponent::applyScanChanges(LibraryScanner::Changes changes)
+{
+    // additions go first so a move shows up as a relocation, not a removal
+    for (const Track& track : changes.added)
+    {
+        if (trackLibrary.findByPath(track.file.getFullPathName()) != TrackLibrary::invalidId)
+        {
+            continue;
+        }
+        TrackId existing{ trackLibrary.findByFingerprint(track.fingerprint) };
+        if (existing == TrackLibrary::invalidId)
+        {
+            addToLibrary(track);
+        }
+        else if (!trackLibrary.getFile(existing).existsAsFile())
+        {
+            trackLibrary.relocateTrack(existing, track.file);
+            storeTrack(existing);
+        }
+    }
+    for (const Track& track : changes.modified)
+    {
+        TrackId id{ trackLibrary.findByPath(track.file.getFullPathName()) };
+        if (id != TrackLibrary::invalidId)
+        {
+            trackLibrary.updateTrack(id, track);
+            storeTrack(id);
+        }
+    }
+    if (!changes.removed.isEmpty())
+    {
+        for (const juce::String& path : changes.removed)
+        {
+            TrackId id{ trackLibrary.findByPath(path) };
+            if (trackLibrary.removeTrack(id))
+            {
+                store.removeTrack(id);
+            }
+        }
+        rows.erase(std::remove_if(rows.begin(), rows.end(),
+            [this](TrackId id) {return !trackLibrary.contains(id); }),
+            rows.end());
+    }
+
+    library.updateContent();
+    library.repaint();
+    if (!sortKeys.empty() || !filter.isEmpty())
+    {
+        updateView();
+    }
 }
 
-juce::String PlaylistComponent::getLength(juce::URL audioURL)
+void PlaylistComponent::saveWatchedFolders()
 {
-    playerForParsingMetaData->loadURL(audioURL);
-    double seconds{ playerForParsingMetaData->getLengthInSeconds() };
-    juce::String minutes{ secondsToMinutes(seconds) };
-    return minutes;
+    juce::StringArray folders;
+    for (const juce::File& folder : scanner.getRoots())
+    {
+        folders.add(folder.getFullPathName());
+    }
+    juce::File::getCurrentWorkingDirectory().getChildFile(watchedFoldersFile).replaceWithText(folders.joinIntoString("\n"));
 }
 
 juce::String PlaylistComponent::secondsToMinutes(double seconds)
@@ -307,36 +831,89 @@ juce::String PlaylistComponent::secondsToMinutes(double seconds)
     return juce::String{ min + ":" + sec };
 }
 
-void PlaylistComponent::saveLibrary()
+void PlaylistComponent::loadLibrary()
 {
-    // create .csv to save library
-    std::ofstream myLibrary("my-library.csv");
+    if (store.isNew())
+    {
+        // first start with the store, bring the old csv library over once
+        importLegacyLibrary();
+        return;
+    }
 
-    // save library to file
-    for (Track& t : tracks)
+    // the saved ids are kept so the play history still points at its tracks
+    trackLibrary.assign(store.getTracks());
+    rows.reserve(trackLibrary.getNumTracks());
+    for (int i = 0; i < trackLibrary.getNumTracks(); ++i)
     {
-        myLibrary << t.file.getFullPathName() << "," << t.duration << "\n";
+        rows.push_back(trackLibrary.getIdAt(i));
     }
+    library.updateContent();
 }
 
-void PlaylistComponent::loadLibrary()
+void PlaylistComponent::importLegacyLibrary()
 {
     // create input stream from saved library
-    std::ifstream myLibrary("my-library.csv");
-    std::string filePath;
-    std::string duration;
+    std::ifstream myLibrary(legacyLibraryFile);
+    std::string line;
+    int numMetadataFields{ 0 };
 
     // Read data, line by line
     if (myLibrary.is_open())
     {
-        while (getline(myLibrary, filePath, ',')) {
-            juce::File file{ filePath };
-            Track newTrack{ file };
+        while (getline(myLibrary, line)) {
+            juce::String text{ juce::String(line).trimEnd() };
+            if (text.startsWith("#otodecks-library"))
+            {
+                // version 2 had no file stamp, version 3 no fingerprint
+                int version{ text.fromLastOccurrenceOf(" ", false, false).getIntValue() };
+                numMetadataFields = version == 2 ? 7 : (version == 3 ? 9 : 10);
+                continue;
+            }
+            if (!text.containsChar(','))
+            {
+                continue;
+            }
 
-            getline(myLibrary, duration);
-            newTrack.duration = duration;
-            tracks.push_back(newTrack);
+            if (numMetadataFields > 0)
+            {
+                // metadata is read from the right so paths may contain commas
+                juce::StringArray fields;
+                fields.addTokens(text, ",", "");
+                if (fields.size() <= numMetadataFields)
+                {
+                    continue;
+                }
+                int first{ fields.size() - numMetadataFields };
+                Track newTrack{ juce::File{ fields.joinIntoString(",", 0, first) } };
+                newTrack.duration = fields[first].getDoubleValue();
+                newTrack.bpm = fields[first + 1].getFloatValue();
+                newTrack.key = fields[first + 2].getIntValue();
+                newTrack.bitrate = fields[first + 3].getIntValue();
+                newTrack.sampleRate = fields[first + 4].getIntValue();
+                newTrack.dateAdded = fields[first + 5].getLargeIntValue();
+                newTrack.playCount = fields[first + 6].getIntValue();
+                if (numMetadataFields > 7)
+                {
+                    newTrack.fileSize = fields[first + 7].getLargeIntValue();
+                    newTrack.modificationTime = fields[first + 8].getLargeIntValue();
+                }
+                if (numMetadataFields > 9)
+                {
+                    newTrack.fingerprint = TrackFingerprint::fromString(fields[first + 9]);
+                }
+                addToLibrary(newTrack);
+            }
+            else
+            {
+                // older libraries only stored "path,m:ss"
+                Track newTrack{ juce::File{ text.upToLastOccurrenceOf(",", false, false) } };
+                juce::String duration{ text.fromLastOccurrenceOf(",", false, false) };
+                newTrack.duration = duration.upToFirstOccurrenceOf(":", false, false).getIntValue() * 60
+                                  + duration.fromFirstOccurrenceOf(":", false, false).getIntValue();
+                addToLibrary(newTrack);
+            }
         }
     }
     myLibrary.close();
+    library.updateContent();
 }
@@ -14,9 +14,15 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
-#include "Track.h"
-#include "DeckGUI.h"
-#include "DJAudioPlayer.h"
+#include <map>
+#include <deque>
+#include "Engine/OtoEngine.h"
+#include "Engine/Track.h"
+#include "Engine/TrackLibrary.h"
+#include "Engine/LibrarySorter.h"
+#include "Engine/LibraryScanner.h"
+#include "Engine/TrackFingerprint.h"
+#include "Engine/LibraryImporter.h"
 
 //==============================================================================
 /*
@@ -24,13 +30,13 @@
 class PlaylistComponent  : public juce::Component,
                            public juce::TableListBoxModel,
                            public juce::Button::Listener,
-                           public juce::TextEditor::Listener
+                           public juce::TextEditor::Listener,
+                           public juce::Timer,
+                           public AutoDJ::Source,
+                           public OtoEngine::Listener
 {
 public:
-    PlaylistComponent(DeckGUI* _deckGUI1,
-                      DeckGUI* _deckGUI2,
-                      DJAudioPlayer* _playerForParsingMetaData
-                     );
+    PlaylistComponent(OtoEngine& _engine);
     ~PlaylistComponent() override;
 
     void paint (juce::Graphics&) override;
@@ -50,36 +56,124 @@ public:
                    int height,
                    bool rowIsSelected
                   ) override;
-    
-    Component* refreshComponentForCell(int rowNumber,
-                                       int columnId,
-                                       bool isRowSelected,
-                                       Component* existingComponentToUpdate) override;
+    /**Removes the track when its cell in the Remove column is clicked*/
+    void cellClicked(int rowNumber,
+                     int columnId,
+                     const juce::MouseEvent& event) override;
+    /**Prefetches the tracks around the new selection*/
+    void selectedRowsChanged(int lastRowSelected) override;
+    /**Makes the clicked column the primary sort key, keeping earlier keys as tie breaks*/
+    void sortOrderChanged(int newSortColumnId, bool isForwards) override;
     void buttonClicked(juce::Button* button) override;
+    /**Adds the tracks the importer has finished and shows the summary once it is done*/
+    void timerCallback() override;
+    /**Starts watching the saved folders, call once the audio formats are registered*/
+    void startWatchingFolders();
+    /**Loads the front of the auto DJ queue onto a deck*/
+    bool loadNextTrack(int deck) override;
+    /**Stores the fingerprint of a library track that was loaded without one*/
+    void trackFingerprinted(int deck, const juce::URL& audioURL, juce::uint64 fingerprint) override;
 private:
-    std::vector<Track> tracks;
+    enum ColumnIds
+    {
+        titleColumn = 1,
+        durationColumn,
+        removeColumn,
+        bpmColumn,
+        keyColumn,
+        bitrateColumn,
+        sampleRateColumn,
+        dateAddedColumn,
+        playCountColumn
+    };
+
+    TrackLibrary trackLibrary;
+    /**track ids in the order they are shown in the table*/
+    std::vector<TrackId> rows;
     
     juce::TextButton importButton{ "ADD TRACKS TO LIBRARY" };
+    juce::TextButton watchFolderButton{ "WATCH FOLDER" };
     juce::TableListBox library;
     juce::TextEditor searchArea;
     juce::TextButton loadToDeckGUI1Button{ "LOAD TO DECKGUI 1" };
     juce::TextButton loadToDeckGUI2Button{ "LOAD TO DECKGUI 2" };
+    juce::TextButton queueButton{ "QUEUE FOR AUTO DJ" };
+    juce::TextButton autoDJButton{ "AUTO DJ" };
+    juce::Slider crossfadeSlider;
+
+    /**tracks are loaded onto the decks through the engine*/
+    OtoEngine& engine;
+    juce::AudioFormatManager& formatManager;
+    /**every change to the library is written through to the store*/
+    LibraryStore& store;
+    TrackPrefetcher& prefetcher;
+    /**colours the waveform of every track as it is imported*/
+    WaveformAnalyser& analyser;
+    AutoDJ& autoDJ;
+    /**tracks the auto DJ plays next, front first*/
+    std::deque<TrackId> autoDJQueue;
+    /**tracks that mix well with the one loaded last, closest tempo first*/
+    std::vector<TrackId> compatibleTracks;
+    /**rows either side of the selection that are prefetched*/
+    static constexpr int prefetchNeighbours{ 2 };
+    /**compatible tracks that are prefetched*/
+    static constexpr int prefetchCompatible{ 4 };
+    /**largest relative tempo difference that still counts as compatible*/
+    static constexpr float maxTempoDistance{ 0.06f };
+
+    LibraryImporter importer;
+    double importProgress{ 0 };
+    juce::ProgressBar importProgressBar{ importProgress };
+    juce::TextButton cancelImportButton{ "CANCEL IMPORT" };
+    /**names of the files skipped during the running import, for its summary*/
+    juce::StringArray importDuplicates;
+    juce::StringArray importUnreadable;
+    int numImported{ 0 };
 
-    DeckGUI* deckGUI1;
-    DeckGUI* deckGUI2;
-    DJAudioPlayer* playerForParsingMetaData;
+    LibrarySorter sorter;
+    std::vector<LibrarySorter::SortKey> sortKeys;
+    TrackFilter filter;
+    juce::String pendingSearchText;
+    LibraryScanner scanner;
+    /**csv the library was saved to before the store, imported once*/
+    static constexpr const char* legacyLibraryFile{ "my-library.csv" };
+    static constexpr const char* watchedFoldersFile{ "my-library-folders.txt" };
     
-    juce::String getLength(juce::URL audioURL);
+    void watchFolder();
+    /**Applies what the scanner found in the watched folders*/
+    void applyScanChanges(LibraryScanner::Changes changes);
+    void saveWatchedFolders();
     juce::String secondsToMinutes(double seconds);
+    juce::String getCellText(TrackId id, int columnId);
+    /**Rebuilds the visible rows from the current sort keys and filter in the background*/
+    void updateView();
 
     void importToLibrary();
-    void saveLibrary();
+    /**Adds, relocates or reports the files the importer has finished*/
+    void applyImportResults();
+    /**Lists what was skipped in one message instead of one per file*/
+    void showImportSummary();
+    /**Fills the library from the store, or from the old csv on the first start*/
     void loadLibrary();
-    void deleteFromTracks(int id);
+    void importLegacyLibrary();
+    void addToLibrary(const Track& track);
+    /**Writes the current attributes of a track to the store*/
+    void storeTrack(TrackId id);
+    void deleteFromTracks(int rowNumber);
     void searchLibrary(juce::String searchText);
+    void selectTitle(juce::String searchText);
     int whereInTracks(juce::String searchText);
-    bool isInTracks(juce::String fileNameWithoutExtension);
-    void loadInPlayer(DeckGUI* deckGUI);
+    void loadInPlayer(int deck);
+    /**Loads a track onto deck 0 or 1 and counts the play*/
+    void loadTrack(TrackId id, int deck);
+    /**Adds the selected track to the end of the auto DJ queue*/
+    void queueSelectedTrack();
+    /**Shows the length of the queue on the auto DJ button*/
+    void updateAutoDJButton();
+    /**Finds the tracks that mix well with this one for the prefetcher*/
+    void findCompatibleTracks(TrackId id);
+    /**Tells the prefetcher which tracks are likely to be loaded next*/
+    void prefetchLikelyTracks();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistComponent)
 };
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    SamplePadPanel.cpp
+    Created: 9 May 2024 8:35:27pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "SamplePadPanel.h"
+
+//==============================================================================
+SamplePadPanel::SamplePadPanel(SamplePads& _pads,
+                               DeckMixer& _mixer
+                               ) : pads(_pads),
+                                   mixer(_mixer)
+{
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        addAndMakeVisible(padButtons[pad]);
+        padButtons[pad].addListener(this);
+        updatePadText(pad);
+    }
+}
+
+SamplePadPanel::~SamplePadPanel()
+{
+}
+
+void SamplePadPanel::resized()
+{
+    const int numRows{ (SamplePads::numPads + numColumns - 1) / numColumns };
+    const int padWidth{ getWidth() / numColumns };
+    const int padHeight{ getHeight() / numRows };
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        padButtons[pad].setBounds((pad % numColumns) * padWidth, (pad / numColumns) * padHeight,
+                                  padWidth, padHeight);
+    }
+}
+
+void SamplePadPanel::buttonClicked(juce::Button* button)
+{
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        if (button == &padButtons[pad])
+        {
+            // stamped with the engine clock, so it starts on the first sample of the next block
+            pads.trigger(pad, mixer.getSamplePosition());
+        }
+    }
+}
+
+bool SamplePadPanel::isInterestedInFileDrag(const juce::StringArray& files)
+{
+    DBG("SamplePadPanel::isInterestedInFileDrag called. "
+        + std::to_string(files.size()) + " file(s) being dragged.");
+    return true;
+}
+
+void SamplePadPanel::filesDropped(const juce::StringArray& files, int x, int y)
+{
+    DBG("SamplePadPanel::filesDropped at " + std::to_string(x)
+        + "x and " + std::to_string(y) + "y" );
+    for (int pad = 0; pad < SamplePads::numPads; ++pad)
+    {
+        if (files.size() == 1 && padButtons[pad].getBounds().contains(x, y))
+        {
+            pads.loadPad(pad, juce::File{ files[0] });
+            updatePadText(pad);
+        }
+    }
+}
+
+void SamplePadPanel::updatePadText(int pad)
+{
+    const juce::File file{ pads.getPadFile(pad) };
+    padButtons[pad].setButtonText(file == juce::File{} ? juce::String(pad + 1)
+                                                      : file.getFileNameWithoutExtension());
+}
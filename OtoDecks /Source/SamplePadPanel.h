@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    SamplePadPanel.h
+    Created: 9 May 2024 8:35:27pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "Engine/SamplePads.h"
+#include "Engine/DeckMixer.h"
+
+//==============================================================================
+/*
+    The pads of the sample bank as a grid of buttons. Drop a one-shot onto a
+    pad to load it, click it to fire it on the master straight away.
+*/
+class SamplePadPanel  : public juce::Component,
+                        public juce::Button::Listener,
+                        public juce::FileDragAndDropTarget
+{
+public:
+    static constexpr int numColumns{ 4 };
+
+    /**Fires the pads on the engine clock of the mixer*/
+    SamplePadPanel(SamplePads& _pads, DeckMixer& _mixer);
+    ~SamplePadPanel() override;
+
+    void resized() override;
+
+    /**implement Button::Listener*/
+    void buttonClicked(juce::Button* button) override;
+
+    /**implement FileDragAndDropTarget*/
+    bool isInterestedInFileDrag(const juce::StringArray& files) override;
+    void filesDropped(const juce::StringArray& files, int x, int y) override;
+
+private:
+    /**Names a pad after the file on it*/
+    void updatePadText(int pad);
+
+    SamplePads& pads;
+    DeckMixer& mixer;
+    std::array<juce::TextButton, SamplePads::numPads> padButtons;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplePadPanel)
+};
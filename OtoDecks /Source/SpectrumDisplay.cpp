@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    SpectrumDisplay.cpp
+    Created: 5 May 2024 9:18:06pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "SpectrumDisplay.h"
+#include <cmath>
+
+namespace
+{
+    constexpr float minFrequency{ 20.0f };
+    constexpr float maxFrequency{ 20000.0f };
+    constexpr float maxDisplayDecibels{ 0.0f };
+}
+
+//==============================================================================
+SpectrumDisplay::SpectrumDisplay(TapAnalyser& _analyser) : analyser(_analyser),
+                                                           sampleRate(0)
+{
+    spectrum.fill(TapAnalyser::minDecibels);
+    setInterceptsMouseClicks(false, false);
+    startTimerHz(30);
+}
+
+SpectrumDisplay::~SpectrumDisplay()
+{
+}
+
+void SpectrumDisplay::paint (juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black);
+    const float width{ (float) getWidth() };
+    const float height{ (float) getHeight() };
+    const auto xForFrequency = [width](float frequency)
+    {
+        return width * std::log(frequency / minFrequency) / std::log(maxFrequency / minFrequency);
+    };
+
+    // a line every octave, labels at 100, 1k and 10k
+    g.setFont(10.0f);
+    for (float frequency : { 31.25f, 62.5f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f })
+    {
+        g.setColour(juce::Colours::darkgrey);
+        g.fillRect(xForFrequency(frequency), 0.0f, 1.0f, height);
+    }
+    g.setColour(juce::Colours::grey);
+    g.drawText("100", juce::Rectangle<float>{ xForFrequency(100.0f) + 2.0f, 0.0f, 30.0f, 12.0f }, juce::Justification::left);
+    g.drawText("1k", juce::Rectangle<float>{ xForFrequency(1000.0f) + 2.0f, 0.0f, 30.0f, 12.0f }, juce::Justification::left);
+    g.drawText("10k", juce::Rectangle<float>{ xForFrequency(10000.0f) + 2.0f, 0.0f, 30.0f, 12.0f }, juce::Justification::left);
+
+    if (sampleRate <= 0)
+    {
+        return;
+    }
+
+    // one point per pixel column, taking the loudest bin it covers
+    const float binWidth{ (float) sampleRate / TapAnalyser::fftSize };
+    juce::Path path;
+    path.startNewSubPath(0.0f, height);
+    for (int x = 0; x < getWidth(); ++x)
+    {
+        const float low{ minFrequency * std::pow(maxFrequency / minFrequency, x / width) };
+        const float high{ minFrequency * std::pow(maxFrequency / minFrequency, (x + 1) / width) };
+        const int firstBin{ juce::jlimit(1, TapAnalyser::numBins - 1, (int) (low / binWidth)) };
+        const int lastBin{ juce::jlimit(firstBin, TapAnalyser::numBins - 1, (int) (high / binWidth)) };
+        float decibels{ TapAnalyser::minDecibels };
+        for (int bin = firstBin; bin <= lastBin; ++bin)
+        {
+            decibels = juce::jmax(decibels, spectrum[(size_t) bin]);
+        }
+        path.lineTo((float) x, juce::jmap(decibels, TapAnalyser::minDecibels, maxDisplayDecibels, height, 0.0f));
+    }
+    path.lineTo(width, height);
+    path.closeSubPath();
+    g.setColour(juce::Colours::cyan.withAlpha(0.4f));
+    g.fillPath(path);
+    g.setColour(juce::Colours::cyan);
+    g.strokePath(path, juce::PathStrokeType{ 1.0f });
+}
+
+void SpectrumDisplay::timerCallback()
+{
+    sampleRate = analyser.getSpectrum(spectrum);
+    repaint();
+}
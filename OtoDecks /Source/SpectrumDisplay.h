@@ -0,0 +1,37 @@
+/*
+  ==============================================================================
+
+    SpectrumDisplay.h
+    Created: 5 May 2024 9:18:06pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TapAnalyser.h"
+
+//==============================================================================
+/*
+    Spectrum of the master from 20Hz to 20kHz on a log frequency scale.
+*/
+class SpectrumDisplay  : public juce::Component,
+                         public juce::Timer
+{
+public:
+    SpectrumDisplay(TapAnalyser& _analyser);
+    ~SpectrumDisplay() override;
+
+    void paint (juce::Graphics&) override;
+    /**Picks up the latest spectrum from the analyser*/
+    void timerCallback() override;
+
+private:
+    TapAnalyser& analyser;
+    std::array<float, TapAnalyser::numBins> spectrum;
+    double sampleRate;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumDisplay)
+};
@@ -0,0 +1,165 @@
+/*
+  ==============================================================================
+
+    TapAnalyser.cpp
+    Created: 5 May 2024 8:20:53pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TapAnalyser.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    /**passes per second, about what the screen refreshes at*/
+    constexpr int refreshRate{ 60 };
+    /**how fast the peak falls back after a transient*/
+    constexpr float peakFallDecibelsPerSecond{ 24.0f };
+    /**how long the peak marker stays at the loudest peak*/
+    constexpr double peakHoldSeconds{ 1.5 };
+    /**integration time of the RMS*/
+    constexpr double rmsSeconds{ 0.3 };
+    constexpr float spectrumFallDecibelsPerSecond{ 48.0f };
+}
+
+//==============================================================================
+struct TapAnalyser::Channel
+{
+    AnalysisTap* tap;
+    bool withSpectrum;
+    /**worker thread only*/
+    Levels levels;
+    std::array<float, 2> meanSquare{};
+    std::array<double, 2> holdSeconds{};
+    /**what the GUI reads, under the result lock*/
+    Levels published;
+};
+
+//==============================================================================
+TapAnalyser::TapAnalyser(DeckMixer& mixer) : juce::Thread("Tap Analyser"),
+                                             scratch(AnalysisTap::numChannels, AnalysisTap::fifoSize),
+                                             fftHistory((size_t) fftSize, 0.0f),
+                                             fftData((size_t) fftSize * 2, 0.0f),
+                                             spectrumSampleRate(0)
+{
+    smoothedSpectrum.fill(minDecibels);
+    spectrum.fill(minDecibels);
+    for (int deck = 0; deck < mixer.getNumDecks(); ++deck)
+    {
+        channels.push_back(std::make_unique<Channel>(Channel{ &mixer.getDeckTap(deck), false }));
+    }
+    // the master is last, the only one with a spectrum
+    channels.push_back(std::make_unique<Channel>(Channel{ &mixer.getMasterTap(), true }));
+    startThread();
+}
+
+TapAnalyser::~TapAnalyser()
+{
+    stopThread(1000);
+}
+
+TapAnalyser::Levels TapAnalyser::getLevels(int tap) const
+{
+    const Channel& channel{ getChannel(tap) };
+    const juce::SpinLock::ScopedLockType lock{ resultLock };
+    return channel.published;
+}
+
+double TapAnalyser::getSpectrum(std::array<float, numBins>& decibels) const
+{
+    const juce::SpinLock::ScopedLockType lock{ resultLock };
+    decibels = spectrum;
+    return spectrumSampleRate;
+}
+
+void TapAnalyser::run()
+{
+    double lastPass{ juce::Time::getMillisecondCounterHiRes() };
+    while (!threadShouldExit())
+    {
+        const double now{ juce::Time::getMillisecondCounterHiRes() };
+        const double seconds{ (now - lastPass) * 0.001 };
+        lastPass = now;
+        for (auto& channel : channels)
+        {
+            analyse(*channel, seconds);
+        }
+        wait(1000 / refreshRate);
+    }
+}
+
+void TapAnalyser::analyse(Channel& channel, double seconds)
+{
+    const int numSamples{ channel.tap->pull(scratch, scratch.getNumSamples()) };
+    const float peakFall{ juce::Decibels::decibelsToGain(-peakFallDecibelsPerSecond * (float) seconds) };
+    const float rmsCoefficient{ (float) std::exp(-seconds / rmsSeconds) };
+    Levels& levels{ channel.levels };
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        // nothing arriving counts as silence, so the meters fall when the device stops
+        const float blockPeak{ numSamples > 0 ? scratch.getMagnitude(ch, 0, numSamples) : 0.0f };
+        const float blockRms{ numSamples > 0 ? scratch.getRMSLevel(ch, 0, numSamples) : 0.0f };
+        // instant attack, then a steady fall in decibels
+        levels.peak[ch] = juce::jmax(blockPeak, levels.peak[ch] * peakFall);
+        channel.meanSquare[ch] = rmsCoefficient * channel.meanSquare[ch] + (1.0f - rmsCoefficient) * blockRms * blockRms;
+        levels.rms[ch] = std::sqrt(channel.meanSquare[ch]);
+        channel.holdSeconds[ch] += seconds;
+        if (levels.peak[ch] >= levels.peakHold[ch] || channel.holdSeconds[ch] > peakHoldSeconds)
+        {
+            levels.peakHold[ch] = levels.peak[ch];
+            channel.holdSeconds[ch] = 0;
+        }
+    }
+    if (channel.withSpectrum && numSamples > 0)
+    {
+        updateSpectrum(scratch.getReadPointer(0), scratch.getReadPointer(1), numSamples, seconds);
+    }
+
+    const juce::SpinLock::ScopedLockType lock{ resultLock };
+    channel.published = levels;
+    if (channel.withSpectrum)
+    {
+        spectrum = smoothedSpectrum;
+        spectrumSampleRate = channel.tap->getSampleRate();
+    }
+}
+
+void TapAnalyser::updateSpectrum(const float* left, const float* right, int numSamples, double seconds)
+{
+    // slide the window on by the new samples, mixed down to mono
+    const int numFresh{ juce::jmin(numSamples, fftSize) };
+    const int numKept{ fftSize - numFresh };
+    std::copy(fftHistory.begin() + numFresh, fftHistory.end(), fftHistory.begin());
+    float* fresh{ fftHistory.data() + numKept };
+    const int offset{ numSamples - numFresh };
+    juce::FloatVectorOperations::copy(fresh, left + offset, numFresh);
+    juce::FloatVectorOperations::add(fresh, right + offset, numFresh);
+    juce::FloatVectorOperations::multiply(fresh, 0.5f, numFresh);
+
+    std::copy(fftHistory.begin(), fftHistory.end(), fftData.begin());
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    // a full scale sine reads 0 dB: the bins sum fftSize / 2 of it and the window halves that
+    const float scale{ 4.0f / fftSize };
+    const float fall{ spectrumFallDecibelsPerSecond * (float) seconds };
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const float level{ juce::Decibels::gainToDecibels(fftData[(size_t) bin] * scale, minDecibels) };
+        smoothedSpectrum[(size_t) bin] = juce::jmax(level, smoothedSpectrum[(size_t) bin] - fall);
+    }
+}
+
+TapAnalyser::Channel& TapAnalyser::getChannel(int tap) const
+{
+    if (tap == master)
+    {
+        return *channels.back();
+    }
+    jassert(juce::isPositiveAndBelow(tap, (int) channels.size() - 1));
+    return *channels[(size_t) tap];
+}
@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    TapAnalyser.h
+    Created: 5 May 2024 8:20:53pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <memory>
+#include <vector>
+#include "Engine/DeckMixer.h"
+
+//==============================================================================
+/*
+    Drains the analysis taps of the mixer on a thread of its own at display
+    rate and turns them into what the meters and the spectrum draw: peak and
+    RMS with meter ballistics for every deck and the master, and a smoothed
+    FFT of the master. The audio thread only ever copies into the taps.
+*/
+class TapAnalyser : private juce::Thread
+{
+public:
+    /**Index of the master in getLevels, decks are 0 and up*/
+    static constexpr int master{ -1 };
+    static constexpr int fftOrder{ 11 };
+    static constexpr int fftSize{ 1 << fftOrder };
+    static constexpr int numBins{ fftSize / 2 };
+    /**Lowest level the meters and the spectrum show*/
+    static constexpr float minDecibels{ -90.0f };
+
+    /**Levels of one signal as gains, left and right*/
+    struct Levels
+    {
+        std::array<float, 2> peak{};
+        std::array<float, 2> rms{};
+        std::array<float, 2> peakHold{};
+    };
+
+    /**Starts analysing every deck of the mixer and its master*/
+    TapAnalyser(DeckMixer& mixer);
+    ~TapAnalyser() override;
+
+    /**Gets the latest levels of a deck or the master*/
+    Levels getLevels(int tap) const;
+    /**Copies the master spectrum in decibels, one value per FFT bin, and returns its sample rate*/
+    double getSpectrum(std::array<float, numBins>& decibels) const;
+
+private:
+    struct Channel;
+
+    void run() override;
+    /**Drains one tap and moves its ballistics on by the seconds since the last pass*/
+    void analyse(Channel& channel, double seconds);
+    /**Adds the newest samples of the master to the FFT window and updates the spectrum*/
+    void updateSpectrum(const float* left, const float* right, int numSamples, double seconds);
+    Channel& getChannel(int tap) const;
+
+    std::vector<std::unique_ptr<Channel>> channels;
+    /**pulled samples, big enough for a full tap*/
+    juce::AudioBuffer<float> scratch;
+
+    juce::dsp::FFT fft{ fftOrder };
+    /**not normalised, the scaling to decibels accounts for the window*/
+    juce::dsp::WindowingFunction<float> window{ (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann, false };
+    /**the last fftSize samples of the master as mono, oldest first*/
+    std::vector<float> fftHistory;
+    std::vector<float> fftData;
+    /**worker thread only*/
+    std::array<float, numBins> smoothedSpectrum;
+
+    /**guards what the GUI reads, never taken by the audio thread*/
+    mutable juce::SpinLock resultLock;
+    std::array<float, numBins> spectrum;
+    double spectrumSampleRate;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TapAnalyser)
+};
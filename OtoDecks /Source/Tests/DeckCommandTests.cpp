@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    DeckCommandTests.cpp
+    Created: 10 May 2024 8:02:37pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TestTracks.h"
+#include "DJAudioPlayer.h"
+
+namespace
+{
+//==============================================================================
+/*
+    Plays, stops and seeks an offline deck through its command queue and
+    checks each lands on its sample, whatever the block size. The resampler
+    reads a few samples ahead, so a change is heard that many samples after
+    the one it was scheduled for.
+*/
+class DeckCommandTests : public juce::UnitTest
+{
+public:
+    DeckCommandTests() : juce::UnitTest("Deck commands", "OtoDecks")
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    void runTest() override
+    {
+        const juce::File level{ TestTracks::write("level.wav", trackLength, [](int, int) { return 0.25f; }) };
+        const juce::File ramp{ TestTracks::write("ramp.wav", trackLength,
+                                                 [](int, int i) { return (float) i / trackLength; }) };
+
+        beginTest("Play and stop take effect on their sample");
+        {
+            const juce::AudioBuffer<float> output{ render(level, 512, [](DJAudioPlayer& deck, juce::int64 blockStart)
+                                                          {
+                                                              if (blockStart == 0)
+                                                              {
+                                                                  deck.playAt(playSample);
+                                                                  deck.stopAt(stopSample);
+                                                              }
+                                                          }) };
+            const float heard{ output.getSample(0, (playSample + stopSample) / 2) };
+            expect(heard > 0.2f, "the deck is heard while it plays");
+
+            expectEquals(output.getMagnitude(0, 0, playSample), 0.0f, "silent before the play sample");
+            const int onset{ findFirstAbove(output, 0, 0.0f) };
+            expect(onset >= playSample && onset <= playSample + lookAhead,
+                   "heard from the play sample, got " + juce::String(onset));
+            expectWithinAbsoluteError(output.getSample(0, playSample + lookAhead + TransportGate::fadeSamples),
+                                      heard, 1.0e-5f, "fully open one fade after the play sample");
+
+            expectWithinAbsoluteError(output.getSample(0, stopSample - 1), heard, 1.0e-5f,
+                                      "playing up to the stop sample");
+            const int silentFrom{ stopSample + lookAhead + TransportGate::fadeSamples };
+            expectEquals(output.getMagnitude(0, silentFrom, output.getNumSamples() - silentFrom), 0.0f,
+                         "silent one fade after the stop sample");
+        }
+
+        beginTest("Seek takes effect on the first sample of the next block");
+        {
+            const juce::AudioBuffer<float> output{ render(ramp, 512, [](DJAudioPlayer& deck, juce::int64 blockStart)
+                                                          {
+                                                              if (blockStart == 0)
+                                                              {
+                                                                  deck.play();
+                                                              }
+                                                              if (blockStart == seekSample)
+                                                              {
+                                                                  deck.setPositionRelative(0.5);
+                                                              }
+                                                          }) };
+            // the ramp is read at twice its level, the dry path of the reverb doubles it
+            const float halfway{ 2.0f * 0.5f };
+            expect(output.getSample(0, seekSample - 1) < 0.25f * halfway, "still at the start before the seek");
+            const int jump{ findFirstAbove(output, seekSample - 1, 0.5f * halfway) };
+            expect(jump >= seekSample && jump <= seekSample + lookAhead,
+                   "heard from the seek sample, got " + juce::String(jump));
+            expectWithinAbsoluteError(output.getSample(0, jump + 100), halfway + 2.0f * (100.0f / trackLength), 0.01f,
+                                      "plays on from the middle of the track");
+        }
+
+        beginTest("The same commands render the same audio in any block size");
+        {
+            const auto commands = [](DJAudioPlayer& deck, juce::int64 blockStart)
+            {
+                if (blockStart == 0)
+                {
+                    deck.playAt(playSample);
+                    deck.stopAt(stopSample);
+                }
+                if (blockStart == seekSample)
+                {
+                    deck.setPositionRelative(0.5);
+                }
+            };
+            const juce::AudioBuffer<float> large{ render(ramp, 512, commands) };
+            const juce::AudioBuffer<float> small{ render(ramp, 64, commands) };
+            float maxDifference{ 0 };
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                for (int i = 0; i < large.getNumSamples(); ++i)
+                {
+                    maxDifference = juce::jmax(maxDifference, std::abs(large.getSample(ch, i) - small.getSample(ch, i)));
+                }
+            }
+            // only the rounding of a fade split across blocks may differ
+            expect(maxDifference < 1.0e-5f, "largest difference " + juce::String(maxDifference));
+        }
+    }
+
+private:
+    static constexpr int trackLength{ 2 * (int) TestTracks::sampleRate };
+    static constexpr int renderLength{ 8192 };
+    /**samples the resampler reads ahead of what it plays*/
+    static constexpr int lookAhead{ 4 };
+    static constexpr int playSample{ 1000 };
+    /**a multiple of both block sizes, a seek is applied at the start of a block*/
+    static constexpr int seekSample{ 4096 };
+    static constexpr int stopSample{ 6000 };
+
+    using BeforeBlock = std::function<void(DJAudioPlayer& deck, juce::int64 blockStart)>;
+
+    /**Renders a deck with the track loaded, calling beforeBlock ahead of each block*/
+    juce::AudioBuffer<float> render(const juce::File& track, int blockSize, const BeforeBlock& beforeBlock)
+    {
+        DJAudioPlayer deck{ formatManager, false };
+        deck.prepareToPlay(blockSize, TestTracks::sampleRate);
+        deck.loadURL(juce::URL{ track });
+
+        juce::AudioBuffer<float> output{ 2, renderLength };
+        for (int start = 0; start < renderLength; start += blockSize)
+        {
+            beforeBlock(deck, start);
+            const int numSamples{ juce::jmin(blockSize, renderLength - start) };
+            deck.getNextAudioBlock(juce::AudioSourceChannelInfo{ &output, start, numSamples }, start);
+        }
+        deck.releaseResources();
+        return output;
+    }
+
+    /**Finds the first sample from start on whose level is above threshold, -1 if there is none*/
+    static int findFirstAbove(const juce::AudioBuffer<float>& audio, int start, float threshold)
+    {
+        for (int i = start; i < audio.getNumSamples(); ++i)
+        {
+            if (std::abs(audio.getSample(0, i)) > threshold)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    juce::AudioFormatManager formatManager;
+};
+
+DeckCommandTests deckCommandTests;
+}
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    DeckMixerTests.cpp
+    Created: 10 May 2024 8:40:12pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TestTracks.h"
+#include "DeckMixer.h"
+
+namespace
+{
+//==============================================================================
+/*
+    Crossfades between two decks playing a constant level, one only on the
+    left and the other only on the right, so each side of the master is the
+    gain of one deck. The fade starts and ends on block boundaries and its
+    middle falls on one too, where the gains are exact equal power points.
+*/
+class DeckMixerTests : public juce::UnitTest
+{
+public:
+    DeckMixerTests() : juce::UnitTest("Deck mixer", "OtoDecks")
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    void runTest() override
+    {
+        const int trackLength{ 2 * (int) TestTracks::sampleRate };
+        const juce::File left{ TestTracks::write("left.wav", trackLength,
+                                                 [](int channel, int) { return channel == 0 ? 0.25f : 0.0f; }) };
+        const juce::File right{ TestTracks::write("right.wav", trackLength,
+                                                  [](int channel, int) { return channel == 1 ? 0.25f : 0.0f; }) };
+
+        beginTest("Equal power crossfade");
+
+        DJAudioPlayer from{ formatManager, false };
+        DJAudioPlayer to{ formatManager, false };
+        DeckMixer mixer;
+        mixer.addDeck(&from);
+        mixer.addDeck(&to);
+        mixer.prepareToPlay(blockSize, TestTracks::sampleRate);
+        from.loadURL(juce::URL{ left });
+        to.loadURL(juce::URL{ right });
+        from.play();
+        to.play();
+        // the way the auto DJ mixes, the outgoing deck stops where the fade ends
+        expect(mixer.scheduleCrossfade(&from, &to, fadeStart, fadeLength));
+        from.stopAt(fadeStart + fadeLength);
+
+        juce::AudioBuffer<float> output{ 2, renderLength };
+        for (int start = 0; start < renderLength; start += blockSize)
+        {
+            mixer.getNextAudioBlock(juce::AudioSourceChannelInfo{ &output, start, blockSize });
+        }
+        mixer.releaseResources();
+
+        // both decks play the same level through the same chain
+        const float fullLevel{ output.getSample(0, fadeStart / 2) };
+        expect(fullLevel > 0.2f, "the outgoing deck is heard before the fade");
+        expectEquals(output.getMagnitude(1, 0, fadeStart), 0.0f, "the incoming deck is silent before the fade");
+
+        const auto expectGains = [this, &output, fullLevel](int sample, float fromGain, float toGain)
+        {
+            expectWithinAbsoluteError(output.getSample(0, sample) / fullLevel, fromGain, 1.0e-4f,
+                                      "outgoing gain at " + juce::String(sample));
+            expectWithinAbsoluteError(output.getSample(1, sample) / fullLevel, toGain, 1.0e-4f,
+                                      "incoming gain at " + juce::String(sample));
+        };
+        const float halfPower{ std::sqrt(0.5f) };
+        expectGains(fadeStart, 1.0f, 0.0f);
+        expectGains(fadeStart + fadeLength / 2, halfPower, halfPower);
+        expectGains(fadeStart + fadeLength, 0.0f, 1.0f);
+        expectGains(renderLength - 1, 0.0f, 1.0f);
+
+        // between the exact points the gains are ramped, which keeps the power within a percent
+        for (int i = fadeStart; i < fadeStart + fadeLength; i += 37)
+        {
+            const float fromGain{ output.getSample(0, i) / fullLevel };
+            const float toGain{ output.getSample(1, i) / fullLevel };
+            expectWithinAbsoluteError(fromGain * fromGain + toGain * toGain, 1.0f, 0.02f,
+                                      "power at " + juce::String(i));
+        }
+    }
+
+private:
+    static constexpr int blockSize{ 512 };
+    static constexpr int fadeStart{ 8 * blockSize };
+    static constexpr int fadeLength{ 8 * blockSize };
+    static constexpr int renderLength{ fadeStart + fadeLength + 4 * blockSize };
+
+    juce::AudioFormatManager formatManager;
+};
+
+DeckMixerTests deckMixerTests;
+}
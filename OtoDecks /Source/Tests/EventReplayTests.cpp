@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    EventReplayTests.cpp
+    Created: 10 May 2024 9:36:48pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TestTracks.h"
+#include "EventReplay.h"
+#include "DeckMixer.h"
+
+namespace
+{
+//==============================================================================
+/*
+    Writes a short session log by hand, two loads, starts, a gain change,
+    a seek, a crossfade and a stop, on a clock advanced by a mixer with no
+    decks, then renders it twice and checks both renders are the same audio
+    and run up to the sample the log was closed at.
+*/
+class EventReplayTests : public juce::UnitTest
+{
+public:
+    EventReplayTests() : juce::UnitTest("Event replay", "OtoDecks")
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    void runTest() override
+    {
+        const juce::File level{ TestTracks::write("replay-level.wav", trackLength, [](int, int) { return 0.25f; }) };
+        const juce::File ramp{ TestTracks::write("replay-ramp.wav", trackLength,
+                                                 [](int, int i) { return (float) i / trackLength; }) };
+        const juce::File logFile{ TestTracks::getDirectory().getChildFile("session.otolog") };
+
+        beginTest("Log a session");
+        {
+            DeckMixer clock;
+            clock.prepareToPlay(blockSize, TestTracks::sampleRate);
+            DeckEventLog log{ clock };
+            log.setDeviceFormat(TestTracks::sampleRate, blockSize);
+            expect(log.open(logFile));
+            log.appendLoad(0, level, 0);
+            log.appendLoad(1, ramp, 0);
+            log.append(0, DeckEvent::Type::play, 0, 0, 300);
+            log.append(1, DeckEvent::Type::play, 0, 0, 700);
+            log.append(0, DeckEvent::Type::gain, 0.5, 0, 2000);
+            log.append(1, DeckEvent::Type::seek, 0.25, 0, 3001);
+            log.append(0, DeckEvent::Type::crossfade, 4096, 1, 4000);
+            log.append(0, DeckEvent::Type::stop, 0, 0, 8096);
+
+            // the log is closed at the clock, part way into a block
+            juce::AudioBuffer<float> silence{ 2, blockSize };
+            for (int position = 0; position < sessionLength; position += blockSize)
+            {
+                const int numSamples{ juce::jmin(blockSize, sessionLength - position) };
+                clock.getNextAudioBlock(juce::AudioSourceChannelInfo{ &silence, 0, numSamples });
+            }
+            expectEquals((int) clock.getSamplePosition(), sessionLength);
+            log.close();
+        }
+
+        beginTest("Render the log twice");
+        const juce::File firstRender{ TestTracks::getDirectory().getChildFile("first.wav") };
+        const juce::File secondRender{ TestTracks::getDirectory().getChildFile("second.wav") };
+        expect(EventReplay::render(logFile, firstRender, formatManager));
+        expect(EventReplay::render(logFile, secondRender, formatManager));
+
+        juce::AudioBuffer<float> first;
+        juce::AudioBuffer<float> second;
+        expect(TestTracks::read(firstRender, first));
+        expect(TestTracks::read(secondRender, second));
+        expectEquals(first.getNumSamples(), sessionLength, "rendered up to the end of the log");
+        expectEquals(second.getNumSamples(), sessionLength);
+        expect(first.getMagnitude(0, sessionLength) > 0.1f, "the decks are heard");
+
+        bool identical{ first.getNumChannels() == second.getNumChannels() };
+        for (int ch = 0; identical && ch < first.getNumChannels(); ++ch)
+        {
+            identical = std::memcmp(first.getReadPointer(ch), second.getReadPointer(ch),
+                                    sizeof(float) * (size_t) juce::jmin(first.getNumSamples(), second.getNumSamples())) == 0;
+        }
+        expect(identical, "both renders are the same audio");
+    }
+
+private:
+    static constexpr int trackLength{ 2 * (int) TestTracks::sampleRate };
+    static constexpr int blockSize{ 256 };
+    static constexpr int sessionLength{ 12000 };
+
+    juce::AudioFormatManager formatManager;
+};
+
+EventReplayTests eventReplayTests;
+}
@@ -0,0 +1,286 @@
+/*
+  ==============================================================================
+
+    LatencyTesterTests.cpp
+    Created: 11 May 2024 7:20:43pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "LatencyTester.h"
+#include <vector>
+
+namespace
+{
+//==============================================================================
+/*
+    An audio device that never runs a callback of its own. The test plays the
+    audio thread, so the blocks, their timing and the loopback are exactly
+    known. It counts an xrun for every block it is told about at its smallest
+    block size, so the block size search has one size to reject.
+*/
+class SimulatedDevice : public juce::AudioIODevice
+{
+public:
+    static constexpr double rate{ 48000.0 };
+
+    SimulatedDevice() : juce::AudioIODevice("Simulated loopback", "Simulated"),
+                        opened(false),
+                        callback(nullptr),
+                        bufferSize(0),
+                        xruns(0)
+    {
+    }
+
+    ~SimulatedDevice() override
+    {
+        close();
+    }
+
+    juce::StringArray getOutputChannelNames() override { return { "Out 1", "Out 2" }; }
+    juce::StringArray getInputChannelNames() override { return { "In 1" }; }
+    juce::Array<double> getAvailableSampleRates() override { return { rate }; }
+    juce::Array<int> getAvailableBufferSizes() override { return { 256, 64, 128 }; }
+    int getDefaultBufferSize() override { return 256; }
+
+    juce::String open(const juce::BigInteger& inputChannels, const juce::BigInteger& outputChannels,
+                      double, int bufferSizeSamples) override
+    {
+        activeInputs = inputChannels;
+        activeOutputs = outputChannels;
+        bufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : getDefaultBufferSize();
+        opened = true;
+        return {};
+    }
+
+    void close() override
+    {
+        stop();
+        opened = false;
+    }
+
+    bool isOpen() override { return opened; }
+
+    void start(juce::AudioIODeviceCallback* newCallback) override
+    {
+        callback = newCallback;
+        if (callback != nullptr)
+        {
+            callback->audioDeviceAboutToStart(this);
+        }
+    }
+
+    void stop() override
+    {
+        if (callback != nullptr)
+        {
+            callback->audioDeviceStopped();
+        }
+        callback = nullptr;
+    }
+
+    bool isPlaying() override { return callback != nullptr; }
+    juce::String getLastError() override { return {}; }
+    int getCurrentBufferSizeSamples() override { return bufferSize; }
+    double getCurrentSampleRate() override { return rate; }
+    int getCurrentBitDepth() override { return 32; }
+    juce::BigInteger getActiveOutputChannels() const override { return activeOutputs; }
+    juce::BigInteger getActiveInputChannels() const override { return activeInputs; }
+    int getOutputLatencyInSamples() override { return 0; }
+    int getInputLatencyInSamples() override { return 0; }
+    int getXRunCount() const noexcept override { return xruns; }
+
+    /**Called by the test for every block it plays at the current size*/
+    void blockPlayed()
+    {
+        if (bufferSize == 64)
+        {
+            ++xruns;
+        }
+    }
+
+private:
+    bool opened;
+    juce::AudioIODeviceCallback* callback;
+    int bufferSize;
+    int xruns;
+    juce::BigInteger activeInputs;
+    juce::BigInteger activeOutputs;
+};
+
+class SimulatedDeviceType : public juce::AudioIODeviceType
+{
+public:
+    SimulatedDeviceType() : juce::AudioIODeviceType("Simulated")
+    {
+    }
+
+    void scanForDevices() override {}
+    juce::StringArray getDeviceNames(bool) const override { return { "Simulated loopback" }; }
+    int getDefaultDeviceIndex(bool) const override { return 0; }
+    int getIndexOfDevice(juce::AudioIODevice* device, bool) const override { return device != nullptr ? 0 : -1; }
+    bool hasSeparateInputsAndOutputs() const override { return false; }
+
+    juce::AudioIODevice* createDevice(const juce::String&, const juce::String&) override
+    {
+        return new SimulatedDevice();
+    }
+};
+
+//==============================================================================
+/*
+    Runs the round trip and the block size search against the simulated
+    device. The output of every block goes back into the input a known
+    number of samples later, the callbacks arrive on a fixed schedule with
+    a known jitter, and music that is not muted would be taken for a click.
+*/
+class LatencyTesterTests : public juce::UnitTest
+{
+public:
+    LatencyTesterTests() : juce::UnitTest("Latency tester", "OtoDecks")
+    {
+    }
+
+    void runTest() override
+    {
+        beginTest("Round trip through a loopback");
+        juce::AudioDeviceManager deviceManager;
+        // with a type added first the manager never looks for real devices
+        deviceManager.addAudioDeviceType(std::make_unique<SimulatedDeviceType>());
+        expectEquals(deviceManager.initialise(1, 2, nullptr, false), juce::String());
+        auto* device = dynamic_cast<SimulatedDevice*>(deviceManager.getCurrentAudioDevice());
+        expect(device != nullptr, "the simulated device is open");
+        if (device == nullptr)
+        {
+            return;
+        }
+
+        LatencyTester tester{ deviceManager };
+        juce::String report;
+        tester.onFinished = [&report](const juce::String& text) { report = text; };
+
+        {
+            constexpr int blockSize{ 256 };
+            constexpr int numBlocks{ 563 };
+            tester.prepare(SimulatedDevice::rate, blockSize);
+            tester.startRoundTrip();
+
+            // callbacks alternate this much early and late around the block length
+            const double blockSeconds{ blockSize / SimulatedDevice::rate };
+            const double offsetSeconds{ 0.0001 };
+            Loopback loopback{ loopDelay };
+            juce::AudioBuffer<float> buffer{ 2, blockSize };
+            double callbackSeconds{ 0 };
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                callbackSeconds += blockSeconds + (block % 2 == 0 ? offsetSeconds : -offsetSeconds);
+                loopback.play(tester, buffer, juce::Time::secondsToHighResolutionTicks(callbackSeconds));
+            }
+            waitForReport(tester, 2000);
+
+            expect(report.startsWith("Round trip: 517 samples (10.77 ms), 517 to 517 samples over 8 clicks\n"),
+                   report);
+            expect(report.contains("Callbacks: 562, every 5.33 ms (block length 5.33 ms)"), report);
+            expect(report.contains("Jitter: 0.100 ms, longest gap 5.43 ms, 0 late"), report);
+        }
+
+        beginTest("Block size search keeps the smallest clean size");
+        {
+            report.clear();
+            tester.startBlockSizeSearch();
+            Loopback loopback{ loopDelay };
+            juce::AudioBuffer<float> buffer;
+            int preparedSize{ 0 };
+            double callbackSeconds{ 0 };
+            const juce::uint32 giveUpAt{ juce::Time::getMillisecondCounter() + 20000 };
+            while (tester.isBusy() && juce::Time::getMillisecondCounter() < giveUpAt)
+            {
+                // the manager restarts the same device with each size it is given
+                device = dynamic_cast<SimulatedDevice*>(deviceManager.getCurrentAudioDevice());
+                if (device == nullptr)
+                {
+                    break;
+                }
+                const int blockSize{ device->getCurrentBufferSizeSamples() };
+                if (blockSize != preparedSize)
+                {
+                    // what prepareToPlay does when the device restarts
+                    tester.prepare(SimulatedDevice::rate, blockSize);
+                    buffer.setSize(2, blockSize);
+                    preparedSize = blockSize;
+                }
+                // about as much audio as the message loop gets time
+                for (int i = 0; i < (int) (0.01 * SimulatedDevice::rate) / blockSize; ++i)
+                {
+                    callbackSeconds += blockSize / SimulatedDevice::rate;
+                    loopback.play(tester, buffer, juce::Time::secondsToHighResolutionTicks(callbackSeconds));
+                    device->blockPlayed();
+                }
+                juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+            }
+
+            expect(!tester.isBusy(), "the search finished");
+            expect(report.startsWith("Using blocks of 128 samples (2.67 ms)."), report);
+            expect(report.contains("\n64 samples: ") && !report.contains("64 samples: 0 xruns"),
+                   "the smallest size had xruns");
+            expect(report.contains("128 samples: 0 xruns, 0 late callbacks"), report);
+            expect(report.contains("Callbacks: ") && report.contains("every 2.67 ms (block length 2.67 ms)"), report);
+            expect(report.contains("Jitter: 0.000 ms"), report);
+            expect(device != nullptr && device->getCurrentBufferSizeSamples() == 128, "the device is left at 128");
+        }
+    }
+
+private:
+    /**samples from the master outputs back to input 1*/
+    static constexpr int loopDelay{ 517 };
+
+    /**Plays the audio thread: the input comes from the delayed output, the mixer puts music on the master*/
+    class Loopback
+    {
+    public:
+        Loopback(int _delay) : delay(_delay)
+        {
+        }
+
+        void play(LatencyTester& tester, juce::AudioBuffer<float>& buffer, juce::int64 ticks)
+        {
+            const int numSamples{ buffer.getNumSamples() };
+            const juce::int64 start{ (juce::int64) output.size() };
+            buffer.clear();
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const juce::int64 from{ start + i - delay };
+                buffer.setSample(0, i, from >= 0 ? output[(size_t) from] : 0.0f);
+            }
+            const juce::AudioSourceChannelInfo info{ &buffer, 0, numSamples };
+            tester.beginBlock(info, ticks);
+            // loud enough to be taken for a click if it came back
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                juce::FloatVectorOperations::fill(buffer.getWritePointer(ch), 0.5f, numSamples);
+            }
+            tester.endBlock(info);
+            output.insert(output.end(), buffer.getReadPointer(0), buffer.getReadPointer(0) + numSamples);
+        }
+
+    private:
+        const int delay;
+        /**everything output 1 played, from the first block*/
+        std::vector<float> output;
+    };
+
+    /**Runs the message loop until the tester reports, or the time runs out*/
+    void waitForReport(LatencyTester& tester, int timeoutMs)
+    {
+        const juce::uint32 giveUpAt{ juce::Time::getMillisecondCounter() + (juce::uint32) timeoutMs };
+        while (tester.isBusy() && juce::Time::getMillisecondCounter() < giveUpAt)
+        {
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(20);
+        }
+        expect(!tester.isBusy(), "the measurement finished");
+    }
+};
+
+LatencyTesterTests latencyTesterTests;
+}
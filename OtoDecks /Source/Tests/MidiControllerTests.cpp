@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    MidiControllerTests.cpp
+    Created: 11 May 2024 8:05:19pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TestTracks.h"
+#include "MidiController.h"
+
+namespace
+{
+//==============================================================================
+/*
+    Learns a mapping and plays it through the controller's virtual input,
+    the way other software would, with a button that sends a CC: pressing
+    it toggles the deck's PFL, letting go does nothing, and the learnt
+    mapping is saved to the mapping file. Systems without virtual MIDI
+    ports, Windows or Linux without the ALSA sequencer, skip it.
+*/
+class MidiControllerTests : public juce::UnitTest
+{
+public:
+    MidiControllerTests() : juce::UnitTest("MIDI controller", "OtoDecks")
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    void runTest() override
+    {
+        beginTest("A learnt CC button drives its deck through the virtual input");
+
+        DJAudioPlayer deck1{ formatManager, false };
+        DJAudioPlayer deck2{ formatManager, false };
+        const juce::File mappingFile{ TestTracks::getDirectory().getChildFile("midi-mapping.txt") };
+        mappingFile.deleteFile();
+
+        MidiController controller{ &deck1, &deck2, mappingFile };
+        controller.start();
+        std::unique_ptr<juce::MidiOutput> port{ openVirtualInput() };
+        if (port == nullptr)
+        {
+            logMessage("No virtual MIDI input on this system, skipped");
+            return;
+        }
+
+        controller.learn(1, MidiController::Control::pfl);
+        expect(controller.isLearning());
+        port->sendMessageNow(juce::MidiMessage::controllerEvent(1, buttonCC, 127));
+        expect(waitFor([&controller] { return !controller.isLearning(); }), "the CC was learnt");
+        expect(!deck2.isCueEnabled(), "learning does not press the button");
+
+        // saved on the message thread once the MIDI thread has learnt it
+        expect(waitFor([&mappingFile] { return mappingFile.existsAsFile(); }), "the mapping was saved");
+        expectEquals(mappingFile.loadFileAsString().trim(),
+                     juce::String(buttonCC) + " 1 " + juce::String((int) MidiController::Control::pfl));
+
+        port->sendMessageNow(juce::MidiMessage::controllerEvent(1, buttonCC, 127));
+        expect(waitFor([&deck2] { return deck2.isCueEnabled(); }), "pressing the button turns PFL on");
+
+        port->sendMessageNow(juce::MidiMessage::controllerEvent(1, buttonCC, 0));
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(200);
+        expect(deck2.isCueEnabled(), "letting go of the button leaves PFL on");
+
+        port->sendMessageNow(juce::MidiMessage::controllerEvent(1, buttonCC, 127));
+        expect(waitFor([&deck2] { return !deck2.isCueEnabled(); }), "pressing it again turns PFL off");
+        expect(!deck1.isCueEnabled(), "the other deck is not mapped");
+    }
+
+private:
+    /**a controller number MIDI leaves undefined, nothing else listening reacts to it*/
+    static constexpr int buttonCC{ 20 };
+
+    /**Opens the virtual input of the controller as an output of this process*/
+    static std::unique_ptr<juce::MidiOutput> openVirtualInput()
+    {
+        for (const juce::MidiDeviceInfo& device : juce::MidiOutput::getAvailableDevices())
+        {
+            if (device.name == MidiController::virtualInputName)
+            {
+                return juce::MidiOutput::openDevice(device.identifier);
+            }
+        }
+        return nullptr;
+    }
+
+    /**Runs the message loop until the condition holds, returns false if it never does*/
+    static bool waitFor(const std::function<bool()>& condition)
+    {
+        const juce::uint32 giveUpAt{ juce::Time::getMillisecondCounter() + 2000 };
+        while (!condition())
+        {
+            if (juce::Time::getMillisecondCounter() > giveUpAt)
+            {
+                return false;
+            }
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+        }
+        return true;
+    }
+
+    juce::AudioFormatManager formatManager;
+};
+
+MidiControllerTests midiControllerTests;
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    TestMain.cpp
+    Created: 10 May 2024 7:31:06pm
+    Author:  Kirby Loh
+
+    Runs the engine unit tests, every juce::UnitTest in the OtoDecks
+    category, and exits with 1 if any of them failed:
+
+        OtoDecksTests [<test name>]
+
+  ==============================================================================
+*/
+
+#include <juce_events/juce_events.h>
+#include <iostream>
+#include "TestTracks.h"
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // the timers of the engine, and the tests that wait on them, need a message thread
+    juce::MessageManager::getInstance();
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    if (argc > 1)
+    {
+        for (juce::UnitTest* test : juce::UnitTest::getTestsInCategory("OtoDecks"))
+        {
+            if (test->getName() == juce::String(juce::CharPointer_UTF8{ argv[1] }))
+            {
+                runner.runTests({ test });
+            }
+        }
+    }
+    else
+    {
+        runner.runTestsInCategory("OtoDecks");
+    }
+
+    int numFailures{ 0 };
+    for (int i = 0; i < runner.getNumResults(); ++i)
+    {
+        numFailures += runner.getResult(i)->failures;
+    }
+    if (runner.getNumResults() == 0)
+    {
+        std::cerr << "no such test" << std::endl;
+        numFailures = 1;
+    }
+    TestTracks::deleteAll();
+
+    juce::DeletedAtShutdown::deleteAll();
+    juce::MessageManager::deleteInstance();
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    TestTracks.cpp
+    Created: 10 May 2024 7:48:21pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TestTracks.h"
+
+//==============================================================================
+juce::File TestTracks::getDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("OtoDecksTests");
+}
+
+juce::File TestTracks::write(const juce::String& fileName, int numSamples, const Signal& signal)
+{
+    const juce::File file{ getDirectory().getChildFile(fileName) };
+    file.getParentDirectory().createDirectory();
+    file.deleteFile();
+
+    juce::AudioBuffer<float> audio{ 2, numSamples };
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            audio.setSample(ch, i, signal(ch, i));
+        }
+    }
+
+    std::unique_ptr<juce::FileOutputStream> stream{ file.createOutputStream() };
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    if (stream != nullptr)
+    {
+        // 32 bits are floats, the decks read back exactly what was written
+        writer.reset(wavFormat.createWriterFor(stream.get(), sampleRate, 2, 32, {}, 0));
+    }
+    if (writer == nullptr)
+    {
+        DBG("TestTracks::write cannot write " << file.getFullPathName());
+        return {};
+    }
+    stream.release();
+    writer->writeFromAudioSampleBuffer(audio, 0, numSamples);
+    return file;
+}
+
+bool TestTracks::read(const juce::File& file, juce::AudioBuffer<float>& audio)
+{
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatReader> reader{ wavFormat.createReaderFor(file.createInputStream().release(), true) };
+    if (reader == nullptr)
+    {
+        return false;
+    }
+    audio.setSize((int) reader->numChannels, (int) reader->lengthInSamples);
+    return reader->read(&audio, 0, (int) reader->lengthInSamples, 0, true, true);
+}
+
+void TestTracks::deleteAll()
+{
+    getDirectory().deleteRecursively();
+}
@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    TestTracks.h
+    Created: 10 May 2024 7:48:21pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <functional>
+
+//==============================================================================
+/*
+    Short synthetic tracks for the tests to load into decks. A constant level
+    shows when a deck is heard and a ramp shows where in the track it plays.
+    They are written to a folder of the temp directory that is removed once
+    the tests have run.
+*/
+class TestTracks
+{
+public:
+    static constexpr double sampleRate{ 44100.0 };
+
+    /**Gives the sample of a channel at a position in the track*/
+    using Signal = std::function<float(int channel, int sample)>;
+
+    /**Gets the folder the tests write their files to*/
+    static juce::File getDirectory();
+    /**Writes a stereo WAV of numSamples from the signal, returns the file*/
+    static juce::File write(const juce::String& fileName, int numSamples, const Signal& signal);
+    /**Reads a whole WAV back, returns false if it cannot be read*/
+    static bool read(const juce::File& file, juce::AudioBuffer<float>& audio);
+    /**Removes the folder and everything in it*/
+    static void deleteAll();
+};
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    TrackLibraryTests.cpp
+    Created: 10 May 2024 9:11:54pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "TrackLibrary.h"
+
+namespace
+{
+//==============================================================================
+/*
+    Writes the library columns out and reads them back, the way the library
+    store saves them, and checks every column and string comes back the same
+    and the interned folders are shared again after a load.
+*/
+class TrackLibraryTests : public juce::UnitTest
+{
+public:
+    TrackLibraryTests() : juce::UnitTest("Track library", "OtoDecks")
+    {
+    }
+
+    void runTest() override
+    {
+        const juce::File folder{ juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("Crates") };
+
+        TrackLibrary library;
+        Track first{ folder.getChildFile("Intro Edit.mp3") };
+        first.duration = 301.25;
+        first.bpm = 124.5f;
+        first.key = 8;
+        first.bitrate = 320;
+        first.sampleRate = 44100;
+        first.dateAdded = 1715000000000;
+        first.playCount = 3;
+        first.fileSize = 12045312;
+        first.modificationTime = 1714900000000;
+        first.fingerprint = 0x0123456789abcdefULL;
+        // a title of its own, not the file name, with characters outside ASCII
+        Track second{ folder.getChildFile(juce::CharPointer_UTF8{ "Zo\xc3\xab - Nachtzug.flac" }) };
+        second.title = juce::CharPointer_UTF8{ "Nachtzug (Zo\xc3\xab Extended Mix)" };
+        second.bpm = 98.0f;
+        second.key = 21;
+        second.fingerprint = 0xfedcba9876543210ULL;
+        Track third{ folder.getChildFile("Dub").getChildFile("third.wav") };
+        third.playCount = 11;
+
+        const TrackId ids[]{ library.addTrack(first), library.addTrack(second), library.addTrack(third) };
+
+        beginTest("Columns survive a write and read");
+        const TrackLibrary::Columns written{ library.createSnapshot() };
+        juce::MemoryOutputStream out;
+        written.writeTo(out);
+
+        TrackLibrary::Columns read;
+        {
+            juce::MemoryInputStream in{ out.getData(), out.getDataSize(), false };
+            expect(read.readFrom(in));
+        }
+        expect(read.ids == written.ids);
+        expect(read.durations == written.durations);
+        expect(read.bpms == written.bpms);
+        expect(read.keys == written.keys);
+        expect(read.bitrates == written.bitrates);
+        expect(read.sampleRates == written.sampleRates);
+        expect(read.datesAdded == written.datesAdded);
+        expect(read.playCounts == written.playCounts);
+        expect(read.fileSizes == written.fileSizes);
+        expect(read.modificationTimes == written.modificationTimes);
+        expect(read.fingerprints == written.fingerprints);
+        expectEquals((int) read.strings.getNumBytes(), (int) written.strings.getNumBytes());
+        for (size_t i = 0; i < written.ids.size(); ++i)
+        {
+            expectEquals(read.getTitle(i), written.getTitle(i));
+            expectEquals(read.getPath(i), written.getPath(i));
+        }
+
+        beginTest("A damaged block is refused");
+        {
+            juce::MemoryInputStream truncated{ out.getData(), out.getDataSize() - 1, false };
+            TrackLibrary::Columns damaged;
+            expect(!damaged.readFrom(truncated));
+        }
+
+        beginTest("A library assigned the read columns finds every track");
+        TrackLibrary loaded;
+        loaded.assign(std::move(read));
+        expectEquals(loaded.getNumTracks(), 3);
+        for (const TrackId id : ids)
+        {
+            expectEquals(loaded.getTitle(id), library.getTitle(id));
+            expectEquals(loaded.getFile(id).getFullPathName(), library.getFile(id).getFullPathName());
+            expectEquals(loaded.getPlayCount(id), library.getPlayCount(id));
+            expect(loaded.findByPath(library.getFile(id).getFullPathName()) == id);
+        }
+        expect(loaded.findByFingerprint(second.fingerprint) == ids[1]);
+        expectEquals(loaded.getTitle(ids[1]), second.title);
+        expectEquals(loaded.getBpm(ids[0]), 124.5f);
+
+        // only the new file name is stored, its folder is interned and the title points into the name
+        const size_t bytesBefore{ loaded.createSnapshot().strings.getNumBytes() };
+        const juce::String fileName{ "Later.wav" };
+        const TrackId later{ loaded.addTrack(Track{ folder.getChildFile(fileName) }) };
+        expect(later != TrackLibrary::invalidId && later != ids[0] && later != ids[1] && later != ids[2],
+               "new tracks do not reuse a loaded id");
+        expectEquals((int) (loaded.createSnapshot().strings.getNumBytes() - bytesBefore),
+                     (int) fileName.getNumBytesAsUTF8());
+    }
+};
+
+TrackLibraryTests trackLibraryTests;
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    ThumbnailDiskCache.cpp
+    Created: 21 Mar 2024 9:12:18pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#include "ThumbnailDiskCache.h"
+
+//==============================================================================
+class ThumbnailDiskCache::ThumbnailWriter : public WaveformSink::Writer
+{
+public:
+    ThumbnailWriter(ThumbnailDiskCache& _cache,
+                    juce::uint64 _fingerprint
+                   ) : cache(_cache),
+                       fingerprint(_fingerprint),
+                       thumbnail(_cache.samplesPerThumbnailSample, _cache.noFormats, _cache)
+    {
+    }
+
+    /**Loads the stored thumbnail, returns false if the track has none yet*/
+    bool loadStored()
+    {
+        return cache.loadThumb(thumbnail, (juce::int64) fingerprint);
+    }
+
+    void reset(int numChannels, double sampleRate, juce::int64 numSamples)
+    {
+        thumbnail.reset(numChannels, sampleRate, numSamples);
+    }
+
+    void addBlock(juce::int64 startSample, const juce::AudioBuffer<float>& audio, int startOffset, int numSamples) override
+    {
+        thumbnail.addBlock(startSample, audio, startOffset, numSamples);
+    }
+
+    void finish() override
+    {
+        cache.storeThumb(thumbnail, (juce::int64) fingerprint);
+    }
+
+private:
+    ThumbnailDiskCache& cache;
+    const juce::uint64 fingerprint;
+    juce::AudioThumbnail thumbnail;
+};
+
+//==============================================================================
+ThumbnailDiskCache::ThumbnailDiskCache(int maxThumbsToStoreInMemory,
+                                       int _samplesPerThumbnailSample,
+                                       const juce::File& _directory
+                                      ) : juce::AudioThumbnailCache(maxThumbsToStoreInMemory),
+                                          samplesPerThumbnailSample(_samplesPerThumbnailSample),
+                                          directory(_directory)
+{
+    directory.createDirectory();
+}
+
+std::unique_ptr<WaveformSink::Writer> ThumbnailDiskCache::createWriter(juce::uint64 fingerprint,
+                                                                       int numChannels,
+                                                                       double sampleRate,
+                                                                       juce::int64 numSamples)
+{
+    auto writer = std::make_unique<ThumbnailWriter>(*this, fingerprint);
+    if (writer->loadStored())
+    {
+        return nullptr;
+    }
+    writer->reset(numChannels, sampleRate, numSamples);
+    return writer;
+}
+
+void ThumbnailDiskCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    // write to a temporary file so a crash never leaves half a thumbnail
+    juce::TemporaryFile temp{ getFileFor(hashCode) };
+    {
+        juce::FileOutputStream out{ temp.getFile() };
+        if (!out.openedOk())
+        {
+            DBG("ThumbnailDiskCache could not write " << temp.getFile().getFullPathName());
+            return;
+        }
+        thumb.saveTo(out);
+    }
+    temp.overwriteTargetFileWithTemporary();
+}
+
+bool ThumbnailDiskCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode)
+{
+    juce::FileInputStream in{ getFileFor(hashCode) };
+    return in.openedOk() && thumb.loadFrom(in);
+}
+
+juce::File ThumbnailDiskCache::getFileFor(juce::int64 hashCode) const
+{
+    return directory.getChildFile(juce::String::toHexString(hashCode).paddedLeft('0', 16) + ".thumb");
+}
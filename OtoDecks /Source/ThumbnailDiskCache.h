@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    ThumbnailDiskCache.h
+    Created: 21 Mar 2024 9:12:18pm
+    Author:  Kirby Loh
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Engine/WaveformSink.h"
+
+//==============================================================================
+/*
+    Thumbnail cache that also keeps finished waveforms on disk, one file per
+    source hash. With fingerprint sources the hash is the content of the
+    track, so waveforms survive restarts, moves and renames. It is also the
+    waveform sink of the engine, which feeds it the tracks it decodes.
+*/
+class ThumbnailDiskCache : public juce::AudioThumbnailCache,
+                           public WaveformSink
+{
+public:
+    ThumbnailDiskCache(int maxThumbsToStoreInMemory,
+                       int _samplesPerThumbnailSample,
+                       const juce::File& _directory);
+
+    /**Implement WaveformSink, the writer fills a thumbnail and stores it here*/
+    std::unique_ptr<Writer> createWriter(juce::uint64 fingerprint,
+                                         int numChannels,
+                                         double sampleRate,
+                                         juce::int64 numSamples) override;
+
+protected:
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+    bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+private:
+    class ThumbnailWriter;
+
+    juce::File getFileFor(juce::int64 hashCode) const;
+
+    const int samplesPerThumbnailSample;
+    juce::File directory;
+    /**writers are only fed decoded audio and never open a file, so this stays empty*/
+    juce::AudioFormatManager noFormats;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ThumbnailDiskCache)
+};
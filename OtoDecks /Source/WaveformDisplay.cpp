@@ -10,24 +10,31 @@
 
 #include <JuceHeader.h>
 #include "WaveformDisplay.h"
+#include "Engine/TrackFingerprint.h"
 
 //==============================================================================
 WaveformDisplay::WaveformDisplay(int _id,
                                  juce::AudioFormatManager& formatManager,
-                                 juce::AudioThumbnailCache& thumbCache
+                                 juce::AudioThumbnailCache& thumbCache,
+                                 WaveformAnalyser& _analyser
                                  ) 
 : id(_id),
 fileLoaded(false),
 position(0),
-audioThumb(1000, formatManager, thumbCache)
+audioThumb(samplesPerThumbnailSample, formatManager, thumbCache),
+analyser(_analyser),
+fingerprint(0),
+hasBands(false)
 {
     // In your constructor, you should add any child components, and
     // initialise any special settings that your component needs.
     audioThumb.addChangeListener(this);
+    analyser.addChangeListener(this);
 }
 
 WaveformDisplay::~WaveformDisplay()
 {
+    analyser.removeChangeListener(this);
 }
 
 void WaveformDisplay::paint (juce::Graphics& g)
@@ -47,13 +54,26 @@ void WaveformDisplay::paint (juce::Graphics& g)
     if (fileLoaded)
     {
         g.setFont(12.0f);
-        audioThumb.drawChannel(g,
-                               getLocalBounds(),
-                               0,
-                               audioThumb.getTotalLength(),
-                               0,
-                               1.0f
-                              );
+        if (hasBands)
+        {
+            // all the work was done at import, a frame only blits the image
+            if (bandsImage.isNull() || bandsImage.getBounds() != getLocalBounds())
+            {
+                renderBands();
+            }
+            g.drawImageAt(bandsImage, 0, 0);
+        }
+        else
+        {
+            // plain peaks until the bands are analysed
+            audioThumb.drawChannel(g,
+                                   getLocalBounds(),
+                                   0,
+                                   audioThumb.getTotalLength(),
+                                   0,
+                                   1.0f
+                                  );
+        }
         g.setColour(juce::Colours::lightgreen);
         g.drawRect(position * getWidth(), 0, getWidth() / 20, getHeight());
         g.setColour(juce::Colours::white);
@@ -78,14 +98,72 @@ void WaveformDisplay::resized()
 
 void WaveformDisplay::changeListenerCallback(juce::ChangeBroadcaster* source)
 {
+    if (source == &analyser)
+    {
+        // some track was analysed, it may be this one
+        if (hasBands || fingerprint == 0 || !analyser.loadBands(fingerprint, bands))
+        {
+            return;
+        }
+        hasBands = true;
+        bandsImage = juce::Image{};
+    }
     repaint();
 }
 
-void WaveformDisplay::loadURL(juce::URL audioURL)
+void WaveformDisplay::renderBands()
+{
+    const int width{ juce::jmax(1, getWidth()) };
+    const int height{ juce::jmax(1, getHeight()) };
+    bandsImage = juce::Image{ juce::Image::ARGB, width, height, true };
+    juce::Graphics g{ bandsImage };
+
+    const int numBins{ bands.getNumBins() };
+    const float centre{ height * 0.5f };
+    for (int x = 0; x < width && numBins > 0; ++x)
+    {
+        // the loudest bin under each pixel, so short transients still show
+        const int first{ (int) ((juce::int64) x * numBins / width) };
+        const int last{ juce::jmax(first + 1, (int) ((juce::int64) (x + 1) * numBins / width)) };
+        int peak{ 0 }, low{ 0 }, mid{ 0 }, high{ 0 };
+        for (int bin = first; bin < last && bin < numBins; ++bin)
+        {
+            peak = juce::jmax(peak, (int) bands.peaks[bin]);
+            low = juce::jmax(low, (int) bands.lows[bin]);
+            mid = juce::jmax(mid, (int) bands.mids[bin]);
+            high = juce::jmax(high, (int) bands.highs[bin]);
+        }
+        // the strongest band sets the colour, kicks show red and hats blue
+        const int loudest{ juce::jmax(1, low, mid, high) };
+        g.setColour(juce::Colour{ (juce::uint8) (255 * low / loudest),
+                                  (juce::uint8) (255 * mid / loudest),
+                                  (juce::uint8) (255 * high / loudest) });
+        const float halfHeight{ peak / 255.0f * centre };
+        g.drawVerticalLine(x, centre - halfHeight, centre + halfHeight);
+    }
+}
+
+void WaveformDisplay::loadURL(juce::URL audioURL, juce::uint64 _fingerprint)
 {
     DBG("WaveformDisplay::loadURL called");
     audioThumb.clear();
-    fileLoaded = audioThumb.setSource(new juce::URLInputSource(audioURL));
+    fingerprint = _fingerprint;
+    bandsImage = juce::Image{};
+    hasBands = fingerprint != 0 && analyser.loadBands(fingerprint, bands);
+    if (!hasBands && fingerprint != 0 && audioURL.isLocalFile())
+    {
+        // not imported through the library, analyse it before anything else
+        analyser.request(fingerprint, audioURL.getLocalFile(), true);
+    }
+    // keyed by content the thumbnail cache still hits after a file moves
+    if (fingerprint != 0 && audioURL.isLocalFile())
+    {
+        fileLoaded = audioThumb.setSource(new FingerprintInputSource(audioURL.getLocalFile(), fingerprint));
+    }
+    else
+    {
+        fileLoaded = audioThumb.setSource(new juce::URLInputSource(audioURL));
+    }
     if (fileLoaded)
     {
         DBG("WaveformDisplay::loadURL file loaded");
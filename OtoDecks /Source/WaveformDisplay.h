@@ -11,6 +11,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "Engine/WaveformAnalyser.h"
 
 //==============================================================================
 /*
@@ -19,15 +20,21 @@ class WaveformDisplay  : public juce::Component,
                          public juce::ChangeListener
 {
 public:
+    /**resolution of the cached waveforms, anything prefilling the cache has to match it*/
+    static constexpr int samplesPerThumbnailSample{ WaveformAnalyser::samplesPerBin };
+
     WaveformDisplay(int _id,
                     juce::AudioFormatManager& formatManager,
-                    juce::AudioThumbnailCache& thumbCache);
+                    juce::AudioThumbnailCache& thumbCache,
+                    WaveformAnalyser& _analyser);
     ~WaveformDisplay() override;
 
     void paint (juce::Graphics&) override;
     void resized() override;
+    /**Repaints when the thumbnail grows or the bands of the loaded track are ready*/
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
-    void loadURL(juce::URL audioURL);
+    /**Loads the waveform, cached by fingerprint when it is not 0*/
+    void loadURL(juce::URL audioURL, juce::uint64 fingerprint = 0);
     /**set the relative position of the playhead*/
     void setPositionRelative(double pos);
 private:
@@ -36,5 +43,14 @@ private:
     double position;
     juce::String fileName;
     juce::AudioThumbnail audioThumb;
+    WaveformAnalyser& analyser;
+    juce::uint64 fingerprint;
+    WaveformBands bands;
+    bool hasBands;
+    /**the coloured waveform at the current size, only redrawn when that changes*/
+    juce::Image bandsImage;
+
+    /**Draws the bands into bandsImage, red for lows, green for mids and blue for highs*/
+    void renderBands();
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformDisplay)
 };